@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,23 +8,24 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(core.pri)
+
 SOURCES += \
     controller.cpp \
     canvas.cpp \
     main.cpp \
     mainwindow.cpp \
-    model.cpp \
-    tool.cpp \
-    toolbar.cpp
+    previewcache.cpp \
+    resizedialog.cpp \
+    thumbnailcache.cpp
 
 HEADERS += \
     controller.h \
     canvas.h \
-    enums.h \
     mainwindow.h \
-    model.h \
-    tool.h \
-    toolbar.h
+    previewcache.h \
+    resizedialog.h \
+    thumbnailcache.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,258 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * AnimationExporter Source
+ *
+ * Brief:
+ * The AnimationExporter turns a project into an animated
+ * GIF or PNG that plays at the project's frame rate.
+ * Frames are streamed to the encoder one at a time and
+ * cropped to the part that changed since the frame
+ * before, so long animations export quickly without
+ * decoding every frame at once.
+ *
+*/
+
+#include <QFileInfo>
+#include <QPromise>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <cstring>
+
+#include "animationexporter.h"
+#include "apngencoder.h"
+#include "gifencoder.h"
+#include "profiler.h"
+
+/**
+ * @brief AnimationExporter::formatFor - Picks the export format from a file name
+ * @param filePath
+ * @return
+ */
+AnimationFormat AnimationExporter::formatFor(const QString &filePath)
+{
+    if (QFileInfo(filePath).suffix().compare("gif", Qt::CaseInsensitive) == 0)
+    {
+        return AnimationFormat::Gif;
+    }
+    return AnimationFormat::Apng;
+}
+
+/**
+ * @brief AnimationExporter::write - Streams every frame into the encoder for `format`. While one frame
+ * is being encoded the next is decoded on another thread, so at most three frames are in memory: the
+ * one before, the one being written and the one after.
+ *
+ * GIFs can only draw over or clear what came before, so animations that may have transparent pixels
+ * are written as whole frames that clear the last one. Opaque animations, which is every animation
+ * drawn in the editor, only write what changed
+ * @param filePath - Where to write the animation
+ * @param project - The frames and frame rate to export
+ * @param format - GIF or animated PNG
+ * @param progress - Told how many frames have been written
+ * @return False if the project is empty or the file couldn't be written
+ */
+bool AnimationExporter::write(const QString &filePath,
+                              const ProjectFile::Project &project,
+                              AnimationFormat format,
+                              const ProjectFile::ProgressCallback &progress)
+{
+    Profiler::Scope scope("export animation");
+
+    int frameCount = int(project.frames.size());
+    if (!project.isValid())
+    {
+        return false;
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QImage current = frameAt(project, 0);
+    if (current.isNull())
+    {
+        return false;
+    }
+    QSize size = current.size();
+    bool opaque = isOpaque(project);
+    int fps = qMax(1, project.fps);
+
+    // GIF delays are in hundredths of a second, and most viewers slow down anything under 2
+    int gifDelay = qMax(2, qRound(100.0 / fps));
+
+    std::unique_ptr<GifEncoder> gif;
+    std::unique_ptr<ApngEncoder> apng;
+    if (format == AnimationFormat::Gif)
+    {
+        gif = std::make_unique<GifEncoder>(&file, size);
+    }
+    else
+    {
+        apng = std::make_unique<ApngEncoder>(&file, size, frameCount, opaque);
+    }
+
+    QImage previous;
+    for (int i = 0; i < frameCount; i++)
+    {
+        QFuture<QImage> next;
+        if (i + 1 < frameCount)
+        {
+            next = QtConcurrent::run([&project, i]() { return frameAt(project, i + 1); });
+        }
+
+        // Frames of a different size than the first can't be cropped against it, so they are
+        // scaled to fit, the same way the preview shows them
+        if (current.size() != size)
+        {
+            current = current.scaled(size, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+        }
+
+        QRect area = previous.isNull() ? current.rect() : changedArea(previous, current);
+        if (gif)
+        {
+            // Opaque frames are kept and the next one only draws what changed, starting with the first.
+            // Frames with transparency are cleared every time, or erased pixels would still show
+            gif->addFrame(current, opaque ? previous : QImage(), opaque ? area : current.rect(), gifDelay, opaque);
+        }
+        else
+        {
+            apng->addFrame(current, area, 1, fps);
+        }
+
+        if (progress)
+        {
+            progress(i + 1, frameCount);
+        }
+
+        previous = current;
+        current = next.isValid() ? next.result() : QImage();
+        if (i + 1 < frameCount && current.isNull())
+        {
+            // A frame that can't be decoded is exported blank rather than stopping the export
+            current = QImage(size, QImage::Format_ARGB32);
+            current.fill(opaque ? Qt::white : Qt::transparent);
+        }
+    }
+
+    bool finished = gif ? gif->finish() : apng->finish();
+    return finished && file.commit();
+}
+
+/**
+ * @brief AnimationExporter::writeAsync - Exports an animation in the background
+ * @param filePath - Where to write the animation
+ * @param project - A snapshot of the project to export
+ * @param format - GIF or animated PNG
+ * @return A future holding whether the export succeeded
+ */
+QFuture<bool> AnimationExporter::writeAsync(const QString &filePath,
+                                            const ProjectFile::Project &project,
+                                            AnimationFormat format)
+{
+    return QtConcurrent::run([filePath, project, format](QPromise<bool> &promise) {
+        promise.setProgressRange(0, int(project.frames.size()));
+        promise.addResult(write(filePath, project, format, [&promise](int framesDone, int) {
+            promise.setProgressValue(framesDone);
+        }));
+    });
+}
+
+/**
+ * @brief AnimationExporter::changedArea - Finds the bounding box of the pixels that differ between two
+ * frames. Whole rows are compared with memcmp first, so the rows that didn't change cost very little
+ * @param previous - 32 bit frame
+ * @param current - 32 bit frame of the same size
+ * @return
+ */
+QRect AnimationExporter::changedArea(const QImage &previous, const QImage &current)
+{
+    if (previous.size() != current.size())
+    {
+        return current.rect();
+    }
+
+    int width = current.width();
+    int left = width;
+    int right = -1;
+    int top = -1;
+    int bottom = -1;
+
+    for (int y = 0; y < current.height(); y++)
+    {
+        const QRgb *before = reinterpret_cast<const QRgb *>(previous.constScanLine(y));
+        const QRgb *after = reinterpret_cast<const QRgb *>(current.constScanLine(y));
+        if (std::memcmp(before, after, width * sizeof(QRgb)) == 0)
+        {
+            continue;
+        }
+
+        if (top < 0)
+        {
+            top = y;
+        }
+        bottom = y;
+
+        int x = 0;
+        while (x < left && before[x] == after[x])
+        {
+            x++;
+        }
+        left = qMin(left, x);
+
+        x = width - 1;
+        while (x > right && before[x] == after[x])
+        {
+            x--;
+        }
+        right = qMax(right, x);
+    }
+
+    if (top < 0)
+    {
+        return QRect();
+    }
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+/**
+ * @brief AnimationExporter::frameAt - Returns a frame as 32 bit pixels, the only layout the encoders
+ * read. RGB32 frames, which is what the editor makes, are returned without copying
+ * @param project
+ * @param index
+ * @return The frame, or a null image if it couldn't be decoded
+ */
+QImage AnimationExporter::frameAt(const ProjectFile::Project &project, size_t index)
+{
+    QImage frame = project.frames[index].isNull() ? project.chunks[index].decode() : project.frames[index];
+    if (frame.format() == QImage::Format_RGB32 || frame.format() == QImage::Format_ARGB32)
+    {
+        return frame;
+    }
+    return frame.convertToFormat(frame.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+}
+
+/**
+ * @brief AnimationExporter::isOpaque - Checks the formats of the frames, without decoding them
+ * @param project
+ * @return True if no frame has an alpha channel
+ */
+bool AnimationExporter::isOpaque(const ProjectFile::Project &project)
+{
+    for (size_t i = 0; i < project.frames.size(); i++)
+    {
+        QImage::Format format = project.frames[i].isNull() ? QImage::Format(project.chunks[i].format)
+                                                           : project.frames[i].format();
+        if (QImage::toPixelFormat(format).alphaUsage() == QPixelFormat::UsesAlpha)
+        {
+            return false;
+        }
+    }
+    return true;
+}
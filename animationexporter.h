@@ -0,0 +1,60 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * AnimationExporter Header
+ *
+ * Brief:
+ * The AnimationExporter turns a project into an animated
+ * GIF or PNG that plays at the project's frame rate.
+ * Frames are streamed to the encoder one at a time and
+ * cropped to the part that changed since the frame
+ * before, so long animations export quickly without
+ * decoding every frame at once.
+ *
+*/
+
+#ifndef ANIMATIONEXPORTER_H
+#define ANIMATIONEXPORTER_H
+
+#include <QFuture>
+#include <QImage>
+#include <QRect>
+#include <QString>
+
+#include "enums.h"
+#include "projectfile.h"
+
+class AnimationExporter
+{
+public:
+    /// Picks the format from the file's extension: .gif is a GIF, anything else an animated PNG
+    static AnimationFormat formatFor(const QString &filePath);
+
+    /// Writes every frame of `project` to `filePath`. Returns false on failure
+    static bool write(const QString &filePath,
+                      const ProjectFile::Project &project,
+                      AnimationFormat format,
+                      const ProjectFile::ProgressCallback &progress = nullptr);
+
+    /// Background version of `write`. The future reports progress in frames
+    static QFuture<bool> writeAsync(const QString &filePath,
+                                    const ProjectFile::Project &project,
+                                    AnimationFormat format);
+
+    /// Returns the smallest rectangle holding every pixel that differs between two frames of the same
+    /// size, or an empty rectangle if they are identical
+    static QRect changedArea(const QImage &previous, const QImage &current);
+
+private:
+    /// Returns frame `index`, decoding it if it's only held compressed, as 32 bit pixels
+    static QImage frameAt(const ProjectFile::Project &project, size_t index);
+
+    /// Returns true if no frame can have transparent pixels, going by the frames' formats
+    static bool isOpaque(const ProjectFile::Project &project);
+};
+
+#endif // ANIMATIONEXPORTER_H
@@ -0,0 +1,265 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ApngEncoder Source
+ *
+ * Brief:
+ * The ApngEncoder writes an animated PNG one frame at a
+ * time. Frames keep their exact colors and transparency,
+ * and each one is filtered and deflated straight into the
+ * output, so only the frame being written is in memory.
+ *
+*/
+
+#include <QtEndian>
+#include <array>
+#include <cstdlib>
+
+#include "apngencoder.h"
+
+/**
+ * @brief appendInt - Appends a big endian 32 bit value, as every number in a PNG is stored
+ * @param bytes
+ * @param value
+ */
+static void appendInt(QByteArray &bytes, quint32 value)
+{
+    quint32 bigEndian = qToBigEndian(value);
+    bytes.append(reinterpret_cast<const char *>(&bigEndian), 4);
+}
+
+/**
+ * @brief appendShort - Appends a big endian 16 bit value
+ * @param bytes
+ * @param value
+ */
+static void appendShort(QByteArray &bytes, quint16 value)
+{
+    quint16 bigEndian = qToBigEndian(value);
+    bytes.append(reinterpret_cast<const char *>(&bigEndian), 2);
+}
+
+/**
+ * @brief ApngEncoder::ApngEncoder - Writes the PNG signature, the image header and the animation control
+ * chunk, which says how many frames follow and that the animation loops forever
+ * @param device - Where the PNG is written, already open
+ * @param size - Size of every frame
+ * @param frameCount - How many frames will be added
+ * @param opaque - True to leave out the alpha channel
+ */
+ApngEncoder::ApngEncoder(QIODevice *device, QSize size, int frameCount, bool opaque)
+    : device(device)
+    , size(size)
+    , frameCount(frameCount)
+    , opaque(opaque)
+    , failed(false)
+    , framesWritten(0)
+    , sequenceNumber(0)
+{
+    const char signature[] = {char(0x89), 'P', 'N', 'G', '\r', '\n', char(0x1a), '\n'};
+    if (device->write(signature, sizeof(signature)) != sizeof(signature))
+    {
+        failed = true;
+    }
+
+    QByteArray header;
+    appendInt(header, size.width());
+    appendInt(header, size.height());
+    header.append(char(8));              // Bits per channel
+    header.append(char(opaque ? 2 : 6)); // Truecolor, with or without alpha
+    header.append(char(0));              // Deflate
+    header.append(char(0));              // Adaptive filtering
+    header.append(char(0));              // Not interlaced
+    writeChunk("IHDR", header);
+
+    QByteArray control;
+    appendInt(control, frameCount);
+    appendInt(control, 0);
+    writeChunk("acTL", control);
+}
+
+/**
+ * @brief ApngEncoder::addFrame - Writes the frame control chunk saying where the frame goes and how
+ * long it's shown, followed by its pixels. The first frame doubles as the still image viewers without
+ * APNG support show, so it is stored in IDAT and always covers the whole image
+ * @param frame - The whole frame
+ * @param area - The part of the frame that changed
+ * @param delayNumerator
+ * @param delayDenominator
+ */
+void ApngEncoder::addFrame(const QImage &frame, QRect area, int delayNumerator, int delayDenominator)
+{
+    area = area.intersected(QRect(QPoint(0, 0), size));
+    if (framesWritten == 0)
+    {
+        area = QRect(QPoint(0, 0), size);
+    }
+    else if (area.isEmpty())
+    {
+        // Nothing changed, but the frame still has to be there for its delay
+        area = QRect(0, 0, 1, 1);
+    }
+
+    QByteArray control;
+    appendInt(control, sequenceNumber++);
+    appendInt(control, area.width());
+    appendInt(control, area.height());
+    appendInt(control, area.x());
+    appendInt(control, area.y());
+    appendShort(control, quint16(delayNumerator));
+    appendShort(control, quint16(delayDenominator));
+    control.append(char(0)); // Leave the frame in place afterwards
+    control.append(char(0)); // Replace the area rather than blending over it
+    writeChunk("fcTL", control);
+
+    QByteArray pixels = encodePixels(frame, area);
+    if (framesWritten == 0)
+    {
+        writeChunk("IDAT", pixels);
+    }
+    else
+    {
+        QByteArray data;
+        data.reserve(pixels.size() + 4);
+        appendInt(data, sequenceNumber++);
+        data.append(pixels);
+        writeChunk("fdAT", data);
+    }
+
+    framesWritten++;
+}
+
+/**
+ * @brief ApngEncoder::finish - Writes the end chunk
+ * @return False if any part of the file failed to write, or the frame count given at the start was wrong
+ */
+bool ApngEncoder::finish()
+{
+    writeChunk("IEND", QByteArray());
+    return !failed && framesWritten == frameCount;
+}
+
+/**
+ * @brief ApngEncoder::writeChunk - Writes a chunk: its length, type, data, and a CRC of the type and data
+ * @param type - Four character chunk type
+ * @param data
+ */
+void ApngEncoder::writeChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+    appendInt(chunk, quint32(data.size()));
+    chunk.append(type, 4);
+    chunk.append(data);
+    appendInt(chunk, crc(chunk.mid(4)));
+
+    if (device->write(chunk) != chunk.size())
+    {
+        failed = true;
+    }
+}
+
+/**
+ * @brief ApngEncoder::encodePixels - Packs the area into rows of RGB or RGBA bytes, filters each row, and
+ * deflates the result. Each row uses whichever of the None, Sub and Up filters leaves the smallest
+ * values, the usual heuristic, which turns the flat runs of pixel art into long runs of zeros
+ * @param frame
+ * @param area
+ * @return The zlib stream for IDAT or fdAT
+ */
+QByteArray ApngEncoder::encodePixels(const QImage &frame, QRect area) const
+{
+    const int channels = opaque ? 3 : 4;
+    const int rowBytes = area.width() * channels;
+
+    QByteArray filtered;
+    filtered.reserve(qsizetype(rowBytes + 1) * area.height());
+
+    QByteArray previousRow(rowBytes, 0);
+    QByteArray row(rowBytes, Qt::Uninitialized);
+    std::array<QByteArray, 3> candidates = {QByteArray(rowBytes, Qt::Uninitialized),
+                                            QByteArray(rowBytes, Qt::Uninitialized),
+                                            QByteArray(rowBytes, Qt::Uninitialized)};
+
+    for (int y = area.top(); y <= area.bottom(); y++)
+    {
+        const QRgb *pixels = reinterpret_cast<const QRgb *>(frame.constScanLine(y)) + area.left();
+        uchar *out = reinterpret_cast<uchar *>(row.data());
+        for (int x = 0; x < area.width(); x++)
+        {
+            *out++ = uchar(qRed(pixels[x]));
+            *out++ = uchar(qGreen(pixels[x]));
+            *out++ = uchar(qBlue(pixels[x]));
+            if (!opaque)
+            {
+                *out++ = uchar(qAlpha(pixels[x]));
+            }
+        }
+
+        const uchar *current = reinterpret_cast<const uchar *>(row.constData());
+        const uchar *above = reinterpret_cast<const uchar *>(previousRow.constData());
+        uchar *none = reinterpret_cast<uchar *>(candidates[0].data());
+        uchar *sub = reinterpret_cast<uchar *>(candidates[1].data());
+        uchar *up = reinterpret_cast<uchar *>(candidates[2].data());
+        std::array<qint64, 3> cost = {0, 0, 0};
+
+        for (int i = 0; i < rowBytes; i++)
+        {
+            none[i] = current[i];
+            sub[i] = uchar(current[i] - (i >= channels ? current[i - channels] : 0));
+            up[i] = uchar(current[i] - above[i]);
+            cost[0] += std::abs(qint8(none[i]));
+            cost[1] += std::abs(qint8(sub[i]));
+            cost[2] += std::abs(qint8(up[i]));
+        }
+
+        int best = 0;
+        for (int filter = 1; filter < 3; filter++)
+        {
+            if (cost[filter] < cost[best])
+            {
+                best = filter;
+            }
+        }
+
+        filtered.append(char(best));
+        filtered.append(candidates[best]);
+        std::swap(previousRow, row);
+    }
+
+    // qCompress writes a zlib stream after a 4 byte length, which PNG doesn't want
+    return qCompress(filtered).mid(4);
+}
+
+/**
+ * @brief ApngEncoder::crc - The CRC-32 used by PNG and zlib
+ * @param bytes
+ * @return
+ */
+quint32 ApngEncoder::crc(const QByteArray &bytes)
+{
+    static const std::array<quint32, 256> table = []() {
+        std::array<quint32, 256> entries;
+        for (quint32 n = 0; n < 256; n++)
+        {
+            quint32 c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+
+    quint32 c = 0xffffffffu;
+    for (char byte : bytes)
+    {
+        c = table[(c ^ uchar(byte)) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+}
@@ -0,0 +1,61 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ApngEncoder Header
+ *
+ * Brief:
+ * The ApngEncoder writes an animated PNG one frame at a
+ * time. Frames keep their exact colors and transparency,
+ * and each one is filtered and deflated straight into the
+ * output, so only the frame being written is in memory.
+ *
+*/
+
+#ifndef APNGENCODER_H
+#define APNGENCODER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QImage>
+#include <QRect>
+
+class ApngEncoder
+{
+public:
+    /// Starts an animated PNG of `frameCount` frames, each `size` big, on `device`. Opaque animations
+    /// are stored without an alpha channel
+    ApngEncoder(QIODevice *device, QSize size, int frameCount, bool opaque);
+
+    /// Writes the pixels of `frame` inside `area`, replacing what was there. `frame` must be 32 bit
+    /// RGB or ARGB. The first frame is always written whole. Frames are shown for
+    /// `delayNumerator` / `delayDenominator` seconds
+    void addFrame(const QImage &frame, QRect area, int delayNumerator, int delayDenominator);
+
+    /// Writes the end of the file. Returns false if anything failed to write, or the wrong number of
+    /// frames was added
+    bool finish();
+
+private:
+    QIODevice *device;
+    QSize size;
+    int frameCount;
+    bool opaque;
+    bool failed;
+    int framesWritten;
+    quint32 sequenceNumber;
+
+    /// Writes one PNG chunk with its length and CRC
+    void writeChunk(const char *type, const QByteArray &data);
+
+    /// Packs the pixels of `area` into filtered rows and deflates them
+    QByteArray encodePixels(const QImage &frame, QRect area) const;
+
+    /// The CRC-32 PNG chunks end with
+    static quint32 crc(const QByteArray &bytes);
+};
+
+#endif // APNGENCODER_H
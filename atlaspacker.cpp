@@ -0,0 +1,494 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * AtlasPacker Source
+ *
+ * Brief:
+ * The AtlasPacker packs the frames of a project into as
+ * few texture pages as it can for game engines. Empty
+ * borders are trimmed off each frame, identical frames
+ * are stored once, and the rest are placed with a
+ * MaxRects bin packer. A JSON file describes where every
+ * frame ended up.
+ *
+*/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QPainter>
+#include <QSaveFile>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <unordered_map>
+
+#include "atlaspacker.h"
+#include "profiler.h"
+
+/**
+ * @brief AtlasPacker::pack - Trims and deduplicates the frames, then packs the distinct ones biggest
+ * first, which is what lets MaxRects fill pages tightly. Each frame goes on the first page it fits on,
+ * and a new page is started when it fits on none. Pages are cropped to what's used at the end
+ * @param project - The frames to pack. Frames that are only held compressed are decoded one at a time
+ * @param settings
+ * @return The atlas
+ */
+AtlasPacker::Atlas AtlasPacker::pack(const ProjectFile::Project &project, const Settings &settings)
+{
+    Profiler::Scope scope("pack atlas");
+
+    Atlas atlas;
+    atlas.fps = project.fps;
+    atlas.frames.resize(project.frames.size());
+
+    // The trimmed pixels of each distinct frame, and which frame they came from
+    std::vector<QImage> contents;
+    std::vector<int> firstFrames;
+    std::unordered_multimap<size_t, int> byHash;
+
+    for (size_t i = 0; i < project.frames.size(); i++)
+    {
+        QImage frame = project.frames[i].isNull() ? project.chunks[i].decode() : project.frames[i];
+        frame = frame.convertToFormat(QImage::Format_ARGB32);
+        if (atlas.frameSize.isEmpty())
+        {
+            atlas.frameSize = frame.size();
+        }
+
+        Placement &placement = atlas.frames[i];
+        placement.trimmed = settings.trim ? trimmedArea(frame, settings.trimWhite) : frame.rect();
+
+        // A frame with nothing left after trimming keeps a single transparent pixel, so it still has
+        // somewhere to point to
+        QImage content;
+        if (placement.trimmed.isEmpty())
+        {
+            placement.trimmed = QRect(0, 0, 1, 1);
+            content = QImage(1, 1, QImage::Format_ARGB32);
+            content.fill(Qt::transparent);
+        }
+        else
+        {
+            content = frame.copy(placement.trimmed);
+        }
+
+        size_t hash = hashPixels(content, content.rect());
+        auto [begin, end] = byHash.equal_range(hash);
+        for (auto it = begin; it != end; ++it)
+        {
+            const QImage &other = contents[it->second];
+            if (samePixels(content, content.rect(), other, other.rect()))
+            {
+                placement.duplicateOf = firstFrames[it->second];
+                break;
+            }
+        }
+
+        if (placement.duplicateOf < 0)
+        {
+            byHash.emplace(hash, int(contents.size()));
+            contents.push_back(content);
+            firstFrames.push_back(int(i));
+        }
+    }
+
+    // Biggest first, by the longer side and then by area
+    std::vector<int> order(contents.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = int(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&contents](int a, int b) {
+        QSize first = contents[a].size();
+        QSize second = contents[b].size();
+        int firstSide = qMax(first.width(), first.height());
+        int secondSide = qMax(second.width(), second.height());
+        if (firstSide != secondSide)
+        {
+            return firstSide > secondSide;
+        }
+        return first.width() * first.height() > second.width() * second.height();
+    });
+
+    // Every frame is given `padding` extra pixels on its right and bottom, and pages are that much
+    // bigger, so the padding only ever ends up between frames
+    std::vector<Bin> bins;
+    std::vector<QSize> pageSizes;
+    std::vector<QRect> areas(contents.size());
+    std::vector<int> pages(contents.size());
+    int padding = qMax(0, settings.padding);
+
+    for (int index : order)
+    {
+        QSize padded = contents[index].size() + QSize(padding, padding);
+        QRect placed;
+        int page = 0;
+        while (page < int(bins.size()) && !bins[page].insert(padded, placed))
+        {
+            page++;
+        }
+
+        if (page == int(bins.size()))
+        {
+            QSize pageSize = QSize(settings.maxPageSize, settings.maxPageSize).expandedTo(contents[index].size())
+                             + QSize(padding, padding);
+            bins.emplace_back(pageSize);
+            pageSizes.push_back(QSize(0, 0));
+            bins.back().insert(padded, placed);
+        }
+
+        areas[index] = QRect(placed.topLeft(), contents[index].size());
+        pages[index] = page;
+        pageSizes[page] = pageSizes[page].expandedTo(QSize(areas[index].right() + 1, areas[index].bottom() + 1));
+    }
+
+    for (QSize size : pageSizes)
+    {
+        QImage page(size, QImage::Format_ARGB32);
+        page.fill(Qt::transparent);
+        atlas.pages.push_back(page);
+    }
+
+    for (size_t page = 0; page < atlas.pages.size(); page++)
+    {
+        QPainter painter(&atlas.pages[page]);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        for (size_t i = 0; i < contents.size(); i++)
+        {
+            if (pages[i] == int(page))
+            {
+                painter.drawImage(areas[i].topLeft(), contents[i]);
+            }
+        }
+    }
+
+    // Duplicates share the area of the frame they repeat
+    std::vector<int> uniqueOfFrame(project.frames.size(), -1);
+    for (size_t i = 0; i < firstFrames.size(); i++)
+    {
+        uniqueOfFrame[firstFrames[i]] = int(i);
+    }
+    for (Placement &placement : atlas.frames)
+    {
+        int first = placement.duplicateOf >= 0 ? placement.duplicateOf : int(&placement - atlas.frames.data());
+        int unique = uniqueOfFrame[first];
+        placement.page = pages[unique];
+        placement.area = areas[unique];
+    }
+
+    return atlas;
+}
+
+/**
+ * @brief AtlasPacker::write - Saves the pages and the JSON description next to each other
+ * @param jsonPath - Where the JSON goes. The pages are named after it
+ * @param atlas
+ * @return False if any file couldn't be written
+ */
+bool AtlasPacker::write(const QString &jsonPath, const Atlas &atlas)
+{
+    QFileInfo info(jsonPath);
+    QString baseName = info.completeBaseName();
+    QDir directory = info.dir();
+
+    QStringList pageNames;
+    for (size_t i = 0; i < atlas.pages.size(); i++)
+    {
+        QString name = atlas.pages.size() == 1 ? baseName + ".png" : QString("%1_%2.png").arg(baseName).arg(i);
+        if (!atlas.pages[i].save(directory.filePath(name), "PNG"))
+        {
+            return false;
+        }
+        pageNames.append(name);
+    }
+
+    QSaveFile file(jsonPath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    file.write(describe(atlas, pageNames, baseName).toJson());
+    return file.commit();
+}
+
+/**
+ * @brief AtlasPacker::describe - Lists every frame in order with the page area it's in, where that area
+ * sits in the untrimmed frame, and how long it's shown. Duplicate frames point to the same area
+ * @param atlas
+ * @param pageNames
+ * @param baseName - Frames are named `<baseName>_0000`, `<baseName>_0001`, ...
+ * @return
+ */
+QJsonDocument AtlasPacker::describe(const Atlas &atlas, const QStringList &pageNames, const QString &baseName)
+{
+    auto rect = [](QRect area) {
+        return QJsonObject{{"x", area.x()}, {"y", area.y()}, {"w", area.width()}, {"h", area.height()}};
+    };
+    auto size = [](QSize size) { return QJsonObject{{"w", size.width()}, {"h", size.height()}}; };
+
+    int duration = atlas.fps > 0 ? qRound(1000.0 / atlas.fps) : 0;
+    QRect whole(QPoint(0, 0), atlas.frameSize);
+
+    QJsonArray frames;
+    for (size_t i = 0; i < atlas.frames.size(); i++)
+    {
+        const Placement &placement = atlas.frames[i];
+        QJsonObject frame{{"filename", QString("%1_%2").arg(baseName).arg(i, 4, 10, QChar('0'))},
+                          {"frame", rect(placement.area)},
+                          {"rotated", false},
+                          {"trimmed", placement.trimmed != whole},
+                          {"spriteSourceSize", rect(placement.trimmed)},
+                          {"sourceSize", size(atlas.frameSize)},
+                          {"duration", duration},
+                          {"page", placement.page}};
+        if (placement.duplicateOf >= 0)
+        {
+            frame["duplicateOf"] = placement.duplicateOf;
+        }
+        frames.append(frame);
+    }
+
+    QJsonArray images;
+    for (size_t i = 0; i < atlas.pages.size(); i++)
+    {
+        images.append(QJsonObject{{"image", pageNames.value(int(i))}, {"size", size(atlas.pages[i].size())}});
+    }
+
+    QJsonObject meta{{"app", "Pixel Image Software Suite"},
+                     {"version", "1.0"},
+                     {"image", pageNames.value(0)},
+                     {"size", size(atlas.pages.empty() ? QSize() : atlas.pages.front().size())},
+                     {"images", images},
+                     {"format", "RGBA8888"},
+                     {"scale", "1"},
+                     {"fps", atlas.fps}};
+
+    return QJsonDocument(QJsonObject{{"frames", frames}, {"meta", meta}});
+}
+
+/**
+ * @brief AtlasPacker::trimmedArea - Shrinks the frame's rectangle past every border row and column that
+ * is empty. Empty means fully transparent, or opaque white when `trimWhite` is set
+ * @param frame - A frame in QImage::Format_ARGB32
+ * @param trimWhite
+ * @return The area to keep, or an empty rectangle if the whole frame is empty
+ */
+QRect AtlasPacker::trimmedArea(const QImage &frame, bool trimWhite)
+{
+    auto isEmpty = [trimWhite](QRgb pixel) {
+        return qAlpha(pixel) == 0 || (trimWhite && pixel == 0xffffffff);
+    };
+
+    int width = frame.width();
+    int top = -1;
+    int bottom = -1;
+    int left = width;
+    int right = -1;
+
+    for (int y = 0; y < frame.height(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        int first = 0;
+        while (first < width && isEmpty(row[first]))
+        {
+            first++;
+        }
+        if (first == width)
+        {
+            continue;
+        }
+
+        int last = width - 1;
+        while (isEmpty(row[last]))
+        {
+            last--;
+        }
+
+        if (top < 0)
+        {
+            top = y;
+        }
+        bottom = y;
+        left = qMin(left, first);
+        right = qMax(right, last);
+    }
+
+    if (top < 0)
+    {
+        return QRect();
+    }
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+/**
+ * @brief AtlasPacker::hashPixels - Hashes the area row by row
+ * @param frame - A 32 bit frame
+ * @param area
+ * @return
+ */
+size_t AtlasPacker::hashPixels(const QImage &frame, QRect area)
+{
+    size_t hash = qHashMulti(0, area.width(), area.height());
+    for (int y = area.top(); y <= area.bottom(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(frame.constScanLine(y)) + area.left();
+        hash = qHashBits(row, area.width() * sizeof(QRgb), hash);
+    }
+    return hash;
+}
+
+/**
+ * @brief AtlasPacker::samePixels - Compares two areas of 32 bit frames, for when their hashes match
+ * @return True if they are the same size and every pixel matches
+ */
+bool AtlasPacker::samePixels(const QImage &first, QRect firstArea, const QImage &second, QRect secondArea)
+{
+    if (firstArea.size() != secondArea.size())
+    {
+        return false;
+    }
+
+    for (int y = 0; y < firstArea.height(); y++)
+    {
+        const QRgb *a = reinterpret_cast<const QRgb *>(first.constScanLine(firstArea.top() + y)) + firstArea.left();
+        const QRgb *b = reinterpret_cast<const QRgb *>(second.constScanLine(secondArea.top() + y)) + secondArea.left();
+        if (std::memcmp(a, b, firstArea.width() * sizeof(QRgb)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//-----AtlasPacker::Bin-----//
+
+/**
+ * @brief AtlasPacker::Bin::Bin - Starts with the whole page free
+ * @param size
+ */
+AtlasPacker::Bin::Bin(QSize size)
+    : freeRects({QRect(QPoint(0, 0), size)})
+{}
+
+/**
+ * @brief AtlasPacker::Bin::insert - Places a rectangle in the free rectangle it fits most snugly, going
+ * by the shorter of the two leftover sides, and breaks up the free space around it
+ * @param size
+ * @param placed - Set to where the rectangle went
+ * @return False if no free rectangle is big enough
+ */
+bool AtlasPacker::Bin::insert(QSize size, QRect &placed)
+{
+    int bestShortSide = INT_MAX;
+    int bestLongSide = INT_MAX;
+    const QRect *best = nullptr;
+
+    for (const QRect &free : freeRects)
+    {
+        if (free.width() < size.width() || free.height() < size.height())
+        {
+            continue;
+        }
+
+        int leftoverWidth = free.width() - size.width();
+        int leftoverHeight = free.height() - size.height();
+        int shortSide = qMin(leftoverWidth, leftoverHeight);
+        int longSide = qMax(leftoverWidth, leftoverHeight);
+        if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+        {
+            best = &free;
+            bestShortSide = shortSide;
+            bestLongSide = longSide;
+        }
+    }
+
+    if (best == nullptr)
+    {
+        return false;
+    }
+
+    placed = QRect(best->topLeft(), size);
+    splitFreeRects(placed);
+    pruneFreeRects();
+    return true;
+}
+
+/**
+ * @brief AtlasPacker::Bin::splitFreeRects - Replaces every free rectangle that overlaps `used` with the
+ * up to four maximal rectangles left on each side of it
+ * @param used
+ */
+void AtlasPacker::Bin::splitFreeRects(const QRect &used)
+{
+    std::vector<QRect> result;
+    result.reserve(freeRects.size() + 4);
+
+    for (const QRect &free : freeRects)
+    {
+        if (!free.intersects(used))
+        {
+            result.push_back(free);
+            continue;
+        }
+
+        if (used.left() > free.left())
+        {
+            result.push_back(QRect(free.left(), free.top(), used.left() - free.left(), free.height()));
+        }
+        if (used.right() < free.right())
+        {
+            result.push_back(QRect(used.right() + 1, free.top(), free.right() - used.right(), free.height()));
+        }
+        if (used.top() > free.top())
+        {
+            result.push_back(QRect(free.left(), free.top(), free.width(), used.top() - free.top()));
+        }
+        if (used.bottom() < free.bottom())
+        {
+            result.push_back(QRect(free.left(), used.bottom() + 1, free.width(), free.bottom() - used.bottom()));
+        }
+    }
+
+    freeRects = std::move(result);
+}
+
+/**
+ * @brief AtlasPacker::Bin::pruneFreeRects - Removes free rectangles that lie entirely inside another,
+ * keeping the list short
+ */
+void AtlasPacker::Bin::pruneFreeRects()
+{
+    std::vector<bool> redundant(freeRects.size(), false);
+    for (size_t i = 0; i < freeRects.size(); i++)
+    {
+        for (size_t j = 0; j < freeRects.size() && !redundant[i]; j++)
+        {
+            if (i == j || redundant[j])
+            {
+                continue;
+            }
+            if (freeRects[j].contains(freeRects[i]))
+            {
+                redundant[i] = true;
+            }
+        }
+    }
+
+    std::vector<QRect> kept;
+    kept.reserve(freeRects.size());
+    for (size_t i = 0; i < freeRects.size(); i++)
+    {
+        if (!redundant[i])
+        {
+            kept.push_back(freeRects[i]);
+        }
+    }
+    freeRects = std::move(kept);
+}
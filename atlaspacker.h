@@ -0,0 +1,114 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * AtlasPacker Header
+ *
+ * Brief:
+ * The AtlasPacker packs the frames of a project into as
+ * few texture pages as it can for game engines. Empty
+ * borders are trimmed off each frame, identical frames
+ * are stored once, and the rest are placed with a
+ * MaxRects bin packer. A JSON file describes where every
+ * frame ended up.
+ *
+*/
+
+#ifndef ATLASPACKER_H
+#define ATLASPACKER_H
+
+#include <QImage>
+#include <QJsonDocument>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+#include "projectfile.h"
+
+class AtlasPacker
+{
+public:
+    /// How the atlas is laid out
+    struct Settings
+    {
+        /// Largest width and height of a page. Frames bigger than this get a page of their own
+        int maxPageSize = 2048;
+
+        /// Empty pixels kept between frames, so texture filtering doesn't bleed between them
+        int padding = 1;
+
+        /// Trim transparent borders, and also white ones, which is the editor's blank canvas
+        bool trim = true;
+        bool trimWhite = true;
+    };
+
+    /// Where one frame of the project is in the atlas
+    struct Placement
+    {
+        /// Page the frame is on, and the area it takes up there
+        int page = 0;
+        QRect area;
+
+        /// The part of the original frame that was kept after trimming
+        QRect trimmed;
+
+        /// Index of the earlier identical frame whose pixels this one reuses, or -1
+        int duplicateOf = -1;
+    };
+
+    /// A packed atlas: the page images and where each frame is
+    struct Atlas
+    {
+        std::vector<QImage> pages;
+        std::vector<Placement> frames;
+        QSize frameSize;
+        int fps = 0;
+    };
+
+    /// Packs every frame of `project`
+    static Atlas pack(const ProjectFile::Project &project, const Settings &settings);
+
+    /// Writes the pages as `<name>.png`, or `<name>_0.png`, `<name>_1.png`, ... when there are several,
+    /// and the description as `<name>.json`, next to `jsonPath`. Returns false on failure
+    static bool write(const QString &jsonPath, const Atlas &atlas);
+
+    /// Describes the atlas in the TexturePacker style JSON array layout most engines import.
+    /// `pageNames` are the file names of the pages
+    static QJsonDocument describe(const Atlas &atlas, const QStringList &pageNames, const QString &baseName);
+
+    /// Returns the smallest rectangle holding every pixel that isn't an empty border
+    static QRect trimmedArea(const QImage &frame, bool trimWhite);
+
+private:
+    /// MaxRects bin: the free space of one page, kept as possibly overlapping maximal rectangles
+    class Bin
+    {
+    public:
+        explicit Bin(QSize size);
+
+        /// Finds a spot for `size` using the best short side fit rule and claims it. Returns false
+        /// if it doesn't fit anywhere
+        bool insert(QSize size, QRect &placed);
+
+    private:
+        std::vector<QRect> freeRects;
+
+        /// Removes `used` from every free rectangle it overlaps, keeping the maximal leftovers
+        void splitFreeRects(const QRect &used);
+
+        /// Drops free rectangles contained in another one
+        void pruneFreeRects();
+    };
+
+    /// Returns a hash of the pixels of `frame` inside `area`
+    static size_t hashPixels(const QImage &frame, QRect area);
+
+    /// Returns true if two areas of two frames hold exactly the same pixels
+    static bool samePixels(const QImage &first, QRect firstArea, const QImage &second, QRect secondArea);
+};
+
+#endif // ATLASPACKER_H
@@ -0,0 +1,323 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * BatchProcessor Source
+ *
+ * Brief:
+ * The BatchProcessor runs one operation, like converting,
+ * exporting, resizing or recolouring, over many project
+ * files at once without a display. It is what the
+ * command-line tool is built on.
+ *
+*/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QPainter>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "animationexporter.h"
+#include "batchprocessor.h"
+#include "floodfill.h"
+#include "model.h"
+#include "palette.h"
+
+/**
+ * @brief BatchProcessor::run - Processes every file, several at a time. Files run on a pool of their own
+ * so that the frame encoding and decoding each file does on the global pool can't starve them
+ * @param inputs - The project files to process
+ * @param options - What to do with them
+ * @param log - Told about each file as it finishes
+ * @return How many files failed
+ */
+int BatchProcessor::run(const QStringList &inputs, const Options &options, const Log &log)
+{
+    if (!QDir().mkpath(options.outputDirectory))
+    {
+        log(QString("Could not create output directory %1").arg(options.outputDirectory));
+        return inputs.size();
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(options.jobs > 0 ? options.jobs : QThread::idealThreadCount());
+
+    QList<QString> errors = QtConcurrent::blockingMapped(&pool, inputs, [&options, &log](const QString &input) {
+        QString error = process(input, options);
+        log(error.isEmpty() ? QString("%1: done").arg(input) : QString("%1: %2").arg(input, error));
+        return error;
+    });
+
+    return int(std::count_if(errors.begin(), errors.end(), [](const QString &error) {
+        return !error.isEmpty();
+    }));
+}
+
+/**
+ * @brief BatchProcessor::process - Reads one project, applies the operation and writes the result
+ * @param input - The project file to process
+ * @param options - What to do with it
+ * @return An empty string on success, otherwise what went wrong
+ */
+QString BatchProcessor::process(const QString &input, const Options &options)
+{
+    // Animations and atlases go through the frames one at a time, so frames are left compressed until then
+    bool lazy = options.operation == BatchOperation::ExportAnimation
+                || options.operation == BatchOperation::ExportAtlas;
+    ProjectFile::Project project = ProjectFile::read(input, nullptr, lazy);
+    if (!project.isValid())
+    {
+        return "could not be read";
+    }
+
+    switch (options.operation)
+    {
+    case BatchOperation::ExportFrames:
+    {
+        return exportFrames(project, input, options);
+    }
+    case BatchOperation::ExportSheet:
+    {
+        return exportSheet(project, input, options);
+    }
+    case BatchOperation::ExportAtlas:
+    {
+        return exportAtlas(project, input, options);
+    }
+    case BatchOperation::ExportAnimation:
+    {
+        return exportAnimation(project, input, options);
+    }
+    case BatchOperation::Resize:
+    {
+        resize(project, options.size);
+        break;
+    }
+    case BatchOperation::Recolor:
+    {
+        recolor(project, options.fromColor, options.toColor, options.tolerance);
+        break;
+    }
+    case BatchOperation::Convert:
+    {
+        break;
+    }
+    }
+
+    if (!ProjectFile::write(outputPath(input, options, "ssp"), project))
+    {
+        return "could not be written";
+    }
+    return QString();
+}
+
+/**
+ * @brief BatchProcessor::outputPath - Returns the file in the output directory named after `input`
+ * @param input
+ * @param options
+ * @param suffix - The extension of the output file
+ * @return
+ */
+QString BatchProcessor::outputPath(const QString &input, const Options &options, const QString &suffix)
+{
+    return QDir(options.outputDirectory).filePath(QFileInfo(input).completeBaseName() + "." + suffix);
+}
+
+/**
+ * @brief BatchProcessor::exportFrames - Writes each frame as `<name>_0000.png`, `<name>_0001.png`, ...
+ * @param project
+ * @param input
+ * @param options
+ * @return An empty string on success, otherwise what went wrong
+ */
+QString BatchProcessor::exportFrames(const ProjectFile::Project &project,
+                                     const QString &input,
+                                     const Options &options)
+{
+    QString baseName = QFileInfo(input).completeBaseName();
+    QDir directory(options.outputDirectory);
+
+    for (uint i = 0; i < project.frames.size(); i++)
+    {
+        QString name = QString("%1_%2.png").arg(baseName).arg(i, 4, 10, QChar('0'));
+        if (!project.frames[i].save(directory.filePath(name), "PNG"))
+        {
+            return QString("frame %1 could not be written").arg(i);
+        }
+    }
+    return QString();
+}
+
+/**
+ * @brief BatchProcessor::exportSheet - Writes every frame into one PNG, left to right and then top to
+ * bottom
+ * @param project
+ * @param input
+ * @param options
+ * @return An empty string on success, otherwise what went wrong
+ */
+QString BatchProcessor::exportSheet(const ProjectFile::Project &project,
+                                    const QString &input,
+                                    const Options &options)
+{
+    int frameCount = int(project.frames.size());
+    int columns = options.columns > 0 ? options.columns : int(std::ceil(std::sqrt(double(frameCount))));
+    columns = qMin(columns, frameCount);
+    int rows = (frameCount + columns - 1) / columns;
+
+    QSize frameSize = project.frames.front().size();
+    QImage sheet(frameSize.width() * columns, frameSize.height() * rows, QImage::Format_ARGB32);
+    sheet.fill(Qt::transparent);
+
+    QPainter painter(&sheet);
+    for (int i = 0; i < frameCount; i++)
+    {
+        QPoint position((i % columns) * frameSize.width(), (i / columns) * frameSize.height());
+        painter.drawImage(position, project.frames[i]);
+    }
+    painter.end();
+
+    if (!sheet.save(outputPath(input, options, "png"), "PNG"))
+    {
+        return "sprite sheet could not be written";
+    }
+    return QString();
+}
+
+/**
+ * @brief BatchProcessor::exportAtlas - Writes `<name>.json` describing the atlas, and its pages as
+ * `<name>.png`, or `<name>_0.png`, `<name>_1.png`, ... when one page isn't enough
+ * @param project
+ * @param input
+ * @param options
+ * @return An empty string on success, otherwise what went wrong
+ */
+QString BatchProcessor::exportAtlas(const ProjectFile::Project &project,
+                                    const QString &input,
+                                    const Options &options)
+{
+    if (!AtlasPacker::write(outputPath(input, options, "json"), AtlasPacker::pack(project, options.atlas)))
+    {
+        return "atlas could not be written";
+    }
+    return QString();
+}
+
+/**
+ * @brief BatchProcessor::exportAnimation - Writes the project as `<name>.gif` or `<name>.png`, playing at
+ * the project's frame rate
+ * @param project
+ * @param input
+ * @param options
+ * @return An empty string on success, otherwise what went wrong
+ */
+QString BatchProcessor::exportAnimation(const ProjectFile::Project &project,
+                                        const QString &input,
+                                        const Options &options)
+{
+    QString suffix = options.animationFormat == AnimationFormat::Gif ? "gif" : "png";
+    if (!AnimationExporter::write(outputPath(input, options, suffix), project, options.animationFormat))
+    {
+        return "animation could not be written";
+    }
+    return QString();
+}
+
+/**
+ * @brief BatchProcessor::resize - Resizes every frame by loading the project into a model and using the
+ * same resize the editor uses
+ * @param project
+ * @param size
+ */
+void BatchProcessor::resize(ProjectFile::Project &project, QSize size)
+{
+    Model model;
+    ProjectFile::restore(project, model);
+    model.resizeFrames(size.width(), size.height());
+    model.clearBuffers();
+    project = ProjectFile::snapshot(model);
+}
+
+/**
+ * @brief BatchProcessor::recolor - Replaces every pixel close enough to one color with another color.
+ * Indexed projects have their palette entries replaced instead
+ * @param project
+ * @param from - The color to replace
+ * @param to - The color to replace it with
+ * @param tolerance - How far each channel may be from `from`
+ */
+void BatchProcessor::recolor(ProjectFile::Project &project, QColor from, QColor to, int tolerance)
+{
+    if (!project.palette.isEmpty())
+    {
+        recolorPalette(project, from, to, tolerance);
+        return;
+    }
+
+    for (size_t i = 0; i < project.frames.size(); i++)
+    {
+        // Frames with layers are recolored layer by layer, then flattened again
+        if (LayerStack *stack = project.layers[i].get())
+        {
+            for (int l = 0; l < stack->count(); l++)
+            {
+                QImage layer = stack->layer(l).image;
+                FloodFill::fillSpans(layer, FloodFill::findColor(layer, from, tolerance), to);
+                stack->setImage(l, layer);
+            }
+            project.frames[i] = stack->composite();
+            continue;
+        }
+
+        QImage &frame = project.frames[i];
+        FloodFill::fillSpans(frame, FloodFill::findColor(frame, from, tolerance), to);
+    }
+}
+
+/**
+ * @brief BatchProcessor::recolorPalette - Replaces every palette entry close enough to one color with
+ * another color. No pixels are rewritten: frames, layers and chunks are just given the new palette
+ * @param project - An indexed project
+ * @param from - The color to replace
+ * @param to - The color to replace it with
+ * @param tolerance - How far each channel may be from `from`
+ */
+void BatchProcessor::recolorPalette(ProjectFile::Project &project, QColor from, QColor to, int tolerance)
+{
+    for (int i = 0; i < int(project.palette.size()); i++)
+    {
+        QRgb entry = project.palette[i];
+        if (i != Palette::TRANSPARENT_INDEX && std::abs(qRed(entry) - from.red()) <= tolerance
+            && std::abs(qGreen(entry) - from.green()) <= tolerance
+            && std::abs(qBlue(entry) - from.blue()) <= tolerance)
+        {
+            project.palette[i] = to.rgb();
+        }
+    }
+
+    for (size_t i = 0; i < project.frames.size(); i++)
+    {
+        if (LayerStack *stack = project.layers[i].get())
+        {
+            stack->setColorTable(project.palette);
+            project.frames[i] = stack->composite();
+            continue;
+        }
+
+        if (project.frames[i].format() == QImage::Format_Indexed8)
+        {
+            project.frames[i].setColorTable(project.palette);
+        }
+        if (project.chunks[i].format == QImage::Format_Indexed8)
+        {
+            project.chunks[i].colorTable = project.palette;
+        }
+    }
+}
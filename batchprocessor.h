@@ -0,0 +1,98 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * BatchProcessor Header
+ *
+ * Brief:
+ * The BatchProcessor runs one operation, like converting,
+ * exporting, resizing or recolouring, over many project
+ * files at once without a display. It is what the
+ * command-line tool is built on.
+ *
+*/
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QColor>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+#include "atlaspacker.h"
+#include "enums.h"
+#include "projectfile.h"
+
+class BatchProcessor
+{
+public:
+    /// What to do with each project, and the settings of that operation
+    struct Options
+    {
+        BatchOperation operation = BatchOperation::Convert;
+
+        /// Directory the results are written to
+        QString outputDirectory = ".";
+
+        /// New frame size, for `Resize`
+        QSize size;
+
+        /// Color to replace, what to replace it with, and how close a pixel has to be, for `Recolor`
+        QColor fromColor;
+        QColor toColor;
+        int tolerance = 0;
+
+        /// Frames per row of the sheet, for `ExportSheet`. 0 picks a roughly square sheet
+        int columns = 0;
+
+        /// Page size, padding and trimming, for `ExportAtlas`
+        AtlasPacker::Settings atlas;
+
+        /// File format, for `ExportAnimation`
+        AnimationFormat animationFormat = AnimationFormat::Gif;
+
+        /// How many files to work on at once. 0 uses every core
+        int jobs = 0;
+    };
+
+    /// Called with a line of output for the user, from whichever thread finished a file
+    using Log = std::function<void(const QString &message)>;
+
+    /// Runs the operation on every file in `inputs`, several at once. Returns how many files failed
+    static int run(const QStringList &inputs, const Options &options, const Log &log);
+
+    /// Runs the operation on one file. Returns an empty string on success, or what went wrong
+    static QString process(const QString &input, const Options &options);
+
+private:
+    /// Returns where the result for `input` goes, with the extension `suffix`
+    static QString outputPath(const QString &input, const Options &options, const QString &suffix);
+
+    /// Writes every frame as its own PNG
+    static QString exportFrames(const ProjectFile::Project &project, const QString &input, const Options &options);
+
+    /// Writes every frame into one PNG, laid out in a grid
+    static QString exportSheet(const ProjectFile::Project &project, const QString &input, const Options &options);
+
+    /// Packs the frames into texture pages with a JSON description
+    static QString exportAtlas(const ProjectFile::Project &project, const QString &input, const Options &options);
+
+    /// Writes the frames as an animated GIF or PNG
+    static QString exportAnimation(const ProjectFile::Project &project, const QString &input, const Options &options);
+
+    /// Crops or extends every frame, the same way the editor does
+    static void resize(ProjectFile::Project &project, QSize size);
+
+    /// Replaces one color with another in every frame
+    static void recolor(ProjectFile::Project &project, QColor from, QColor to, int tolerance);
+
+    /// Replaces one color with another in the palette of an indexed project
+    static void recolorPalette(ProjectFile::Project &project, QColor from, QColor to, int tolerance);
+};
+
+#endif // BATCHPROCESSOR_H
@@ -0,0 +1,333 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Benchmark suite
+ *
+ * Brief:
+ * Entry point of piss-bench, which times the hot paths of
+ * the editor: drawing with each tool, magnifying the sprite
+ * onto the screen, bucket fills, undo, and saving and
+ * loading projects.
+ *
+ * Usage:
+ *   piss-bench [--filter regex] [--min-time seconds] [--json file]
+ *
+*/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <memory>
+
+#include "benchmark.h"
+#include "blitter.h"
+#include "model.h"
+#include "projectfile.h"
+
+/// Sprite sizes most cases are run at
+const std::vector<int> SPRITE_SIZES = {64, 256, 1024};
+
+/**
+ * @brief makeSprite - Makes a sprite of `size` x `size` made of blocks of a few colors, which is closer
+ * to real pixel art than noise, and compresses and fills like it
+ * @param size
+ * @param seed - Picks the pattern, so every frame of a project can differ
+ * @return
+ */
+QImage makeSprite(int size, quint32 seed = 1)
+{
+    QRandomGenerator random(seed);
+    const QRgb palette[] = {0xffffffff, 0xff000000, 0xffe04040, 0xff40a0e0, 0xff60c060};
+
+    QImage sprite(size, size, QImage::Format_RGB32);
+    for (int y = 0; y < size; y++)
+    {
+        QRgb *row = reinterpret_cast<QRgb *>(sprite.scanLine(y));
+        for (int x = 0; x < size; x++)
+        {
+            row[x] = palette[random.bounded(5)];
+            if (x % 8 != 0)
+            {
+                row[x] = row[x - 1];
+            }
+        }
+        if (y % 8 != 0)
+        {
+            std::copy_n(reinterpret_cast<const QRgb *>(sprite.constScanLine(y - 1)), size, row);
+        }
+    }
+    return sprite;
+}
+
+/**
+ * @brief makeModel - Makes a model holding one white frame of `size` x `size`
+ * @param size
+ * @return
+ */
+std::shared_ptr<Model> makeModel(int size)
+{
+    auto model = std::make_shared<Model>();
+    model->getFrames().clearFrames();
+    model->getFrames().generateFrame(size, size);
+    model->getCanvasSettings().setCurrentFrameIndex(0);
+    return model;
+}
+
+/**
+ * @brief addDrawingCases - Dabs and dragged strokes with every drawing tool and a few brush sizes
+ * @param benchmark
+ */
+void addDrawingCases(Benchmark &benchmark)
+{
+    const std::vector<std::pair<QString, ToolType>> tools = {
+        {"pen", ToolType::Pen}, {"eraser", ToolType::Eraser}, {"eyedrop", ToolType::Eyedrop}};
+
+    for (const auto &[toolName, toolType] : tools)
+    {
+        for (int brushSize : {0, 2, 8})
+        {
+            for (int size : SPRITE_SIZES)
+            {
+                QString name = QString("draw/%1/brush%2/%3").arg(toolName).arg(brushSize).arg(size);
+                benchmark.add(name, [=]() {
+                    auto model = makeModel(size);
+                    QImage *image = &model->getFrames().editBuffer(0);
+                    model->recieveActiveTool(toolType);
+                    model->recieveBrushSettings(brushSize, Qt::black);
+                    model->beginStroke(image);
+
+                    auto step = std::make_shared<int>(0);
+                    return [=]() {
+                        int i = (*step)++ % size;
+                        model->recieveDrawOnEvent(*image, QPoint(i, (i * 7) % size));
+                    };
+                });
+            }
+        }
+    }
+
+    // A whole batch of dragged positions, joined into lines, as one display refresh delivers them
+    for (int size : SPRITE_SIZES)
+    {
+        benchmark.add(QString("stroke/pen/brush2/%1").arg(size), [=]() {
+            auto model = makeModel(size);
+            QImage *image = &model->getFrames().editBuffer(0);
+            model->recieveActiveTool(ToolType::Pen);
+            model->recieveBrushSettings(2, Qt::black);
+
+            QList<QPoint> batch;
+            for (int i = 0; i < 16; i++)
+            {
+                batch.append(QPoint((i * 13) % size, (i * 29) % size));
+            }
+
+            return [=]() {
+                model->beginStroke(image);
+                model->recieveDrawOnEvent(*image, batch.first());
+                model->recieveStrokeEvent(*image, batch);
+                model->endStroke(image);
+            };
+        });
+    }
+}
+
+/**
+ * @brief addRenderingCases - Magnifying a sprite into a screen sized buffer at several zoom levels,
+ * which is what every canvas repaint does
+ * @param benchmark
+ */
+void addRenderingCases(Benchmark &benchmark)
+{
+    for (float zoom : {1.0f, 4.0f, 16.0f, 64.0f})
+    {
+        for (int size : SPRITE_SIZES)
+        {
+            benchmark.add(QString("render/zoom%1/%2").arg(zoom).arg(size), [=]() {
+                auto sprite = std::make_shared<QImage>(makeSprite(size));
+                auto screen = std::make_shared<QImage>(1280, 800, QImage::Format_ARGB32_Premultiplied);
+                return [=]() { Blitter::magnify(*sprite, QPoint(0, 0), zoom, *screen, screen->rect()); };
+            });
+        }
+    }
+}
+
+/**
+ * @brief addFillCases - Bucket fills through the model, including recording them for undo. The color
+ * alternates so every fill changes the whole region
+ * @param benchmark
+ */
+void addFillCases(Benchmark &benchmark)
+{
+    const std::vector<std::pair<QString, FillMode>> modes = {{"4way", FillMode::FourConnected},
+                                                            {"8way", FillMode::EightConnected},
+                                                            {"replace", FillMode::ReplaceAll}};
+
+    for (const auto &[modeName, mode] : modes)
+    {
+        for (int size : SPRITE_SIZES)
+        {
+            benchmark.add(QString("fill/%1/%2").arg(modeName).arg(size), [=]() {
+                auto model = makeModel(size);
+                QImage *image = &model->getFrames().editBuffer(0);
+                model->recieveActiveTool(ToolType::Bucket);
+                model->recieveFillSettings(mode, 0);
+
+                auto flip = std::make_shared<bool>(false);
+                return [=]() {
+                    *flip = !*flip;
+                    model->recievePenColor(*flip ? Qt::black : Qt::white);
+                    model->beginStroke(image);
+                    model->recieveDrawOnEvent(*image, QPoint(0, 0));
+                    model->endStroke(image);
+                };
+            });
+        }
+    }
+}
+
+/**
+ * @brief addUndoCases - Recording a short stroke and undoing it again
+ * @param benchmark
+ */
+void addUndoCases(Benchmark &benchmark)
+{
+    for (int size : SPRITE_SIZES)
+    {
+        benchmark.add(QString("undo/stroke/%1").arg(size), [=]() {
+            auto model = makeModel(size);
+            QImage *image = &model->getFrames().editBuffer(0);
+            model->recieveActiveTool(ToolType::Pen);
+            model->recieveBrushSettings(2, Qt::black);
+
+            QList<QPoint> line = {QPoint(0, 0), QPoint(size - 1, size / 2)};
+            return [=]() {
+                model->beginStroke(image);
+                model->recieveDrawOnEvent(*image, line.first());
+                model->recieveStrokeEvent(*image, line);
+                model->endStroke(image);
+                model->undo();
+            };
+        });
+    }
+}
+
+/**
+ * @brief addFileCases - Saving and loading projects of a few sprite sizes and frame counts. Loading is
+ * timed both fully decoded and lazy
+ * @param benchmark
+ * @param directory - Where the project files are written
+ */
+void addFileCases(Benchmark &benchmark, const QString &directory)
+{
+    const std::vector<std::pair<int, int>> projects = {{64, 1}, {64, 16}, {64, 128}, {256, 1}, {256, 16}, {1024, 1}, {1024, 4}};
+
+    for (const auto &[size, frameCount] : projects)
+    {
+        QString suffix = QString("%1/%2frames").arg(size).arg(frameCount);
+        QString path = QString("%1/bench_%2_%3.ssp").arg(directory).arg(size).arg(frameCount);
+
+        auto makeProject = [size = size, frameCount = frameCount]() {
+            ProjectFile::Project project;
+            for (int i = 0; i < frameCount; i++)
+            {
+                project.addFrame(makeSprite(size, quint32(i + 1)));
+            }
+            return project;
+        };
+
+        benchmark.add("save/" + suffix, [=]() {
+            auto project = std::make_shared<ProjectFile::Project>(makeProject());
+            return [=]() { ProjectFile::write(path, *project); };
+        });
+
+        benchmark.add("load/" + suffix, [=]() {
+            ProjectFile::write(path, makeProject());
+            return [=]() { ProjectFile::read(path); };
+        });
+
+        benchmark.add("load-lazy/" + suffix, [=]() {
+            ProjectFile::write(path, makeProject());
+            return [=]() { ProjectFile::read(path, nullptr, true); };
+        });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("piss-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the hot paths of the Pixel Image Software Suite.");
+    parser.addHelpOption();
+    QCommandLineOption filterOption("filter", "Only run cases whose names match.", "regex", ".*");
+    QCommandLineOption minTimeOption("min-time", "Seconds to run each case for.", "seconds", "0.5");
+    QCommandLineOption jsonOption("json", "Write the results to a JSON file.", "file");
+    QCommandLineOption listOption("list", "Only list the cases.");
+    parser.addOptions({filterOption, minTimeOption, jsonOption, listOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTemporaryDir directory;
+    if (!directory.isValid())
+    {
+        QTextStream(stderr) << "Could not create a temporary directory\n";
+        return 1;
+    }
+
+    Benchmark benchmark;
+    addDrawingCases(benchmark);
+    addRenderingCases(benchmark);
+    addFillCases(benchmark);
+    addUndoCases(benchmark);
+    addFileCases(benchmark, directory.path());
+
+    QRegularExpression filter(parser.value(filterOption));
+    if (!filter.isValid())
+    {
+        QTextStream(stderr) << "Invalid filter: " << filter.errorString() << "\n";
+        return 2;
+    }
+
+    if (parser.isSet(listOption))
+    {
+        for (const QString &name : benchmark.names(filter))
+        {
+            out << name << Qt::endl;
+        }
+        return 0;
+    }
+
+    out << QString("%1 %2 %3 %4").arg("case", -32).arg("iterations", 12).arg("mean", 14).arg("min", 14)
+        << Qt::endl;
+    double minSeconds = parser.value(minTimeOption).toDouble();
+    auto log = [&out](const Benchmark::Result &result) {
+        out << QString("%1 %2 %3 %4")
+                   .arg(result.name, -32)
+                   .arg(result.iterations, 12)
+                   .arg(QString::number(result.meanNanoseconds / 1000, 'f', 2) + " us", 14)
+                   .arg(QString::number(result.minNanoseconds / 1000, 'f', 2) + " us", 14)
+            << Qt::endl;
+    };
+    std::vector<Benchmark::Result> results = benchmark.run(filter, minSeconds, log);
+
+    if (parser.isSet(jsonOption))
+    {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            QTextStream(stderr) << "Could not write " << file.fileName() << "\n";
+            return 1;
+        }
+        file.write(Benchmark::toJson(results).toJson());
+    }
+
+    return 0;
+}
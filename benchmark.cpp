@@ -0,0 +1,154 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Benchmark Source
+ *
+ * Brief:
+ * The Benchmark times named pieces of code. Each case is
+ * run repeatedly until enough time has passed to give a
+ * stable figure, and the results can be written as JSON
+ * so they can be compared between releases.
+ *
+*/
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QThread>
+#include <limits>
+
+#include "benchmark.h"
+
+/**
+ * @brief Benchmark::add - Registers a case to be timed
+ * @param name - Slash separated name of the case
+ * @param setup - Prepares the case and returns the code to time
+ */
+void Benchmark::add(const QString &name, const Setup &setup)
+{
+    cases.push_back({name, setup});
+}
+
+/**
+ * @brief Benchmark::run - Times every matching case. Each one is set up, warmed up, and then run in
+ * growing batches until `minSeconds` have passed. The fastest single batch gives the minimum
+ * @param filter - Only cases whose names match are run
+ * @param minSeconds - How long to keep running each case
+ * @param log - Told about each result as it's measured
+ * @return The results, in the order the cases were added
+ */
+std::vector<Benchmark::Result> Benchmark::run(const QRegularExpression &filter,
+                                              double minSeconds,
+                                              const std::function<void(const Result &)> &log) const
+{
+    std::vector<Result> results;
+    qint64 minNanoseconds = qint64(minSeconds * 1e9);
+
+    for (const Case &benchmarkCase : cases)
+    {
+        if (!filter.match(benchmarkCase.name).hasMatch())
+        {
+            continue;
+        }
+
+        Body body = benchmarkCase.setup();
+        for (int i = 0; i < WARMUP_ITERATIONS; i++)
+        {
+            body();
+        }
+
+        Result result{benchmarkCase.name, 0, 0, std::numeric_limits<double>::max()};
+        qint64 totalNanoseconds = 0;
+        qint64 batchSize = 1;
+        QElapsedTimer timer;
+
+        while (totalNanoseconds < minNanoseconds)
+        {
+            timer.start();
+            for (qint64 i = 0; i < batchSize; i++)
+            {
+                body();
+            }
+            qint64 elapsed = timer.nsecsElapsed();
+
+            totalNanoseconds += elapsed;
+            result.iterations += batchSize;
+            result.minNanoseconds = qMin(result.minNanoseconds, double(elapsed) / batchSize);
+
+            // Batches grow so timer overhead stays small for very fast cases
+            if (elapsed < minNanoseconds / 10)
+            {
+                batchSize *= 2;
+            }
+        }
+
+        result.meanNanoseconds = double(totalNanoseconds) / result.iterations;
+        results.push_back(result);
+        log(result);
+    }
+
+    return results;
+}
+
+/**
+ * @brief Benchmark::names - Lists the cases `run` would time with the same filter
+ * @param filter
+ * @return
+ */
+QStringList Benchmark::names(const QRegularExpression &filter) const
+{
+    QStringList matching;
+    for (const Case &benchmarkCase : cases)
+    {
+        if (filter.match(benchmarkCase.name).hasMatch())
+        {
+            matching.append(benchmarkCase.name);
+        }
+    }
+    return matching;
+}
+
+/**
+ * @brief Benchmark::toJson - Formats results like Google Benchmark's JSON output, so the same tools can
+ * compare runs
+ * @param results
+ * @return
+ */
+QJsonDocument Benchmark::toJson(const std::vector<Result> &results)
+{
+    QJsonObject context;
+    context["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    context["host_name"] = QSysInfo::machineHostName();
+    context["num_cpus"] = QThread::idealThreadCount();
+    context["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+    context["qt_version"] = QString(qVersion());
+#ifdef QT_DEBUG
+    context["library_build_type"] = "debug";
+#else
+    context["library_build_type"] = "release";
+#endif
+
+    QJsonArray benchmarks;
+    for (const Result &result : results)
+    {
+        QJsonObject entry;
+        entry["name"] = result.name;
+        entry["run_type"] = "iteration";
+        entry["iterations"] = result.iterations;
+        entry["real_time"] = result.meanNanoseconds;
+        entry["min_time"] = result.minNanoseconds;
+        entry["time_unit"] = "ns";
+        benchmarks.append(entry);
+    }
+
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = benchmarks;
+    return QJsonDocument(root);
+}
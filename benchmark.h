@@ -0,0 +1,74 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Benchmark Header
+ *
+ * Brief:
+ * The Benchmark times named pieces of code. Each case is
+ * run repeatedly until enough time has passed to give a
+ * stable figure, and the results can be written as JSON
+ * so they can be compared between releases.
+ *
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <vector>
+
+class Benchmark
+{
+public:
+    /// The code being timed. Called once per iteration
+    using Body = std::function<void()>;
+
+    /// Builds whatever a case needs and returns the code to time, so setup isn't counted
+    using Setup = std::function<Body()>;
+
+    /// Timing of one case
+    struct Result
+    {
+        QString name;
+        qint64 iterations;
+        double meanNanoseconds;
+        double minNanoseconds;
+    };
+
+    /// Registers a case. Names are slash separated, like "draw/pen/brush2/256"
+    void add(const QString &name, const Setup &setup);
+
+    /// Runs every case whose name matches `filter`, each for at least `minSeconds`.
+    /// `log` is told about each result as it's measured
+    std::vector<Result> run(const QRegularExpression &filter,
+                            double minSeconds,
+                            const std::function<void(const Result &)> &log) const;
+
+    /// Returns the names of every case matching `filter`, without running them
+    QStringList names(const QRegularExpression &filter) const;
+
+    /// Formats results as JSON, in the same layout as Google Benchmark's output
+    static QJsonDocument toJson(const std::vector<Result> &results);
+
+private:
+    struct Case
+    {
+        QString name;
+        Setup setup;
+    };
+
+    std::vector<Case> cases;
+
+    /// Iterations run before timing starts, to warm caches and let lazy work happen
+    static constexpr int WARMUP_ITERATIONS = 3;
+};
+
+#endif // BENCHMARK_H
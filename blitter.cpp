@@ -0,0 +1,241 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Blitter Source
+ *
+ * Brief:
+ * The Blitter magnifies sprite pixels onto the screen
+ * with nearest neighbour sampling, only touching the
+ * destination pixels that are actually visible. It also
+ * writes runs of packed pixels for the drawing tools.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "blitter.h"
+#include "palette.h"
+
+/**
+ * @brief Blitter::coveredArea - Returns the rectangle of the destination that the whole of `source`
+ * takes up once magnified. Used to skip the parts of the screen the sprite doesn't reach
+ * @param source - The sprite being drawn
+ * @param offset - Where the top left corner of the sprite is drawn
+ * @param scale - How many destination pixels wide one sprite pixel is
+ * @return The destination rectangle covered by the sprite
+ */
+QRect Blitter::coveredArea(const QImage &source, QPoint offset, float scale)
+{
+    return QRect(offset.x(),
+                 offset.y(),
+                 int(std::ceil(source.width() * scale)),
+                 int(std::ceil(source.height() * scale)));
+}
+
+/**
+ * @brief Blitter::magnify - Draws the sprite pixels that land inside `clip` into `destination`.
+ *
+ * The work done is proportional to the number of visible destination pixels: only the window of
+ * sprite pixels under `clip` is read, each sprite pixel is expanded into a run of identical
+ * destination pixels, and destination rows that sample the same sprite row are copied from the
+ * row above instead of being expanded again. The mapping from screen to sprite pixels matches
+ * `Canvas::canvasToSpriteSpace()` so what is drawn lines up with where the tools draw
+ * @param source - The sprite being drawn
+ * @param offset - Where the top left corner of the sprite is drawn
+ * @param scale - How many destination pixels wide one sprite pixel is
+ * @param destination - The image to draw into, in `QImage::Format_ARGB32_Premultiplied`
+ * @param clip - The part of the destination that needs to be redrawn
+ */
+void Blitter::magnify(const QImage &source,
+                      QPoint offset,
+                      float scale,
+                      QImage &destination,
+                      QRect clip)
+{
+    QRect area = clip.intersected(coveredArea(source, offset, scale)).intersected(destination.rect());
+    if (area.isEmpty() || source.isNull() || scale <= 0)
+    {
+        return;
+    }
+
+    auto toSprite = [scale](int relative, int limit) {
+        return std::clamp(int(std::floor(relative / scale)), 0, limit - 1);
+    };
+
+    // The window of sprite pixels that is visible through `area`
+    int firstColumn = toSprite(area.left() - offset.x(), source.width());
+    int lastColumn = toSprite(area.right() - offset.x(), source.width());
+    int firstRow = toSprite(area.top() - offset.y(), source.height());
+    int lastRow = toSprite(area.bottom() - offset.y(), source.height());
+    QRect window(QPoint(firstColumn, firstRow), QPoint(lastColumn, lastRow));
+
+    // Sprites already stored as 32 bit premultiplied pixels are read in place, and indexed sprites are
+    // looked up through their palette as they're drawn. Anything else only has its visible window
+    // converted, so the conversion cost stays proportional to what's shown
+    QImage converted;
+    const QImage *pixels = &source;
+    QPoint windowOrigin = window.topLeft();
+    bool indexed = source.format() == QImage::Format_Indexed8;
+    quint32 palette[256] = {};
+    if (indexed)
+    {
+        QList<QRgb> colors = source.colorTable();
+        for (int i = 0; i < std::min(int(colors.size()), 256); i++)
+        {
+            palette[i] = qPremultiply(colors[i]);
+        }
+    }
+    else if (source.format() != QImage::Format_RGB32
+             && source.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        converted = source.copy(window).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        pixels = &converted;
+        windowOrigin = QPoint(0, 0);
+    }
+
+    // How many destination pixels each visible sprite column is stretched across
+    std::vector<int> runLengths(window.width(), 0);
+    for (int x = area.left(); x <= area.right(); x++)
+    {
+        runLengths[toSprite(x - offset.x(), source.width()) - firstColumn]++;
+    }
+
+    int rowBytes = area.width() * sizeof(quint32);
+    const quint32 *previousRow = nullptr;
+    int previousSpriteRow = -1;
+
+    for (int y = area.top(); y <= area.bottom(); y++)
+    {
+        quint32 *out = reinterpret_cast<quint32 *>(destination.scanLine(y)) + area.left();
+        int spriteRow = toSprite(y - offset.y(), source.height());
+
+        if (spriteRow == previousSpriteRow)
+        {
+            std::memcpy(out, previousRow, rowBytes);
+            continue;
+        }
+
+        quint32 *write = out;
+        if (indexed)
+        {
+            const uchar *in = source.constScanLine(spriteRow) + firstColumn;
+            for (int column = 0; column < window.width(); column++)
+            {
+                fillSpan(write, palette[in[column]], runLengths[column]);
+                write += runLengths[column];
+            }
+        }
+        else
+        {
+            const quint32 *in = reinterpret_cast<const quint32 *>(
+                                    pixels->constScanLine(spriteRow - firstRow + windowOrigin.y()))
+                                + windowOrigin.x();
+            for (int column = 0; column < window.width(); column++)
+            {
+                // RGB32 leaves the alpha byte as 0xff, so it's already a valid premultiplied pixel
+                fillSpan(write, in[column], runLengths[column]);
+                write += runLengths[column];
+            }
+        }
+
+        previousRow = out;
+        previousSpriteRow = spriteRow;
+    }
+}
+
+/**
+ * @brief Blitter::fillSpan - Writes `count` copies of one pixel. At high zoom levels every sprite
+ * pixel becomes a long run, so this uses 128 bit stores where the platform has them
+ * @param out - Where to start writing
+ * @param color - The pixel to repeat
+ * @param count - How many pixels to write
+ */
+void Blitter::fillSpan(quint32 *out, quint32 color, int count)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i repeated = _mm_set1_epi32(int(color));
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), repeated);
+    }
+#elif defined(__ARM_NEON)
+    uint32x4_t repeated = vdupq_n_u32(color);
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_u32(out + i, repeated);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        out[i] = color;
+    }
+}
+
+/**
+ * @brief Blitter::paste - Copies `source` into `destination` with its top left corner at `position`, row by
+ * row. Indexed pixels are copied as they are, so they keep pointing at the same palette entries
+ * @param destination - The image to copy into, 8 or 32 bits per pixel
+ * @param source - The pixels to copy. They are converted to the format of `destination` first if needed
+ * @param position - Where the top left corner of `source` goes. Anything outside `destination` is skipped
+ */
+void Blitter::paste(QImage &destination, const QImage &source, QPoint position)
+{
+    QRect area = QRect(position, source.size()) & destination.rect();
+    if (area.isEmpty())
+    {
+        return;
+    }
+
+    QImage pixels = source;
+    if (source.format() != destination.format())
+    {
+        pixels = destination.format() == QImage::Format_Indexed8
+                     ? Palette::toIndexed(source, destination.colorTable())
+                     : source.convertToFormat(destination.format());
+    }
+
+    int bytesPerPixel = destination.depth() / 8;
+    for (int y = area.top(); y <= area.bottom(); y++)
+    {
+        const uchar *in = pixels.constScanLine(y - position.y()) + (area.left() - position.x()) * bytesPerPixel;
+        std::memcpy(destination.scanLine(y) + area.left() * bytesPerPixel, in, size_t(area.width()) * bytesPerPixel);
+    }
+}
+
+/**
+ * @brief Blitter::packPixel - Converts a color into the raw pixel value stored by a 32 bit image, so it
+ * can be written straight into scanlines
+ * @param color - The color to convert
+ * @param format - The format of the image being written to
+ * @return The packed pixel
+ */
+quint32 Blitter::packPixel(QColor color, QImage::Format format)
+{
+    QRgb pixel = color.rgba();
+    if (format == QImage::Format_RGB32)
+    {
+        // RGB32 expects the unused alpha byte to be 0xff
+        return pixel | 0xff000000;
+    }
+    if (format == QImage::Format_ARGB32_Premultiplied)
+    {
+        return qPremultiply(pixel);
+    }
+    return pixel;
+}
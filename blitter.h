@@ -0,0 +1,50 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Blitter Header
+ *
+ * Brief:
+ * The Blitter magnifies sprite pixels onto the screen
+ * with nearest neighbour sampling, only touching the
+ * destination pixels that are actually visible. It also
+ * writes runs of packed pixels for the drawing tools.
+ *
+*/
+
+#ifndef BLITTER_H
+#define BLITTER_H
+
+#include <QColor>
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+
+class Blitter
+{
+public:
+    /// Returns the destination rectangle that `source` covers when drawn at `offset` magnified by `scale`
+    static QRect coveredArea(const QImage &source, QPoint offset, float scale);
+
+    /// Magnifies the part of `source` visible through `clip` into `destination`.
+    /// `destination` must be in `QImage::Format_ARGB32_Premultiplied`
+    static void magnify(const QImage &source,
+                        QPoint offset,
+                        float scale,
+                        QImage &destination,
+                        QRect clip);
+
+    /// Writes `count` copies of `color` starting at `out`, using vector stores when available
+    static void fillSpan(quint32 *out, quint32 color, int count);
+
+    /// Copies `source` into `destination` at `position`, converting it to the format of `destination`
+    static void paste(QImage &destination, const QImage &source, QPoint position);
+
+    /// Returns `color` as it is stored in a 32 bit image of `format`
+    static quint32 packPixel(QColor color, QImage::Format format);
+};
+
+#endif // BLITTER_H
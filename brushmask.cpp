@@ -0,0 +1,117 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * BrushMask Source
+ *
+ * Brief:
+ * The BrushMask is the footprint of a brush, stored as
+ * one horizontal run per row. It is built once whenever
+ * the brush size or shape changes, and stamps a whole
+ * dab straight into the image's scanlines.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "blitter.h"
+#include "brushmask.h"
+#include "palette.h"
+
+/**
+ * @brief BrushMask::BrushMask - Builds the rows of the brush footprint. A square brush covers every
+ * pixel up to `radius` away on each axis, and a round brush covers the pixels whose centres fall
+ * inside a circle reaching the middle of the outermost pixels
+ * @param shape - The shape of the brush
+ * @param radius - How many pixels the brush reaches past its centre, 0 for a single pixel
+ */
+BrushMask::BrushMask(BrushShape shape, int radius)
+    : radius(std::max(radius, 0))
+{
+    float reach = this->radius + 0.5f;
+
+    for (int dy = -this->radius; dy <= this->radius; dy++)
+    {
+        int halfWidth = this->radius;
+        if (shape == BrushShape::Circle)
+        {
+            halfWidth = int(std::floor(std::sqrt(reach * reach - float(dy * dy))));
+            halfWidth = std::min(halfWidth, this->radius);
+        }
+        rows.push_back({dy, -halfWidth, halfWidth});
+    }
+}
+
+/**
+ * @brief BrushMask::area - Returns the rectangle the brush covers when centred on `centre`
+ * @param image - The image being drawn on
+ * @param centre - The pixel under the cursor
+ * @return The covered rectangle, clipped to the image
+ */
+QRect BrushMask::area(const QImage &image, QPoint centre) const
+{
+    return QRect(centre - QPoint(radius, radius), centre + QPoint(radius, radius))
+        .intersected(image.rect());
+}
+
+/**
+ * @brief BrushMask::stamp - Draws a whole dab at once. The brush is clipped to the image once, then
+ * each row of the footprint is written straight into the scanlines as packed pixels
+ * @param image - The image to draw on. Indexed images are drawn with the palette entry closest to `color`,
+ * and other formats are converted to 32 bits per pixel first
+ * @param centre - The pixel under the cursor
+ * @param color - The color to draw with
+ * @return The changed rectangle, empty if the brush is entirely outside the image
+ */
+QRect BrushMask::stamp(QImage &image, QPoint centre, QColor color) const
+{
+    QRect clip = area(image, centre);
+    if (clip.isEmpty())
+    {
+        return clip;
+    }
+
+    if (image.format() == QImage::Format_Indexed8)
+    {
+        uchar index = uchar(Palette::nearest(image.colorTable(), color.rgba()));
+        for (const Row &row : rows)
+        {
+            int y = centre.y() + row.dy;
+            int left = std::max(centre.x() + row.left, clip.left());
+            int right = std::min(centre.x() + row.right, clip.right());
+            if (y >= clip.top() && y <= clip.bottom() && left <= right)
+            {
+                std::memset(image.scanLine(y) + left, index, right - left + 1);
+            }
+        }
+        return clip;
+    }
+
+    if (image.depth() != 32)
+    {
+        image.convertTo(QImage::Format_ARGB32);
+    }
+
+    quint32 pixel = Blitter::packPixel(color, image.format());
+
+    for (const Row &row : rows)
+    {
+        int y = centre.y() + row.dy;
+        int left = std::max(centre.x() + row.left, clip.left());
+        int right = std::min(centre.x() + row.right, clip.right());
+        if (y < clip.top() || y > clip.bottom() || left > right)
+        {
+            continue;
+        }
+
+        quint32 *out = reinterpret_cast<quint32 *>(image.scanLine(y));
+        Blitter::fillSpan(out + left, pixel, right - left + 1);
+    }
+
+    return clip;
+}
@@ -0,0 +1,54 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * BrushMask Header
+ *
+ * Brief:
+ * The BrushMask is the footprint of a brush, stored as
+ * one horizontal run per row. It is built once whenever
+ * the brush size or shape changes, and stamps a whole
+ * dab straight into the image's scanlines.
+ *
+*/
+
+#ifndef BRUSHMASK_H
+#define BRUSHMASK_H
+
+#include <QColor>
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <vector>
+
+#include "enums.h"
+
+class BrushMask
+{
+public:
+    /// The pixels a brush covers on one row, as offsets from the centre of the brush
+    struct Row
+    {
+        int dy;
+        int left;
+        int right;
+    };
+
+    /// Builds the footprint of a brush reaching `radius` pixels out from its centre
+    explicit BrushMask(BrushShape shape = BrushShape::Square, int radius = 0);
+
+    /// Returns the rectangle the brush covers when centred on `centre`, clipped to `image`
+    QRect area(const QImage &image, QPoint centre) const;
+
+    /// Writes `color` over every pixel of the brush centred on `centre`. Returns the changed area
+    QRect stamp(QImage &image, QPoint centre, QColor color) const;
+
+private:
+    std::vector<Row> rows;
+    int radius;
+};
+
+#endif // BRUSHMASK_H
@@ -16,16 +16,22 @@
  *
 */
 
-#include <QLabel>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QPinchGesture>
+#include <QScreen>
 #include <QStyle>
 #include <QVBoxLayout>
 
+#include "blitter.h"
 #include "canvas.h"
+#include "profiler.h"
 
-/// Qt lags quite a bit when trying to render an image scaled too large
-const float MAX_ZOOM = 100;
+/// Rendering only magnifies the visible pixels, so zoom no longer affects speed. This just keeps a
+/// single sprite pixel from growing far past the size of the screen
+const float MAX_ZOOM = 1000;
+/// How often the profiler overlay is redrawn, in milliseconds
+const int OVERLAY_REFRESH_INTERVAL = 250;
 /// How many pixels to move the canvas when the user presses one of the arrow keys
 const int KEYBOARD_MOVE_PIXEL_STEP = 1;
 /// How many pixels to move the canvas when the user presses one of the arrow keys
@@ -38,12 +44,20 @@ const int KEYBOARD_MOVE_PIXEL_STEP_SHIFT = 8;
  */
 Canvas::Canvas(QWidget *parent)
     : QWidget{parent}
-    , imageHolder{new QLabel(this)}
     , canvasSize(QPoint(0, 0))
     , offset(QPoint(0, 0))
     , scaleFactor(8)
+    , showOverlay(false)
+    , imageToDisplay(nullptr)
 {
     grabGesture(Qt::PinchGesture);
+
+    moveBatchTimer.setSingleShot(true);
+    moveBatchTimer.setTimerType(Qt::PreciseTimer);
+    connect(&moveBatchTimer, &QTimer::timeout, this, &Canvas::flushMoves);
+
+    overlayTimer.setInterval(OVERLAY_REFRESH_INTERVAL);
+    connect(&overlayTimer, &QTimer::timeout, this, [this]() { QWidget::update(overlayArea); });
 }
 
 /**
@@ -78,21 +92,157 @@ void Canvas::setOffset(QPoint newOffset)
     offset = newOffset;
 }
 
+/**
+ * @brief Canvas::getScale - Returns the scale, or zoom factor, of the canvas
+ * @return
+ */
+float Canvas::getScale()
+{
+    return scaleFactor;
+}
+
+/**
+ * @brief Canvas::getOffset - Returns the offset position of the canvas
+ * @return
+ */
+QPoint Canvas::getOffset()
+{
+    return offset;
+}
+
 /**
  * @brief Canvas::update - refresh our rendering of the frame. If any changes have been made to offset,
  * scaleFactor, or the image being displayed, this method needs to be called before
  * you'll see anything appear on screen
+ *
+ * This schedules a repaint of the whole widget; edits that only touch part of the sprite
+ * should use `updateSpriteRegion()` instead
  */
 void Canvas::update()
 {
-    QImage scaled = imageToDisplay->scaled(canvasSize.x() * scaleFactor,
-                                           canvasSize.y() * scaleFactor);
-
-    imageHolder->setPixmap(QPixmap::fromImage(scaled));
-    imageHolder->setGeometry(offset.x(),
-                             offset.y(),
-                             canvasSize.x() * scaleFactor,
-                             canvasSize.y() * scaleFactor);
+    QWidget::update();
+}
+
+/**
+ * @brief Canvas::updateSpriteRegion - Schedules a repaint of only the on-screen area that displays
+ * `spriteRegion`. Qt merges multiple requests made before the next paint into one damaged region,
+ * so a tool can report every rectangle it touches without causing extra repaints
+ * @param spriteRegion - The rectangle of sprite pixels that changed
+ */
+void Canvas::updateSpriteRegion(QRect spriteRegion)
+{
+    if (spriteRegion.isEmpty())
+    {
+        return;
+    }
+
+    QRect damaged = spriteToCanvasSpace(spriteRegion).intersected(rect());
+    if (!damaged.isEmpty())
+    {
+        QWidget::update(damaged);
+    }
+}
+
+/**
+ * @brief Canvas::paintEvent - Draws the sprite pixels that fall inside the damaged area of the widget.
+ * Only the visible sprite pixels under `event->rect()` are magnified into the back buffer, so the
+ * cost of a repaint depends on how much of the screen changed rather than on the sprite size or
+ * zoom level
+ * @param event
+ */
+void Canvas::paintEvent(QPaintEvent *event)
+{
+    // The time between repaints is the frame time the user actually sees
+    if (Profiler::isEnabled())
+    {
+        if (frameClock.isValid())
+        {
+            Profiler::addSample("frame interval", frameClock.nsecsElapsed());
+        }
+        frameClock.start();
+    }
+
+    QPainter painter(this);
+
+    if (imageToDisplay != nullptr && !imageToDisplay->isNull())
+    {
+        QRect damaged = event->rect().intersected(
+            Blitter::coveredArea(*imageToDisplay, offset, scaleFactor));
+
+        if (!damaged.isEmpty())
+        {
+            Profiler::Scope scope("render");
+            Profiler::count("pixels repainted", qint64(damaged.width()) * damaged.height());
+
+            if (backBuffer.size() != size())
+            {
+                backBuffer = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+            }
+
+            Blitter::magnify(*imageToDisplay, offset, scaleFactor, backBuffer, damaged);
+
+            // The back buffer is already at screen resolution, so this is a straight copy
+            painter.drawImage(damaged, backBuffer, damaged);
+        }
+    }
+
+    if (showOverlay)
+    {
+        paintOverlay(painter);
+    }
+}
+
+/**
+ * @brief Canvas::setOverlayVisible - Shows or hides the profiler overlay. The overlay only shows timings
+ * while the profiler is enabled
+ * @param visible
+ */
+void Canvas::setOverlayVisible(bool visible)
+{
+    showOverlay = visible;
+    if (visible)
+    {
+        overlayTimer.start();
+    }
+    else
+    {
+        overlayTimer.stop();
+        frameClock.invalidate();
+    }
+    QWidget::update(overlayArea);
+}
+
+/**
+ * @brief Canvas::paintOverlay - Draws the profiler report in the top left corner on a translucent
+ * background. The area it covers is remembered so the refresh timer only repaints that
+ * @param painter
+ */
+void Canvas::paintOverlay(QPainter &painter)
+{
+    QStringList lines = Profiler::report();
+
+    QFont font("Monospace");
+    font.setStyleHint(QFont::TypeWriter);
+    font.setPointSize(9);
+    painter.setFont(font);
+
+    QFontMetrics metrics(font);
+    int width = 0;
+    for (const QString &line : lines)
+    {
+        width = qMax(width, metrics.horizontalAdvance(line));
+    }
+
+    QRect area(0, 0, width + 12, lines.size() * metrics.height() + 8);
+    painter.fillRect(area, QColor(0, 0, 0, 170));
+    painter.setPen(Qt::white);
+    for (int i = 0; i < lines.size(); i++)
+    {
+        painter.drawText(6, 4 + metrics.ascent() + i * metrics.height(), lines[i]);
+    }
+
+    // When the overlay grows, the next refresh covers the larger area as well
+    overlayArea = overlayArea.united(area);
 }
 
 /**
@@ -115,6 +265,23 @@ QPoint Canvas::canvasToSpriteSpace(QPoint canvasSpace)
     return QPoint(floor(x), floor(y));
 }
 
+/**
+ * @brief Canvas::spriteToCanvasSpace - The inverse of `canvasToSpriteSpace()` for whole rectangles.
+ * Returns the rectangle of the canvas that the sprite pixels in `spriteSpace` are drawn in, rounded
+ * outwards so it always fully covers them
+ * @param spriteSpace - A rectangle of sprite pixels
+ * @return Returns the canvas space rectangle covering those pixels
+ */
+QRect Canvas::spriteToCanvasSpace(QRect spriteSpace)
+{
+    int left = floor(offset.x() + spriteSpace.x() * scaleFactor);
+    int top = floor(offset.y() + spriteSpace.y() * scaleFactor);
+    int right = ceil(offset.x() + (spriteSpace.x() + spriteSpace.width()) * scaleFactor);
+    int bottom = ceil(offset.y() + (spriteSpace.y() + spriteSpace.height()) * scaleFactor);
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
 /**
  * @brief Canvas::mousePressEvent - Called when a mousePressEvent is detected and emits the `canvasMousePressed()`
  * that maps the mouse position to sprite coordinates, for use by the controller
@@ -122,29 +289,61 @@ QPoint Canvas::canvasToSpriteSpace(QPoint canvasSpace)
  */
 void Canvas::mousePressEvent(QMouseEvent *event)
 {
+    flushMoves();
     emit canvasMousePressed(canvasToSpriteSpace(event->pos()));
 }
 
 /**
- * @brief Canvas::mouseMoveEvent - Called when a mouseMoveEvent is detected and emits the `canvasMouseMoved()`
- * that maps the mouse position to sprite coordinates, for use by the controller
+ * @brief Canvas::mouseMoveEvent - Called when a mouseMoveEvent is detected. Mice and tablets can report
+ * positions far faster than the screen refreshes, so positions are collected and sent to the controller
+ * as one `canvasMouseMoved()` batch per refresh. Repeated positions on the same sprite pixel are dropped
  * @param event
  */
 void Canvas::mouseMoveEvent(QMouseEvent *event)
 {
-    emit canvasMouseMoved(canvasToSpriteSpace(event->pos()));
+    QPoint spritePos = canvasToSpriteSpace(event->pos());
+    if (!pendingMoves.isEmpty() && pendingMoves.last() == spritePos)
+    {
+        return;
+    }
+    pendingMoves.append(spritePos);
+
+    if (!moveBatchTimer.isActive())
+    {
+        qreal refreshRate = screen() != nullptr ? screen()->refreshRate() : 60;
+        moveBatchTimer.start(qMax(1, int(1000 / qMax(refreshRate, qreal(1)))));
+    }
 }
 
 /**
  * @brief Canvas::mouseReleaseEvent - Called when a mouseReleaseEvent is detected and emits the `canvasMouseReleased()`
- * that maps the mouse position to sprite coordinates, for use by the controller
+ * that maps the mouse position to sprite coordinates, for use by the controller. Any positions still
+ * waiting to be sent are sent first, so the stroke ends where the mouse was released
  * @param event
  */
 void Canvas::mouseReleaseEvent(QMouseEvent *event)
 {
+    flushMoves();
     emit canvasMouseReleased(canvasToSpriteSpace(event->pos()));
 }
 
+/**
+ * @brief Canvas::flushMoves - Emits `canvasMouseMoved()` with every mouse position collected since the
+ * last batch
+ */
+void Canvas::flushMoves()
+{
+    moveBatchTimer.stop();
+    if (pendingMoves.isEmpty())
+    {
+        return;
+    }
+
+    QList<QPoint> batch;
+    batch.swap(pendingMoves);
+    emit canvasMouseMoved(batch);
+}
+
 /**
  * @brief Canvas::wheelEvent - Called when the user inputs to a horizontal or vertical scroll action to pan the
  * canvas around. Touchpad scrolling is included in that
@@ -296,7 +495,8 @@ bool Canvas::event(QEvent *event)
     }
     default:
     {
-        // event of a different type
+        // event of a different type, such as a paint event, is handled by QWidget
+        return QWidget::event(event);
     }
     }
     return true;
@@ -19,10 +19,14 @@
 #ifndef CANVAS_H
 #define CANVAS_H
 
+#include <QElapsedTimer>
 #include <QGestureEvent>
 #include <QImage>
-#include <QLabel>
+#include <QList>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QTimer>
 #include <QWidget>
 
 QT_BEGIN_NAMESPACE
@@ -36,11 +40,25 @@ class Canvas : public QWidget
     Q_OBJECT
 
     /// Items to help display, size and scale the image
-    QLabel *imageHolder;
     QPoint canvasSize;
     QPoint offset;
     float scaleFactor;
 
+    /// Widget sized buffer the visible part of the sprite is magnified into before it's put on screen
+    QImage backBuffer;
+
+    /// Mouse positions (in sprite space) received since the last batch was sent, and the timer that
+    /// sends them once per display refresh
+    QList<QPoint> pendingMoves;
+    QTimer moveBatchTimer;
+
+    /// Profiler overlay drawn over the top left corner, the area it last covered, the timer that
+    /// refreshes it, and the time since the last repaint
+    bool showOverlay;
+    QRect overlayArea;
+    QTimer overlayTimer;
+    QElapsedTimer frameClock;
+
 public:
     explicit Canvas(QWidget *parent = nullptr);
 
@@ -49,9 +67,19 @@ public:
     void setScale(float);
     void setOffset(QPoint);
 
+    /// Getters for canvas properties
+    float getScale();
+    QPoint getOffset();
+
     /// Update the canvas display
     void update();
 
+    /// Repaint only the part of the display covering `spriteRegion` (in sprite space)
+    void updateSpriteRegion(QRect spriteRegion);
+
+    /// Show or hide the profiler's timings over the canvas
+    void setOverlayVisible(bool visible);
+
     /// Image to be displayed on the canvas
     QImage *imageToDisplay;
 
@@ -65,6 +93,9 @@ protected:
     void mouseReleaseEvent(QMouseEvent *event);
     void wheelEvent(QWheelEvent *event);
 
+    /// Draws the visible, magnified part of the image that lies inside the damaged area
+    void paintEvent(QPaintEvent *event);
+
     /// Generic event handler for events
     bool event(QEvent *event);
 
@@ -72,6 +103,9 @@ private:
     /// Convert canvas space coordinates to sprite space coordinates
     QPoint canvasToSpriteSpace(QPoint canvasSpace);
 
+    /// Convert a rectangle of sprite pixels to the canvas space rectangle it is displayed in
+    QRect spriteToCanvasSpace(QRect spriteSpace);
+
     /// Event handlers
     void gestureEvent(QGestureEvent *event);
     void pinchEvent(QPinchGesture *event);
@@ -79,10 +113,16 @@ private:
     /// Zoom at a specific point on the canvas
     void zoomAtPoint(float scaleFactorMultiplier, QPointF mousePos);
 
+    /// Sends every mouse position received since the last batch
+    void flushMoves();
+
+    /// Draws the profiler's timings over the canvas
+    void paintOverlay(QPainter &painter);
+
 signals:
     /// Signals for notifying about mouse interactions on the canvas
     void canvasMousePressed(QPoint spriteMouseLocation);
-    void canvasMouseMoved(QPoint spriteMouseLocation);
+    void canvasMouseMoved(const QList<QPoint> &spriteMouseLocations);
     void canvasMouseReleased(QPoint spriteMouseLocation);
 };
 
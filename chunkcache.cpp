@@ -0,0 +1,59 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ChunkCache Source
+ *
+ * Brief:
+ * The ChunkCache remembers the compressed chunk of every
+ * frame and layer written by the last save, keyed by the
+ * QImage::cacheKey() of the image it was compressed from.
+ * A QImage gets a new key whenever its pixels change, so
+ * the next save can write the chunks of everything that
+ * wasn't edited as they are, and only compress the rest.
+ *
+*/
+
+#include <QMutexLocker>
+
+#include "chunkcache.h"
+
+/**
+ * @brief ChunkCache::find - Looks up the chunk saved for an image. Writing to an image's pixels gives it a
+ * new cacheKey(), so a chunk found here always matches the image
+ * @param image
+ * @return The chunk, or an empty chunk if there is none
+ */
+FrameChunk ChunkCache::find(const QImage &image) const
+{
+    if (image.isNull())
+    {
+        return FrameChunk();
+    }
+
+    QMutexLocker lock(&mutex);
+    return chunks.value(image.cacheKey());
+}
+
+/**
+ * @brief ChunkCache::replace - Swaps in the chunks of the latest save. Chunks of images that weren't part
+ * of it are dropped, so the cache never holds more than one project file's worth of chunks
+ * @param newChunks
+ */
+void ChunkCache::replace(QHash<qint64, FrameChunk> newChunks)
+{
+    QMutexLocker lock(&mutex);
+    chunks = std::move(newChunks);
+}
+
+/**
+ * @brief ChunkCache::clear - Forgets every chunk, such as when a different project is opened
+ */
+void ChunkCache::clear()
+{
+    QMutexLocker lock(&mutex);
+    chunks.clear();
+}
@@ -0,0 +1,47 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ChunkCache Header
+ *
+ * Brief:
+ * The ChunkCache remembers the compressed chunk of every
+ * frame and layer written by the last save, keyed by the
+ * QImage::cacheKey() of the image it was compressed from.
+ * A QImage gets a new key whenever its pixels change, so
+ * the next save can write the chunks of everything that
+ * wasn't edited as they are, and only compress the rest.
+ *
+*/
+
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+
+#include "framechunk.h"
+
+class ChunkCache
+{
+public:
+    /// Returns the chunk last saved for `image`, or an empty chunk if it was edited since or never saved
+    FrameChunk find(const QImage &image) const;
+
+    /// Replaces everything cached with `chunks`, keyed by the cacheKey() of the image each one holds
+    void replace(QHash<qint64, FrameChunk> chunks);
+
+    /// Forgets every chunk
+    void clear();
+
+private:
+    /// Saves run in the background while the editor looks chunks up
+    mutable QMutex mutex;
+    QHash<qint64, FrameChunk> chunks;
+};
+
+#endif // CHUNKCACHE_H
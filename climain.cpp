@@ -0,0 +1,123 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Command-line tool
+ *
+ * Brief:
+ * Entry point of piss-cli, which converts, exports, resizes
+ * and recolours project files without opening a window, so
+ * sprites can be processed on machines without a display.
+ *
+ * Usage:
+ *   piss-cli convert      <files...> [-o dir]
+ *   piss-cli export-png   <files...> [-o dir]
+ *   piss-cli export-sheet <files...> [-o dir] [--columns n]
+ *   piss-cli export-atlas <files...> [-o dir] [--max-size n] [--padding n] [--no-trim]
+ *   piss-cli export-gif   <files...> [-o dir]
+ *   piss-cli export-apng  <files...> [-o dir]
+ *   piss-cli resize       <files...> [-o dir] --size WxH
+ *   piss-cli recolor      <files...> [-o dir] --from #rrggbb --to #rrggbb [--tolerance n]
+ *
+*/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QMutex>
+#include <QTextStream>
+#include <map>
+
+#include "batchprocessor.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("piss-cli");
+
+    const std::map<QString, BatchOperation> commands = {
+        {"convert", BatchOperation::Convert},
+        {"export-png", BatchOperation::ExportFrames},
+        {"export-sheet", BatchOperation::ExportSheet},
+        {"export-atlas", BatchOperation::ExportAtlas},
+        {"export-gif", BatchOperation::ExportAnimation},
+        {"export-apng", BatchOperation::ExportAnimation},
+        {"resize", BatchOperation::Resize},
+        {"recolor", BatchOperation::Recolor},
+    };
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts and exports Pixel Image Software Suite projects.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "convert, export-png, export-sheet, export-atlas, export-gif, export-apng, resize or recolor");
+    parser.addPositionalArgument("files", "The .ssp projects to process", "<files...>");
+
+    QCommandLineOption outputOption({"o", "output"}, "Directory to write results to.", "dir", ".");
+    QCommandLineOption jobsOption({"j", "jobs"}, "How many files to process at once.", "n", "0");
+    QCommandLineOption sizeOption("size", "New frame size, for resize.", "WxH");
+    QCommandLineOption fromOption("from", "Color to replace, for recolor.", "color");
+    QCommandLineOption toOption("to", "Color to replace it with, for recolor.", "color");
+    QCommandLineOption toleranceOption("tolerance", "How far a color may be from --from (0-255).", "n", "0");
+    QCommandLineOption columnsOption("columns", "Frames per row, for export-sheet.", "n", "0");
+    QCommandLineOption maxSizeOption("max-size", "Largest page size, for export-atlas.", "n", "2048");
+    QCommandLineOption paddingOption("padding", "Pixels between frames, for export-atlas.", "n", "1");
+    QCommandLineOption noTrimOption("no-trim", "Keep empty borders, for export-atlas.");
+    parser.addOptions({outputOption, jobsOption, sizeOption, fromOption, toOption, toleranceOption, columnsOption,
+                       maxSizeOption, paddingOption, noTrimOption});
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QStringList arguments = parser.positionalArguments();
+    if (arguments.size() < 2 || commands.count(arguments.first()) == 0)
+    {
+        err << parser.helpText();
+        return 2;
+    }
+
+    BatchProcessor::Options options;
+    QString command = arguments.takeFirst();
+    options.operation = commands.at(command);
+    options.animationFormat = command == "export-apng" ? AnimationFormat::Apng : AnimationFormat::Gif;
+    options.outputDirectory = parser.value(outputOption);
+    options.jobs = parser.value(jobsOption).toInt();
+    options.tolerance = qBound(0, parser.value(toleranceOption).toInt(), 255);
+    options.columns = parser.value(columnsOption).toInt();
+    options.atlas.maxPageSize = qMax(1, parser.value(maxSizeOption).toInt());
+    options.atlas.padding = qMax(0, parser.value(paddingOption).toInt());
+    options.atlas.trim = !parser.isSet(noTrimOption);
+
+    if (options.operation == BatchOperation::Resize)
+    {
+        QStringList size = parser.value(sizeOption).split('x');
+        options.size = size.size() == 2 ? QSize(size[0].toInt(), size[1].toInt()) : QSize();
+        if (options.size.isEmpty())
+        {
+            err << "resize needs --size WxH\n";
+            return 2;
+        }
+    }
+
+    if (options.operation == BatchOperation::Recolor)
+    {
+        options.fromColor = QColor(parser.value(fromOption));
+        options.toColor = QColor(parser.value(toOption));
+        if (!options.fromColor.isValid() || !options.toColor.isValid())
+        {
+            err << "recolor needs --from and --to colors, like #ff0000\n";
+            return 2;
+        }
+    }
+
+    // Files finish on different threads, so lines are written one at a time
+    QMutex outputLock;
+    QTextStream out(stdout);
+    int failures = BatchProcessor::run(arguments, options, [&](const QString &message) {
+        QMutexLocker locker(&outputLock);
+        out << message << Qt::endl;
+    });
+
+    return failures == 0 ? 0 : 1;
+}
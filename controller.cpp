@@ -16,16 +16,16 @@
  *
 */
 
-#include <QBuffer>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QPainter>
+#include <QCoreApplication>
+#include <QFile>
+#include <QtConcurrent>
 
 #include "controller.h"
 #include "canvas.h"
 #include "mainwindow.h"
 #include "model.h"
+#include "palette.h"
+#include "projectfile.h"
 
 /**
  * @brief Controller::Controller - Constructor
@@ -36,9 +36,9 @@ Controller::Controller(Model &model, MainWindow &view)
     : model(model)
     , view(view)
 {
-    currentImage = model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex());
-    view.canvas()->setImage(&currentImage);
+    showFrame(model.getCanvasSettings().getCurrentFrameIndex());
     setupConnections();
+    recoverAutosave();
 }
 
 /**
@@ -51,6 +51,9 @@ void Controller::setupConnections()
     setupFileManagement();
     setupFrameManagement();
     setupAnimationConnections();
+    setupLayerConnections();
+    setupPaletteConnections();
+    setupAutosaveConnections();
 }
 
 /**
@@ -61,20 +64,17 @@ void Controller::setupUndoConnections()
     Canvas *canvas = view.canvas();
 
     connect(canvas, &Canvas::canvasMousePressed, this, [this]() {
-        model.addUndoStack(&currentImage);
+        model.beginStroke(currentImage);
     });
 
     connect(canvas, &Canvas::canvasMouseReleased, this, [this]() {
-        model.updateFrame(&currentImage);
+        model.endStroke(currentImage);
     });
 
     connect(&view, &MainWindow::undoAction, this, [this]() { model.undo(); });
     connect(&view, &MainWindow::redoAction, this, [this]() { model.redo(); });
 
-    connect(&model, &Model::updateCanvas, this, [this](QImage image) {
-        currentImage = image;
-        view.canvas()->setImage(&currentImage);
-    });
+    connect(&model, &Model::updateCanvas, this, &Controller::showFrame);
 }
 
 /**
@@ -85,21 +85,28 @@ void Controller::setupDrawConnections()
     Canvas *canvas = view.canvas();
 
     connect(this, &Controller::drawOnEvent, &model, &Model::recieveDrawOnEvent);
+    connect(this, &Controller::drawStrokeEvent, &model, &Model::recieveStrokeEvent);
 
     connect(&view, &MainWindow::setPenColor, &model, &Model::recievePenColor);
     connect(&view, &MainWindow::selectActiveTool, &model, &Model::recieveActiveTool);
     connect(&view, &MainWindow::selectBrushSettings, &model, &Model::recieveBrushSettings);
+    connect(&view, &MainWindow::selectFillSettings, &model, &Model::recieveFillSettings);
+    connect(&view, &MainWindow::selectBrushShape, &model, &Model::recieveBrushShape);
 
     connect(&model, &Model::sendColor, &view, &MainWindow::recieveNewColor);
 
-    connect(canvas, &Canvas::canvasMousePressed, this, [this, canvas](QPoint pos) {
-        emit drawOnEvent(currentImage, pos);
-        canvas->update();
+    // Only the part of the sprite a tool actually changed gets repainted, and on a frame with layers
+    // only that part is flattened again first
+    connect(&model, &Model::imageRegionChanged, this, &Controller::refreshComposite);
+    connect(&model, &Model::imageRegionChanged, canvas, &Canvas::updateSpriteRegion);
+
+    connect(canvas, &Canvas::canvasMousePressed, this, [this](QPoint pos) {
+        emit drawOnEvent(*currentImage, pos);
     });
 
-    connect(canvas, &Canvas::canvasMouseMoved, this, [this, canvas](QPoint pos) {
-        emit drawOnEvent(currentImage, pos);
-        canvas->update();
+    // Moves arrive in batches, once per display refresh, and are drawn as one connected stroke
+    connect(canvas, &Canvas::canvasMouseMoved, this, [this](const QList<QPoint> &positions) {
+        emit drawStrokeEvent(*currentImage, positions);
     });
 }
 
@@ -108,100 +115,133 @@ void Controller::setupDrawConnections()
  */
 void Controller::setupFileManagement()
 {
-    // Save file connections
+    // Save file connections. Frames are compressed on worker threads, so the editor stays usable
     connect(&view, &MainWindow::saveFile, this, [this](QString fileDirectory) {
-
-        // Save the current frame before saving conventions
-        model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex()) = currentImage;
-
-        QFile file(fileDirectory);
-        QVector<QByteArray> imageDataArray;
-        QByteArray bufferArray;
-
-        // For every frame in the model, convert the QImage frame into
-        // an array of bytes. Add that array to a vector
-        for (uint i = 0; i < model.getFrames().numFrames(); i++) {
-            QBuffer buffer(&bufferArray);
-            buffer.open(QIODevice::WriteOnly);
-            model.getFrames().get(i).save(&buffer, "PNG");
-            imageDataArray.push_back(bufferArray);
-            bufferArray.clear();
+        if (saveWatcher.isRunning()) {
+            view.showStatus("Still saving the previous file, try again in a moment");
+            return;
         }
 
-        // Add each byte array, representing QImage data, into a json Array
-        QJsonArray jsonArray;
-        for (int i = 0; i < imageDataArray.size(); i++) {
-            QJsonObject imageObject;
-            imageObject.insert("QImage", QString(imageDataArray.at(i).toHex()));
-            imageObject["QImage"] = QString(imageDataArray.at(i).toHex());
-            jsonArray.insert(i, imageObject);
-        }
+        // Save the view settings before saving conventions
+        model.getCanvasSettings().setZoom(view.canvas()->getScale());
+        model.getCanvasSettings().setPosition(QVector2D(view.canvas()->getOffset()));
 
-        // Add the json Array into a json Document, adding that document into
-        // the new file
-        QJsonDocument jsonDoc;
-        jsonDoc.setArray(jsonArray);
-        file.open(QIODevice::WriteOnly);
-        file.write(jsonDoc.toJson());
-        file.close();
+        // Every edit journaled so far is in the snapshot, so the journal can drop them once it's saved
+        savePosition = journal.position();
+        saveBase = journal.basePath();
+        savePath = fileDirectory;
+        saveWatcher.setFuture(ProjectFile::writeAsync(fileDirectory, ProjectFile::snapshot(model)));
     });
 
-    // Load file connections
-    connect(&view, &MainWindow::loadFile, this, [this](QString fileDirectory) {
-        QFile sessionDataFile(fileDirectory);
-        QString jsonString;
+    connect(&saveWatcher, &QFutureWatcher<bool>::progressValueChanged, this, [this](int framesDone) {
+        view.showStatus(QString("Saving frame %1 of %2").arg(framesDone).arg(saveWatcher.progressMaximum()));
+    });
 
-        // Check if the file is actually opened
-        if (sessionDataFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            jsonString = sessionDataFile.readAll();
-            sessionDataFile.close();
+    connect(&saveWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        if (saveWatcher.result()) {
+            if (journal.basePath() == saveBase) {
+                journal.checkpointed(savePosition, savePath);
+            }
+            view.showStatus("Saved", 3000);
         } else {
-            qDebug() << "file could not be opened! Did you select the proper directory?";
+            qDebug() << "file could not be saved! Did you select the proper directory?";
+            view.showStatus("File could not be saved", 3000);
+        }
+
+        if (checkpointQueued) {
+            runCheckpoint();
+        }
+    });
+
+    // Export connections. Frames are streamed to the encoder in the background, one at a time
+    connect(&view, &MainWindow::exportAnimation, this, [this](QString filePath) {
+        if (exportWatcher.isRunning()) {
+            view.showStatus("Still exporting, try again in a moment");
             return;
         }
 
-        // Initialize java objects necessary for json serialization
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonString.toUtf8());
-        QJsonArray imageArray = jsonDoc.array();
-        QJsonObject tempObj;
-        QByteArray tempByteArray;
-        QImage tempImage;
+        exportWatcher.setFuture(AnimationExporter::writeAsync(filePath,
+                                                              ProjectFile::snapshot(model),
+                                                              AnimationExporter::formatFor(filePath)));
+    });
 
-        // Clear out all the current frames before loading new ones
-        model.getFrames().clearFrames();
+    connect(&view, &MainWindow::exportAtlas, this, [this](QString filePath) {
+        if (exportWatcher.isRunning()) {
+            view.showStatus("Still exporting, try again in a moment");
+            return;
+        }
+
+        view.showStatus("Packing sprite atlas");
+        ProjectFile::Project project = ProjectFile::snapshot(model);
+        exportWatcher.setFuture(QtConcurrent::run([filePath, project]() {
+            return AtlasPacker::write(filePath, AtlasPacker::pack(project, AtlasPacker::Settings()));
+        }));
+    });
 
-        for (auto imageData : imageArray) {
-            // Extract the "QImage" hex string data from the json object
-            QString jsonString = imageData.toObject().value("QImage").toString();
+    connect(&exportWatcher, &QFutureWatcher<bool>::progressValueChanged, this, [this](int framesDone) {
+        view.showStatus(QString("Exporting frame %1 of %2").arg(framesDone).arg(exportWatcher.progressMaximum()));
+    });
 
-            // Convert hex back into a byte string
-            tempObj = imageData.toObject();
-            tempByteArray = tempByteArray.fromHex(jsonString.toLatin1());
+    connect(&exportWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        view.showStatus(exportWatcher.result() ? "Exported" : "Could not export", 3000);
+    });
 
-            // Load the byte string data into the temporary image, add image to frames
-            tempImage.loadFromData(tempByteArray);
-            model.getFrames().push(tempImage);
-            tempByteArray.clear();
+    // Load file connections. Frames are decompressed on worker threads, and the model is only
+    // replaced once the whole project has been read
+    connect(&view, &MainWindow::loadFile, this, [this](QString fileDirectory) {
+        if (loadWatcher.isRunning()) {
+            view.showStatus("Still opening the previous file, try again in a moment");
+            return;
         }
 
-        // Default the canvas settings, set the current image to the first image in the frames vector,
-        // update the canvas to display the first image
-        model.getCanvasSettings().setCurrentFrameIndex(0);
-        currentImage = model.getFrames().get(0);
-        view.canvas()->setImage(&currentImage);
-        view.addFramesToList(model.getFrames().numFrames() - 1);
+        loadPath = fileDirectory;
+        loadWatcher.setFuture(ProjectFile::readAsync(fileDirectory));
+    });
+
+    connect(&loadWatcher, &QFutureWatcher<ProjectFile::Project>::progressValueChanged, this, [this](int framesDone) {
+        view.showStatus(QString("Opening frame %1 of %2").arg(framesDone).arg(loadWatcher.progressMaximum()));
+    });
+
+    connect(&loadWatcher, &QFutureWatcher<ProjectFile::Project>::finished, this, [this]() {
+        ProjectFile::Project project = loadWatcher.result();
+        if (!project.isValid()) {
+            qDebug() << "file could not be opened! Did you select the proper directory?";
+            view.showStatus("File could not be opened", 3000);
+            return;
+        }
+
+        ProjectFile::restore(project, model);
+        journal.open(loadPath);
+        view.showStatus("Opened", 3000);
+
+        // Restore the saved view settings, set the current image to the saved current frame and
+        // update the canvas to display it
+        Model::CanvasData &settings = model.getCanvasSettings();
+        view.canvas()->setScale(settings.getZoom());
+        view.canvas()->setOffset(settings.getPosition().toPoint());
+        view.showFPS(model.getFPS());
+
+        showFrame(settings.getCurrentFrameIndex());
+        view.showFrameList(model.getFrames().numFrames(), settings.getCurrentFrameIndex());
+        view.showIndexedColor(model.getFrames().isIndexed());
     });
 
     // New file connections
     connect(&view, &MainWindow::newFile, this, [this]() {
         // Delete all frames and generate a default 64 x 64 frame
         model.getFrames().clearFrames();
+        model.clearBuffers();
         model.getFrames().generateFrame(64, 64);
 
+        // The new document is checkpointed on its own until it's saved
+        QFile::remove(Journal::untitledProjectPath());
+        journal.open(Journal::untitledProjectPath());
+
         // Default the current index and image
         model.getCanvasSettings().setCurrentFrameIndex(0);
-        currentImage = model.getFrames().get(0);
-        view.canvas()->setImage(&currentImage);
+        showFrame(0);
+        view.requestVisibleThumbnails();
+        view.showIndexedColor(false);
     });
 }
 
@@ -211,90 +251,81 @@ void Controller::setupFileManagement()
 void Controller::setupFrameManagement()
 {
     connect(&view, &MainWindow::addFrame, this, [this]() {
-        // Save the current frame
-        model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex()) = currentImage;
-
-        // Generate a new frame and add to the canvas index.
-        model.getFrames().generateFrame(currentImage.width(), currentImage.height());
-        model.getCanvasSettings().setCurrentFrameIndex(model.getFrames().numFrames() - 1);
+        // Generate a new frame and make it the current frame
+        model.addFrame();
 
         // Set the current image and update canvas
-        currentImage = model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex());
-        view.canvas()->setImage(&currentImage);
+        showFrame(model.getCanvasSettings().getCurrentFrameIndex());
     });
 
     connect(&view, &MainWindow::deleteFrame, this, [this]() {
         uint currentFrameIndex = model.getCanvasSettings().getCurrentFrameIndex();
-
-        // Save the current frame
-        model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex()) = currentImage;
-
-        model.getFrames().remove(currentFrameIndex);
-
-        // Only modify the currentFrameIndex if the current frame is not the first (index 0)
-        if (currentFrameIndex > 0) {
-            model.getCanvasSettings().setCurrentFrameIndex(currentFrameIndex - 1);
-        }
+        model.deleteFrame(currentFrameIndex);
 
         // Set the current image and update canvas
-        currentImage = model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex());
-        view.canvas()->setImage(&currentImage);
+        showFrame(model.getCanvasSettings().getCurrentFrameIndex());
     });
 
     connect(&view, &MainWindow::setFrame, this, [this](int frameIndex) {
-        //Clear undo and redo buffers when switching frames
-        model.clearBuffers();
-
-        // Save the current frame
-        model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex()) = currentImage;
-
-        // Clear undo / redo button buffers when changing to a new image
-        model.redoBuffer.clear();
-        model.undoBuffer.clear();
-
+        // The undo history is kept, since it knows which frame each change is on
         model.getCanvasSettings().setCurrentFrameIndex(frameIndex);
 
         // Set the current image and update canvas
-        currentImage = model.getFrames().get(frameIndex);
-        view.canvas()->setImage(&currentImage);
+        showFrame(frameIndex);
     });
 
     connect(&view, &MainWindow::moveFrame, this, [this](int firstFrame, int secondFrame) {
-        // Save the current frame
-        model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex()) = currentImage;
-
         // Swap frames and set the new current frame index
-        model.getFrames().swap(firstFrame, secondFrame);
-        model.getCanvasSettings().setCurrentFrameIndex(secondFrame);
+        model.moveFrame(firstFrame, secondFrame);
 
         // Set the current image and update canvas
-        currentImage = model.getFrames().get(secondFrame);
-        view.canvas()->setImage(&currentImage);
+        showFrame(secondFrame);
     });
 
-    connect(&view, &MainWindow::resizeCanvas, this, [this](int width, int height) {
-        // Save the current frame
-        model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex()) = currentImage;
+    connect(&view, &MainWindow::resizeCanvas, this, [this](int width, int height, ResizeAnchor anchor) {
+        model.resizeFrames(width, height, anchor);
 
-        // Resize all existing frames individually
-        for (int i = 0; i < model.getFrames().numFrames(); ++i) {
-            QImage& frame = model.getFrames().get(i);
-            QImage resizedImage(width, height, QImage::Format_RGB32);
-            resizedImage.fill(QColor(Qt::white));
+        // Set the current image and update canvas
+        showFrame(model.getCanvasSettings().getCurrentFrameIndex());
+    });
 
-            // Copy the desired portion from the original frame to the resized frame
-            QPainter painter(&resizedImage);
-            painter.drawImage(QPoint(0, 0), frame.copy(0, 0, width, height));
-            painter.end();
+    connect(&view, &MainWindow::scaleCanvas, this, [this](int width, int height, ScaleFilter filter) {
+        model.scaleFrames(width, height, filter);
+        showFrame(model.getCanvasSettings().getCurrentFrameIndex());
+    });
 
-            // Update the frame in the model
-            frame = resizedImage;
+    connect(&view, &MainWindow::filterFrames, this, [this](const FrameFilter::Settings &settings) {
+        model.filterFrames(settings);
+        showFrame(model.getCanvasSettings().getCurrentFrameIndex());
+    });
+
+    // Resizing and filtering report progress from the GUI thread between batches of frames
+    connect(&model, &Model::framesTransformed, &view, &MainWindow::showProgress);
+
+    // Undoing a frame operation, or a stroke on another frame, changes which frames are listed
+    connect(&model, &Model::frameListChanged, &view, &MainWindow::showFrameList);
+
+    // Only the rows on screen ask for thumbnails. Frames that are only held compressed or tiled are
+    // put back together in the background along with the scaling
+    connect(&view, &MainWindow::thumbnailsNeeded, this, [this](int firstFrame, int lastFrame) {
+        Model::Frames &frames = model.getFrames();
+        for (int i = qMax(firstFrame, 0); i <= lastFrame && i < int(frames.numFrames()); i++) {
+            QImage frame = frames.isDecoded(i) ? frames.read(i) : QImage();
+            FrameChunk chunk = frame.isNull() ? frames.compressed(i) : FrameChunk();
+            TiledImage tiles = frame.isNull() && chunk.isEmpty() ? frames.tiled(i) : TiledImage();
+            thumbnails.request(i, frames.revision(i), frame, chunk, tiles, frames.getPalette());
         }
+    });
 
-        // Set the current image and update canvas
-        currentImage = model.getFrames().get(model.getCanvasSettings().getCurrentFrameIndex());
-        view.canvas()->setImage(&currentImage);
+    // A thumbnail finished after its frame was edited again or moved is stale, so it's not shown
+    connect(&thumbnails, &ThumbnailCache::thumbnailReady, this, [this](uint index, quint64 revision, const QImage &thumbnail) {
+        Model::Frames &frames = model.getFrames();
+        if (index < frames.numFrames() && frames.revision(index) == revision) {
+            view.showThumbnail(index, thumbnail);
+        }
     });
+
+    connect(&model, &Model::framesEdited, &view, &MainWindow::requestVisibleThumbnails);
 }
 
 /**
@@ -309,5 +340,264 @@ void Controller::setupAnimationConnections()
         model.updatePlay(!model.getPlayStatus());
     });
 
-    connect(&model, &Model::updateAnimationPreview, &view, &MainWindow::receiveAnimationFrameData);
+    // Previews are only scaled again once their frame has changed, so playback just swaps pixmaps
+    connect(&model, &Model::updateAnimationPreview, this, [this](uint frameIndex) {
+        Model::Frames &frames = model.getFrames();
+        view.playAnimation(previewCache.get(frameIndex,
+                                            frames.revision(frameIndex),
+                                            view.animationPreviewSize(),
+                                            [&frames, frameIndex]() { return frames.read(frameIndex); }));
+    });
+
+    connect(&model, &Model::frameListChanged, this, [this](int frameCount) {
+        previewCache.resize(frameCount);
+    });
+}
+
+/**
+ * @brief Controller::setupLayerConnections - Sets up connections related to the layers of the current frame
+ */
+void Controller::setupLayerConnections()
+{
+    connect(&view, &MainWindow::addLayer, this, [this]() {
+        editLayers([this]() { model.addLayer(); });
+    });
+
+    connect(&view, &MainWindow::deleteLayer, this, [this]() {
+        editLayers([this]() { model.deleteLayer(); });
+    });
+
+    connect(&view, &MainWindow::moveLayer, this, [this](int offset) {
+        editLayers([this, offset]() { model.moveLayer(offset); });
+    });
+
+    connect(&view, &MainWindow::selectLayer, this, [this](int offset) {
+        editLayers([this, offset]() { model.selectLayer(offset); });
+    });
+
+    connect(&view, &MainWindow::toggleLayerVisibility, this, [this]() {
+        editLayers([this]() {
+            LayerStack *stack = model.getFrames().layers(model.getCanvasSettings().getCurrentFrameIndex());
+            model.setLayerVisible(stack != nullptr && !stack->layer(stack->activeIndex()).visible);
+        });
+    });
+
+    connect(&view, &MainWindow::setLayerOpacity, this, [this](int percent) {
+        editLayers([this, percent]() { model.setLayerOpacity(percent / 100.0); });
+    });
+
+    connect(&view, &MainWindow::setLayerBlendMode, this, [this](BlendMode blendMode) {
+        editLayers([this, blendMode]() { model.setLayerBlendMode(blendMode); });
+    });
+}
+
+/**
+ * @brief Controller::setupPaletteConnections - Sets up connections related to indexed color and the
+ * shared palette
+ */
+void Controller::setupPaletteConnections()
+{
+    connect(&view, &MainWindow::setIndexedColor, this, [this](bool indexed) {
+        uint frameIndex = model.getCanvasSettings().getCurrentFrameIndex();
+        model.setIndexedColor(indexed);
+
+        showFrame(frameIndex);
+        if (indexed) {
+            view.showStatus(QString("Indexed color, %1 palette entries").arg(model.getFrames().getPalette().size()), 3000);
+        } else {
+            view.showStatus("32 bit color", 3000);
+        }
+    });
+
+    // The palette is shared, so replacing one entry recolors every frame that uses it at once
+    connect(&view, &MainWindow::replacePaletteColor, this, [this](QColor from, QColor to) {
+        Model::Frames &frames = model.getFrames();
+        uint frameIndex = model.getCanvasSettings().getCurrentFrameIndex();
+        model.setPaletteColor(Palette::nearest(frames.getPalette(), from.rgba()), to);
+
+        showFrame(frameIndex);
+    });
+
+    // Undoing a conversion switches color modes without going through the menu
+    connect(&model, &Model::framesEdited, this, [this]() {
+        view.showIndexedColor(model.getFrames().isIndexed());
+    });
+}
+
+/**
+ * @brief Controller::setupAutosaveConnections - Sets up journaling every edit, and checkpointing the journal
+ * into its project in the background
+ */
+void Controller::setupAutosaveConnections()
+{
+    model.setJournal(&journal);
+
+    // Asked for from inside an edit, so it's queued until the edit has been made
+    connect(&journal, &Journal::checkpointNeeded, this, &Controller::runCheckpoint, Qt::QueuedConnection);
+
+    checkpointTimer.setInterval(Journal::CHECKPOINT_INTERVAL_MS);
+    connect(&checkpointTimer, &QTimer::timeout, this, &Controller::runCheckpoint);
+    checkpointTimer.start();
+
+    connect(&checkpointWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        if (checkpointWatcher.result() && journal.basePath() == checkpointBase) {
+            journal.checkpointed(checkpointPosition, checkpointBase);
+        }
+
+        if (checkpointQueued) {
+            runCheckpoint();
+        }
+    });
+
+    // Closing normally leaves nothing to recover
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
+        checkpointWatcher.waitForFinished();
+        journal.discard();
+        QFile::remove(Journal::untitledProjectPath());
+    });
+}
+
+/**
+ * @brief Controller::recoverAutosave - Looks for the journal of a session that crashed. If there is one, its
+ * project is opened, or a blank document if it was never checkpointed, and the journaled edits are made
+ * again on top of it. The recovered edits are then checkpointed straight away. Otherwise a new journal is
+ * started for the blank document
+ */
+void Controller::recoverAutosave()
+{
+    Journal::Recovery recovery = Journal::recover();
+    if (recovery.isValid() && QFile::exists(recovery.basePath)) {
+        ProjectFile::Project project = ProjectFile::read(recovery.basePath);
+        if (project.isValid()) {
+            ProjectFile::restore(project, model);
+        } else {
+            recovery = Journal::Recovery();
+        }
+    }
+
+    if (!recovery.isValid()) {
+        QFile::remove(Journal::untitledProjectPath());
+        journal.open(Journal::untitledProjectPath());
+        return;
+    }
+
+    int replayed = model.replayJournal(recovery.records);
+    model.clearBuffers();
+    journal.resume(recovery);
+
+    Model::CanvasData &settings = model.getCanvasSettings();
+    view.canvas()->setScale(settings.getZoom());
+    view.canvas()->setOffset(settings.getPosition().toPoint());
+    view.showFPS(model.getFPS());
+
+    showFrame(settings.getCurrentFrameIndex());
+    view.showFrameList(model.getFrames().numFrames(), settings.getCurrentFrameIndex());
+    view.showIndexedColor(model.getFrames().isIndexed());
+    view.showStatus(QString("Recovered %1 unsaved edits").arg(replayed), 5000);
+
+    QTimer::singleShot(0, this, &Controller::runCheckpoint);
+}
+
+/**
+ * @brief Controller::runCheckpoint - Saves a snapshot of the project into the journal's project in the
+ * background, the same way saving does. Once it's written the journal drops the edits it holds. Nothing
+ * happens if no edits were made since the last checkpoint
+ */
+void Controller::runCheckpoint()
+{
+    if (!journal.needsCheckpoint()) {
+        return;
+    }
+
+    // Saves are written one at a time, so this waits for the running one
+    if (checkpointWatcher.isRunning() || saveWatcher.isRunning()) {
+        checkpointQueued = true;
+        return;
+    }
+    checkpointQueued = false;
+
+    model.getCanvasSettings().setZoom(view.canvas()->getScale());
+    model.getCanvasSettings().setPosition(QVector2D(view.canvas()->getOffset()));
+
+    checkpointPosition = journal.position();
+    checkpointBase = journal.basePath();
+    checkpointWatcher.setFuture(ProjectFile::writeAsync(checkpointBase, ProjectFile::snapshot(model)));
+}
+
+/**
+ * @brief Controller::showFrame - Makes a frame the one being edited. The tools draw on its active layer,
+ * while the canvas shows the layers flattened. A frame that is just one layer is shown as it is
+ * @param frameIndex
+ */
+void Controller::showFrame(uint frameIndex)
+{
+    Model::Frames &frames = model.getFrames();
+    currentImage = &frames.editBuffer(frameIndex);
+    view.showCanvasSize(currentImage->size());
+
+    // The old flattened image is let go of first, so the stack can composite into its cache without
+    // copying it
+    compositeImage = QImage();
+
+    LayerStack *stack = frames.layers(frameIndex);
+    if (stack != nullptr && !stack->isPassThrough()) {
+        compositeImage = stack->composite();
+        view.canvas()->setImage(&compositeImage);
+    } else {
+        view.canvas()->setImage(currentImage);
+    }
+}
+
+/**
+ * @brief Controller::refreshComposite - Flattens the part of the current frame a tool just drew on, using
+ * the image being drawn on in place of the active layer. Only the tiles under `region` are composited
+ * @param region - The sprite pixels that changed
+ */
+void Controller::refreshComposite(QRect region)
+{
+    LayerStack *stack = model.getFrames().layers(model.getCanvasSettings().getCurrentFrameIndex());
+    if (stack == nullptr || stack->isPassThrough()) {
+        return;
+    }
+
+    compositeImage = QImage();
+    stack->markDirty(region);
+    compositeImage = stack->composite();
+}
+
+/**
+ * @brief Controller::editLayers - Makes a layer change, then shows the frame again since which image the
+ * tools draw on may have changed
+ * @param edit - The layer change to make
+ */
+void Controller::editLayers(const std::function<void()> &edit)
+{
+    uint frameIndex = model.getCanvasSettings().getCurrentFrameIndex();
+
+    edit();
+
+    showFrame(frameIndex);
+    showLayerStatus();
+}
+
+/**
+ * @brief Controller::showLayerStatus - Shows the active layer of the current frame and its settings
+ */
+void Controller::showLayerStatus()
+{
+    LayerStack *stack = model.getFrames().layers(model.getCanvasSettings().getCurrentFrameIndex());
+    if (stack == nullptr) {
+        view.showStatus("This frame has no layers", 3000);
+        return;
+    }
+
+    const LayerStack::Layer &layer = stack->layer(stack->activeIndex());
+    view.showStatus(QString("Layer %1 of %2: %3, %4% %5%6")
+                        .arg(stack->activeIndex() + 1)
+                        .arg(stack->count())
+                        .arg(layer.name)
+                        .arg(qRound(layer.opacity * 100))
+                        .arg(LayerStack::blendModeName(layer.blendMode))
+                        .arg(layer.visible ? "" : ", hidden"),
+                    3000);
 }
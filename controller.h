@@ -19,18 +19,62 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include <QFutureWatcher>
 #include <QObject>
+#include <QTimer>
+#include <functional>
 
+#include "animationexporter.h"
+#include "atlaspacker.h"
+#include "journal.h"
 #include "mainwindow.h"
 #include "model.h"
+#include "previewcache.h"
+#include "projectfile.h"
+#include "thumbnailcache.h"
 
 class Controller : public QObject
 {
     Model &model;
     MainWindow &view;
 
-    /// Current image being manipulated
-    QImage currentImage;
+    /// Current image being manipulated: the current frame's edit buffer, which is its active layer or the
+    /// frame itself. The tools draw straight into the model's pixels, so it's never copied or stored back
+    QImage *currentImage = nullptr;
+
+    /// The current frame's layers flattened, shown on the canvas while it has layers
+    QImage compositeImage;
+
+    /// Saves and loads running in the background
+    QFutureWatcher<bool> saveWatcher;
+    QFutureWatcher<ProjectFile::Project> loadWatcher;
+    QFutureWatcher<bool> exportWatcher;
+
+    /// Scaled animation preview of each frame
+    PreviewCache previewCache;
+
+    /// Thumbnails shown in the frame list, made in the background
+    ThumbnailCache thumbnails;
+
+    /// The project being loaded
+    QString loadPath;
+
+    /// Journals every edit for crash recovery. It's checkpointed into the project in the background
+    /// every few minutes, or sooner once it has grown or can no longer be replayed
+    Journal journal;
+    QTimer checkpointTimer;
+    QFutureWatcher<bool> checkpointWatcher;
+
+    /// Where the journal was when the running checkpoint and save were snapshotted, and the project the
+    /// journal belonged to then. A snapshot of a project that has since been closed moves nothing
+    qint64 checkpointPosition = 0;
+    QString checkpointBase;
+    qint64 savePosition = 0;
+    QString saveBase;
+    QString savePath;
+
+    /// True if a checkpoint was asked for while the previous one or a save was still being written
+    bool checkpointQueued = false;
 
     Q_OBJECT
 
@@ -52,13 +96,45 @@ public:
 
     /// Setup connections related to animation
     void setupAnimationConnections();
+
+    /// Setup connections related to layers
+    void setupLayerConnections();
+
+    /// Setup connections related to the palette
+    void setupPaletteConnections();
+
+    /// Setup autosaving into the journal and its checkpoints
+    void setupAutosaveConnections();
 private:
     /// Setup connections related to drawing
     void setupDrawConnections();
 
+    /// Makes the frame at `frameIndex` the one being edited and shows it on the canvas
+    void showFrame(uint frameIndex);
+
+    /// Flattens `region` of the current frame's layers again, with `currentImage` as the active layer
+    void refreshComposite(QRect region);
+
+    /// Saves the current image into its frame, runs `edit` on the current frame's layers, then shows
+    /// the result
+    void editLayers(const std::function<void()> &edit);
+
+    /// Shows which layer of the current frame is active in the status bar
+    void showLayerStatus();
+
+    /// Replays the journal of a session that didn't close cleanly, or starts a new one
+    void recoverAutosave();
+
+    /// Writes a snapshot of the project into the journal's project in the background, so the journal
+    /// can drop the edits it holds
+    void runCheckpoint();
+
 signals:
     /// Signal to inform about drawing events
     void drawOnEvent(QImage &image, QPoint pos);
+
+    /// Signal to inform about a batch of mouse positions dragged through while drawing
+    void drawStrokeEvent(QImage &image, const QList<QPoint> &positions);
 };
 
 #endif // CONTROLLER_H
@@ -0,0 +1,49 @@
+# Sources shared by the editor (PISS.pro) and the command-line tool (piss-cli.pro).
+# Nothing in here needs a display, so it also builds against QCoreApplication.
+
+SOURCES += \
+    $$PWD/animationexporter.cpp \
+    $$PWD/apngencoder.cpp \
+    $$PWD/atlaspacker.cpp \
+    $$PWD/blitter.cpp \
+    $$PWD/brushmask.cpp \
+    $$PWD/chunkcache.cpp \
+    $$PWD/floodfill.cpp \
+    $$PWD/framefilter.cpp \
+    $$PWD/framechunk.cpp \
+    $$PWD/gifencoder.cpp \
+    $$PWD/journal.cpp \
+    $$PWD/layerstack.cpp \
+    $$PWD/model.cpp \
+    $$PWD/palette.cpp \
+    $$PWD/profiler.cpp \
+    $$PWD/projectfile.cpp \
+    $$PWD/resampler.cpp \
+    $$PWD/tiledimage.cpp \
+    $$PWD/tool.cpp \
+    $$PWD/toolbar.cpp \
+    $$PWD/undohistory.cpp
+
+HEADERS += \
+    $$PWD/animationexporter.h \
+    $$PWD/apngencoder.h \
+    $$PWD/atlaspacker.h \
+    $$PWD/blitter.h \
+    $$PWD/brushmask.h \
+    $$PWD/chunkcache.h \
+    $$PWD/enums.h \
+    $$PWD/floodfill.h \
+    $$PWD/framefilter.h \
+    $$PWD/framechunk.h \
+    $$PWD/gifencoder.h \
+    $$PWD/journal.h \
+    $$PWD/layerstack.h \
+    $$PWD/model.h \
+    $$PWD/palette.h \
+    $$PWD/profiler.h \
+    $$PWD/projectfile.h \
+    $$PWD/resampler.h \
+    $$PWD/tiledimage.h \
+    $$PWD/tool.h \
+    $$PWD/toolbar.h \
+    $$PWD/undohistory.h
@@ -20,4 +20,40 @@
 /// For defining types of tools
 enum class ToolType { Pen, Eraser, Eyedrop, Bucket };
 
+/// For defining the shape of the brush
+enum class BrushShape { Square, Circle };
+
+/// For defining which pixels the bucket fills
+enum class FillMode { FourConnected, EightConnected, ReplaceAll };
+
+/// For defining what the command-line tool does to each project
+enum class BatchOperation { Convert, ExportFrames, ExportSheet, ExportAtlas, ExportAnimation, Resize, Recolor };
+
+/// For defining which format animations are exported in
+enum class AnimationFormat { Gif, Apng };
+
+/// For defining how a layer is mixed with the layers below it
+enum class BlendMode { Normal, Multiply, Screen, Overlay, Darken, Lighten, Add };
+
+/// For defining which edge or corner stays in place when the canvas is cropped or extended
+enum class ResizeAnchor { TopLeft, Top, TopRight, Left, Center, Right, BottomLeft, Bottom, BottomRight };
+
+/// For defining how frames are scaled. Nearest scales to any size; the others are pixel art upscalers
+/// that only scale by their own factor and round off the stair steps of diagonal edges
+enum class ScaleFilter { Nearest, Scale2x, Scale3x, Scale4x };
+
+/// For defining which filter is run over every frame. The first three only change colors, so on indexed
+/// frames they edit the palette instead
+enum class FilterType { ReplaceColor, AdjustHsv, Invert, FlipHorizontal, FlipVertical, RotateClockwise,
+                        RotateCounterClockwise, Outline, DropShadow };
+
+/// For defining which edit a record in the autosave journal replays. A barrier marks an edit that can't
+/// be replayed, so replaying stops there
+enum class JournalAction { Stroke, AddFrame, DeleteFrame, MoveFrame, ResizeFrames, ScaleFrames, FilterFrames,
+                           AddLayer, DeleteLayer, MoveLayer, SelectLayer, SetLayerVisible, SetLayerOpacity,
+                           SetLayerBlendMode, SetIndexedColor, SetPaletteColor, Barrier };
+
+/// For defining types of changes stored in the undo history
+enum class HistoryAction { EditPixels, InsertFrame, RemoveFrame, SwapFrames, ResizeFrames, EditLayers, ConvertFrames, EditPalette };
+
 #endif // ENUMS_H
@@ -0,0 +1,269 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * FloodFill Source
+ *
+ * Brief:
+ * The FloodFill finds the pixels the Bucket tool fills,
+ * either the region connected to the clicked pixel or
+ * every pixel of the clicked color, as a list of
+ * horizontal spans that can be written in one pass.
+ *
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "blitter.h"
+#include "floodfill.h"
+#include "palette.h"
+
+/**
+ * @brief FloodFill::findRegion - Finds the pixels a fill starting at `seed` reaches. Pixels are read
+ * straight from the scanlines, so images that aren't 32 bits per pixel are searched as a converted copy
+ * @param image - The image being filled
+ * @param seed - The pixel that was clicked
+ * @param tolerance - How far each channel may be from the seed pixel, from 0 to 255
+ * @param mode - Whether to follow 4 or 8 connected neighbours, or to take every matching pixel
+ * @return The spans to fill, empty if `seed` is outside the image
+ */
+std::vector<FloodFill::Span> FloodFill::findRegion(const QImage &image,
+                                                   QPoint seed,
+                                                   int tolerance,
+                                                   FillMode mode)
+{
+    if (!image.rect().contains(seed))
+    {
+        return {};
+    }
+
+    if (image.depth() != 32)
+    {
+        return findRegion(image.convertToFormat(QImage::Format_ARGB32), seed, tolerance, mode);
+    }
+
+    if (mode == FillMode::ReplaceAll)
+    {
+        QRgb target = reinterpret_cast<const QRgb *>(image.constScanLine(seed.y()))[seed.x()];
+        return findMatching(image, target, tolerance);
+    }
+
+    return findConnected(image, seed, tolerance, mode == FillMode::EightConnected);
+}
+
+/**
+ * @brief FloodFill::findColor - Finds every pixel of a color anywhere in the image, such as for replacing
+ * one color with another across a whole project
+ * @param image - The image to search
+ * @param color - The color to look for
+ * @param tolerance - How far each channel may be from `color`, from 0 to 255
+ * @return The spans of every matching pixel
+ */
+std::vector<FloodFill::Span> FloodFill::findColor(const QImage &image, QColor color, int tolerance)
+{
+    if (image.depth() != 32)
+    {
+        return findColor(image.convertToFormat(QImage::Format_ARGB32), color, tolerance);
+    }
+
+    return findMatching(image, Blitter::packPixel(color, image.format()), tolerance);
+}
+
+/**
+ * @brief FloodFill::fillSpans - Writes `color` over every span, in the pixel format of `image`
+ * @param image - The image being filled. Indexed images are filled with the palette entry closest to
+ * `color`, and other formats are converted to 32 bits per pixel first
+ * @param spans - The spans found by `findRegion`
+ * @param color - The color to fill with
+ */
+void FloodFill::fillSpans(QImage &image, const std::vector<Span> &spans, QColor color)
+{
+    if (spans.empty())
+    {
+        return;
+    }
+
+    if (image.format() == QImage::Format_Indexed8)
+    {
+        uchar index = uchar(Palette::nearest(image.colorTable(), color.rgba()));
+        for (const Span &span : spans)
+        {
+            std::memset(image.scanLine(span.y) + span.left, index, span.right - span.left + 1);
+        }
+        return;
+    }
+
+    if (image.depth() != 32)
+    {
+        image.convertTo(QImage::Format_ARGB32);
+    }
+
+    quint32 pixel = Blitter::packPixel(color, image.format());
+
+    for (const Span &span : spans)
+    {
+        quint32 *row = reinterpret_cast<quint32 *>(image.scanLine(span.y));
+        Blitter::fillSpan(row + span.left, pixel, span.right - span.left + 1);
+    }
+}
+
+/**
+ * @brief FloodFill::bounds - Returns the smallest rectangle containing every span
+ * @param spans
+ * @return
+ */
+QRect FloodFill::bounds(const std::vector<Span> &spans)
+{
+    QRect area;
+    for (const Span &span : spans)
+    {
+        area |= QRect(QPoint(span.left, span.y), QPoint(span.right, span.y));
+    }
+    return area;
+}
+
+/**
+ * @brief FloodFill::matches - Returns true if no channel of `pixel` differs from `target` by more
+ * than `tolerance`
+ * @param pixel
+ * @param target
+ * @param tolerance
+ * @return
+ */
+bool FloodFill::matches(QRgb pixel, QRgb target, int tolerance)
+{
+    if (pixel == target)
+    {
+        return true;
+    }
+
+    return std::abs(qRed(pixel) - qRed(target)) <= tolerance
+           && std::abs(qGreen(pixel) - qGreen(target)) <= tolerance
+           && std::abs(qBlue(pixel) - qBlue(target)) <= tolerance
+           && std::abs(qAlpha(pixel) - qAlpha(target)) <= tolerance;
+}
+
+/**
+ * @brief FloodFill::findConnected - Span flood fill. Each seed popped off the stack is widened into the
+ * longest matching run on its row, then the rows above and below are scanned once across that run,
+ * pushing one new seed per matching run found there. Every pixel is visited a constant number of times
+ * and no recursion is used, so large regions can't overflow the call stack
+ * @param image - A 32 bit per pixel image
+ * @param seed - The pixel that was clicked
+ * @param tolerance - How far each channel may be from the seed pixel
+ * @param diagonal - True to also spread to diagonal neighbours
+ * @return The spans of the connected region
+ */
+std::vector<FloodFill::Span> FloodFill::findConnected(const QImage &image,
+                                                      QPoint seed,
+                                                      int tolerance,
+                                                      bool diagonal)
+{
+    int width = image.width();
+    int height = image.height();
+    QRgb target = reinterpret_cast<const QRgb *>(image.constScanLine(seed.y()))[seed.x()];
+
+    // Marks pixels that already belong to a span, since a tolerant fill can't tell them apart by color
+    std::vector<uchar> filled(size_t(width) * height, 0);
+    auto fillable = [&](const QRgb *row, const uchar *rowFilled, int x) {
+        return !rowFilled[x] && matches(row[x], target, tolerance);
+    };
+
+    std::vector<Span> spans;
+    std::vector<QPoint> stack;
+    stack.push_back(seed);
+
+    while (!stack.empty())
+    {
+        QPoint point = stack.back();
+        stack.pop_back();
+
+        int y = point.y();
+        const QRgb *row = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        uchar *rowFilled = filled.data() + size_t(y) * width;
+        if (!fillable(row, rowFilled, point.x()))
+        {
+            continue;
+        }
+
+        int left = point.x();
+        int right = point.x();
+        while (left > 0 && fillable(row, rowFilled, left - 1))
+        {
+            left--;
+        }
+        while (right < width - 1 && fillable(row, rowFilled, right + 1))
+        {
+            right++;
+        }
+
+        std::fill(rowFilled + left, rowFilled + right + 1, uchar(1));
+        spans.push_back({y, left, right});
+
+        int scanLeft = diagonal ? qMax(left - 1, 0) : left;
+        int scanRight = diagonal ? qMin(right + 1, width - 1) : right;
+
+        for (int neighbourY : {y - 1, y + 1})
+        {
+            if (neighbourY < 0 || neighbourY >= height)
+            {
+                continue;
+            }
+
+            const QRgb *neighbourRow = reinterpret_cast<const QRgb *>(image.constScanLine(neighbourY));
+            const uchar *neighbourFilled = filled.data() + size_t(neighbourY) * width;
+            bool inRun = false;
+            for (int x = scanLeft; x <= scanRight; x++)
+            {
+                bool match = fillable(neighbourRow, neighbourFilled, x);
+                if (match && !inRun)
+                {
+                    stack.push_back(QPoint(x, neighbourY));
+                }
+                inRun = match;
+            }
+        }
+    }
+
+    return spans;
+}
+
+/**
+ * @brief FloodFill::findMatching - Collects every run of pixels matching `target`, connected or not
+ * @param image - A 32 bit per pixel image
+ * @param target - The color of the pixel that was clicked
+ * @param tolerance - How far each channel may be from `target`
+ * @return The spans of every matching pixel
+ */
+std::vector<FloodFill::Span> FloodFill::findMatching(const QImage &image, QRgb target, int tolerance)
+{
+    std::vector<Span> spans;
+
+    for (int y = 0; y < image.height(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        int x = 0;
+        while (x < image.width())
+        {
+            if (!matches(row[x], target, tolerance))
+            {
+                x++;
+                continue;
+            }
+
+            int left = x;
+            while (x < image.width() && matches(row[x], target, tolerance))
+            {
+                x++;
+            }
+            spans.push_back({y, left, x - 1});
+        }
+    }
+
+    return spans;
+}
@@ -0,0 +1,64 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * FloodFill Header
+ *
+ * Brief:
+ * The FloodFill finds the pixels the Bucket tool fills,
+ * either the region connected to the clicked pixel or
+ * every pixel of the clicked color, as a list of
+ * horizontal spans that can be written in one pass.
+ *
+*/
+
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include <QColor>
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <vector>
+
+#include "enums.h"
+
+class FloodFill
+{
+public:
+    /// A horizontal run of pixels from `left` to `right` inclusive on row `y`
+    struct Span
+    {
+        int y;
+        int left;
+        int right;
+    };
+
+    /// Finds the pixels that a fill starting at `seed` reaches. A pixel matches when none of its
+    /// channels differ from the seed pixel by more than `tolerance`
+    static std::vector<Span> findRegion(const QImage &image, QPoint seed, int tolerance, FillMode mode);
+
+    /// Finds every pixel in the image within `tolerance` of `color`, connected or not
+    static std::vector<Span> findColor(const QImage &image, QColor color, int tolerance);
+
+    /// Writes `color` over every span
+    static void fillSpans(QImage &image, const std::vector<Span> &spans, QColor color);
+
+    /// Returns the smallest rectangle containing every span
+    static QRect bounds(const std::vector<Span> &spans);
+
+private:
+    /// Returns true if no channel of `pixel` differs from `target` by more than `tolerance`
+    static bool matches(QRgb pixel, QRgb target, int tolerance);
+
+    /// Span fill of the region connected to `seed`, using an explicit stack of seed pixels
+    static std::vector<Span> findConnected(const QImage &image, QPoint seed, int tolerance, bool diagonal);
+
+    /// Every run of pixels in the image that match the seed pixel
+    static std::vector<Span> findMatching(const QImage &image, QRgb target, int tolerance);
+};
+
+#endif // FLOODFILL_H
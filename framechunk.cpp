@@ -0,0 +1,121 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * FrameChunk Source
+ *
+ * Brief:
+ * A FrameChunk is one frame's pixels in compressed form,
+ * the way frames are stored in project files. A chunk
+ * can point straight into a memory-mapped project file,
+ * so frames can stay on disk until they are needed.
+ *
+*/
+
+#include <cstring>
+
+#include "framechunk.h"
+#include "profiler.h"
+
+/**
+ * @brief FrameChunk::isEmpty - Returns true if the chunk holds no frame
+ * @return
+ */
+bool FrameChunk::isEmpty() const
+{
+    return data.isEmpty();
+}
+
+/**
+ * @brief FrameChunk::encode - Packs the rows of a frame together, dropping any row padding, and
+ * compresses them
+ * @param frame
+ * @return The compressed chunk
+ */
+FrameChunk FrameChunk::encode(const QImage &frame)
+{
+    Profiler::Scope scope("frame encode");
+    int rowBytes = packedRowBytes(frame);
+    QByteArray packed(rowBytes * frame.height(), Qt::Uninitialized);
+
+    for (int y = 0; y < frame.height(); y++)
+    {
+        std::memcpy(packed.data() + y * rowBytes, frame.constScanLine(y), rowBytes);
+    }
+
+    FrameChunk chunk;
+    chunk.width = frame.width();
+    chunk.height = frame.height();
+    chunk.format = frame.format();
+    chunk.colorTable = frame.colorTable();
+    chunk.data = qCompress(packed, COMPRESSION_LEVEL);
+    return chunk;
+}
+
+/**
+ * @brief FrameChunk::decode - Decompresses the chunk and copies its rows into a new frame
+ * @return The frame, or a null image if the chunk doesn't match its size and format
+ */
+QImage FrameChunk::decode() const
+{
+    Profiler::Scope scope("frame decode");
+    if (width <= 0 || height <= 0 || format <= QImage::Format_Invalid
+        || format >= QImage::NImageFormats)
+    {
+        return QImage();
+    }
+
+    QImage frame(width, height, QImage::Format(format));
+    if (frame.isNull())
+    {
+        return QImage();
+    }
+
+    int rowBytes = packedRowBytes(frame);
+    QByteArray packed = qUncompress(data);
+    if (packed.size() != rowBytes * height)
+    {
+        return QImage();
+    }
+
+    for (int y = 0; y < frame.height(); y++)
+    {
+        std::memcpy(frame.scanLine(y), packed.constData() + y * rowBytes, rowBytes);
+    }
+
+    if (!colorTable.isEmpty())
+    {
+        frame.setColorTable(colorTable);
+    }
+    return frame;
+}
+
+/**
+ * @brief FrameChunk::detached - Copies the compressed bytes out of the mapped file, if any. Chunks are
+ * small compared to decoded frames, so this is cheap
+ * @return
+ */
+FrameChunk FrameChunk::detached() const
+{
+    FrameChunk chunk = *this;
+    if (mappedFile)
+    {
+        chunk.data = QByteArray(data.constData(), data.size());
+        chunk.mappedFile.reset();
+    }
+    return chunk;
+}
+
+/**
+ * @brief FrameChunk::packedRowBytes - Returns how many bytes of a row hold pixels. QImage pads every
+ * row to a multiple of 4 bytes, which doesn't need to be stored
+ * @param frame
+ * @return
+ */
+int FrameChunk::packedRowBytes(const QImage &frame)
+{
+    return (frame.width() * frame.depth() + 7) / 8;
+}
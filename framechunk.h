@@ -0,0 +1,65 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * FrameChunk Header
+ *
+ * Brief:
+ * A FrameChunk is one frame's pixels in compressed form,
+ * the way frames are stored in project files. A chunk
+ * can point straight into a memory-mapped project file,
+ * so frames can stay on disk until they are needed.
+ *
+*/
+
+#ifndef FRAMECHUNK_H
+#define FRAMECHUNK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QList>
+#include <memory>
+
+class FrameChunk
+{
+public:
+    /// Size and QImage::Format of the frame once decoded
+    qint32 width = 0;
+    qint32 height = 0;
+    qint32 format = QImage::Format_Invalid;
+
+    /// Palette of an indexed frame. It's kept apart from `data`, so a project stores it only once
+    QList<QRgb> colorTable;
+
+    /// zlib compressed, packed pixel rows
+    QByteArray data;
+
+    /// Keeps a memory-mapped project file open while `data` points into it
+    std::shared_ptr<QFile> mappedFile;
+
+    /// Returns true if the chunk holds no frame
+    bool isEmpty() const;
+
+    /// Compresses the pixels of a frame
+    static FrameChunk encode(const QImage &frame);
+
+    /// Decompresses the chunk. Returns a null image if the chunk is damaged
+    QImage decode() const;
+
+    /// Returns a copy of this chunk that owns its bytes instead of pointing into a mapped file
+    FrameChunk detached() const;
+
+private:
+    /// zlib level used for chunks. Pixel art is mostly long runs of one color, which even the
+    /// fastest level compresses well
+    static constexpr int COMPRESSION_LEVEL = 1;
+
+    /// Number of bytes of pixel data in one row of `frame`, without any padding
+    static int packedRowBytes(const QImage &frame);
+};
+
+#endif // FRAMECHUNK_H
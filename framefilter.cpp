@@ -0,0 +1,429 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * FrameFilter Source
+ *
+ * Brief:
+ * The FrameFilter runs one filter over a frame or layer:
+ * replacing a color, shifting hue, saturation and value,
+ * inverting, flipping, rotating, outlining or casting a
+ * drop shadow. The kernels work on scanlines in the
+ * image's own format, so indexed images stay indexed.
+ *
+*/
+
+#include <QColor>
+#include <QHash>
+#include <QTransform>
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "blitter.h"
+#include "framefilter.h"
+#include "palette.h"
+#include "profiler.h"
+
+/**
+ * @brief FrameFilter::apply - Runs a filter over one image. Color filters recolor the color table of indexed
+ * images without touching their pixels, and run over the pixels of 32 bit images. The other filters move or
+ * paint whole pixels, so they work on indices the same way as on colors
+ * @param image - The frame or layer to filter. Formats other than indexed and 32 bits per pixel are
+ * converted to ARGB32 premultiplied
+ * @param settings - Which filter to run, and how
+ * @return The filtered image
+ */
+QImage FrameFilter::apply(const QImage &image, const Settings &settings)
+{
+    Profiler::Scope scope("filter frame");
+
+    QImage source = image;
+    if (image.format() != QImage::Format_Indexed8 && image.format() != QImage::Format_RGB32
+        && image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        source = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    bool indexed = source.format() == QImage::Format_Indexed8;
+
+    switch (settings.type)
+    {
+    case FilterType::ReplaceColor:
+    case FilterType::AdjustHsv:
+    case FilterType::Invert:
+    {
+        QImage filtered = source;
+        if (indexed)
+        {
+            QList<QRgb> colors = filtered.colorTable();
+            for (int i = 0; i < int(colors.size()); i++)
+            {
+                if (i != Palette::TRANSPARENT_INDEX)
+                {
+                    colors[i] = mapColor(colors[i], settings);
+                }
+            }
+            filtered.setColorTable(colors);
+        }
+        else
+        {
+            mapPixels(filtered, settings);
+        }
+        return filtered;
+    }
+    case FilterType::FlipHorizontal:
+        return source.mirrored(true, false);
+    case FilterType::FlipVertical:
+        return source.mirrored(false, true);
+    case FilterType::RotateClockwise:
+        // Quarter turns are copied in cache sized blocks by Qt, keeping the format and color table
+        return source.transformed(QTransform().rotate(90));
+    case FilterType::RotateCounterClockwise:
+        return source.transformed(QTransform().rotate(-90));
+    case FilterType::Outline:
+    case FilterType::DropShadow:
+        break;
+    }
+
+    if (!indexed && !source.hasAlphaChannel())
+    {
+        return source;
+    }
+
+    QImage filtered = source.copy();
+    if (indexed)
+    {
+        QList<QRgb> colors = source.colorTable();
+        std::array<bool, 256> opaqueIndices;
+        for (int i = 0; i < 256; i++)
+        {
+            opaqueIndices[i] = i >= int(colors.size()) || qAlpha(colors[i]) > 0;
+        }
+        auto opaque = [&opaqueIndices](uchar pixel) { return opaqueIndices[pixel]; };
+        uchar paint = uchar(Palette::nearest(colors, settings.color));
+        if (settings.type == FilterType::Outline)
+        {
+            outline<uchar>(source, filtered, paint, opaque);
+        }
+        else
+        {
+            dropShadow<uchar>(source, filtered, paint, settings.offset, opaque);
+        }
+        return filtered;
+    }
+
+    // Premultiplied pixels keep their alpha in the top byte too
+    auto opaque = [](quint32 pixel) { return (pixel >> 24) != 0; };
+    quint32 paint = Blitter::packPixel(QColor::fromRgba(settings.color), source.format());
+    if (settings.type == FilterType::Outline)
+    {
+        outline<quint32>(source, filtered, paint, opaque);
+    }
+    else
+    {
+        dropShadow<quint32>(source, filtered, paint, settings.offset, opaque);
+    }
+    return filtered;
+}
+
+/**
+ * @brief FrameFilter::mapColor - Runs a color filter on one color. Alpha is always kept
+ * @param color - The color, not premultiplied
+ * @param settings - Which filter to run, and how
+ * @return The filtered color
+ */
+QRgb FrameFilter::mapColor(QRgb color, const Settings &settings)
+{
+    switch (settings.type)
+    {
+    case FilterType::ReplaceColor:
+        return color == settings.color ? settings.replacement : color;
+    case FilterType::Invert:
+        return color ^ 0x00ffffff;
+    case FilterType::AdjustHsv:
+    {
+        int hue, saturation, value, alpha;
+        QColor::fromRgba(color).getHsv(&hue, &saturation, &value, &alpha);
+        // Grays have no hue to turn
+        if (hue >= 0)
+        {
+            hue = ((hue + settings.hue) % 360 + 360) % 360;
+        }
+        saturation = std::clamp(saturation + settings.saturation * 255 / 100, 0, 255);
+        value = std::clamp(value + settings.value * 255 / 100, 0, 255);
+        return QColor::fromHsv(hue, saturation, value, alpha).rgba();
+    }
+    default:
+        return color;
+    }
+}
+
+/**
+ * @brief FrameFilter::mapsColors - Returns true for the filters that can be run on a palette instead of pixels
+ * @param type
+ * @return
+ */
+bool FrameFilter::mapsColors(FilterType type)
+{
+    return type == FilterType::ReplaceColor || type == FilterType::AdjustHsv || type == FilterType::Invert;
+}
+
+/**
+ * @brief FrameFilter::name - Returns the name shown to the user for a filter
+ * @param type
+ * @return
+ */
+QString FrameFilter::name(FilterType type)
+{
+    switch (type)
+    {
+    case FilterType::ReplaceColor:
+        return "Replace Color";
+    case FilterType::AdjustHsv:
+        return "Hue/Saturation/Value";
+    case FilterType::Invert:
+        return "Invert";
+    case FilterType::FlipHorizontal:
+        return "Flip Horizontal";
+    case FilterType::FlipVertical:
+        return "Flip Vertical";
+    case FilterType::RotateClockwise:
+        return "Rotate Clockwise";
+    case FilterType::RotateCounterClockwise:
+        return "Rotate Counterclockwise";
+    case FilterType::Outline:
+        return "Outline";
+    case FilterType::DropShadow:
+        return "Drop Shadow";
+    }
+    return QString();
+}
+
+/**
+ * @brief FrameFilter::mapPixels - Runs a color filter over every pixel of a 32 bit image in place.
+ * Replacing and inverting are done four pixels at a time. Shifting hue, saturation and value goes through
+ * QColor, so each distinct pixel is only converted once; pixel art has few colors and long runs of them
+ * @param image - The image to filter, in RGB32, ARGB32 or ARGB32 premultiplied
+ * @param settings - Which filter to run, and how
+ */
+void FrameFilter::mapPixels(QImage &image, const Settings &settings)
+{
+    bool premultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    quint32 from = Blitter::packPixel(QColor::fromRgba(settings.color), image.format());
+    quint32 to = Blitter::packPixel(QColor::fromRgba(settings.replacement), image.format());
+
+    QHash<quint32, quint32> mapped;
+    quint32 lastPixel = 0;
+    quint32 lastMapped = 0;
+    bool haveLast = false;
+
+    for (int y = 0; y < image.height(); y++)
+    {
+        quint32 *row = reinterpret_cast<quint32 *>(image.scanLine(y));
+        switch (settings.type)
+        {
+        case FilterType::ReplaceColor:
+            replaceSpan(row, image.width(), from, to);
+            break;
+        case FilterType::Invert:
+            // RGB32 pixels have an alpha byte of 0xff, so inverting against it is a plain invert
+            invertSpan(row, image.width(), premultiplied || image.format() == QImage::Format_RGB32);
+            break;
+        default:
+            for (int x = 0; x < image.width(); x++)
+            {
+                quint32 pixel = row[x];
+                if (!haveLast || pixel != lastPixel)
+                {
+                    auto found = mapped.constFind(pixel);
+                    if (found == mapped.constEnd())
+                    {
+                        QRgb color = premultiplied ? qUnpremultiply(pixel) : pixel;
+                        found = mapped.insert(pixel,
+                                              Blitter::packPixel(QColor::fromRgba(mapColor(color, settings)),
+                                                                 image.format()));
+                    }
+                    lastPixel = pixel;
+                    lastMapped = found.value();
+                    haveLast = true;
+                }
+                row[x] = lastMapped;
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * @brief FrameFilter::replaceSpan - Swaps one packed pixel value for another across a row
+ * @param pixels - The row
+ * @param count - How many pixels are in the row
+ * @param from - The pixel value to replace
+ * @param to - What it becomes
+ */
+void FrameFilter::replaceSpan(quint32 *pixels, int count, quint32 from, quint32 to)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i target = _mm_set1_epi32(int(from));
+    __m128i swapped = _mm_set1_epi32(int(to));
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        __m128i match = _mm_cmpeq_epi32(in, target);
+        __m128i out = _mm_or_si128(_mm_andnot_si128(match, in), _mm_and_si128(match, swapped));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), out);
+    }
+#elif defined(__ARM_NEON)
+    uint32x4_t target = vdupq_n_u32(from);
+    uint32x4_t swapped = vdupq_n_u32(to);
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32x4_t in = vld1q_u32(pixels + i);
+        vst1q_u32(pixels + i, vbslq_u32(vceqq_u32(in, target), swapped, in));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        if (pixels[i] == from)
+        {
+            pixels[i] = to;
+        }
+    }
+}
+
+/**
+ * @brief FrameFilter::invertSpan - Inverts the color channels of a row, keeping alpha. A premultiplied
+ * channel can't be more than its alpha, so it inverts to alpha minus itself, which never borrows
+ * @param pixels - The row
+ * @param count - How many pixels are in the row
+ * @param premultiplied - True to invert against alpha, false to invert against 255
+ */
+void FrameFilter::invertSpan(quint32 *pixels, int count, bool premultiplied)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i colorMask = _mm_set1_epi32(0x00ffffff);
+    __m128i alphaMask = _mm_set1_epi32(int(0xff000000));
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        __m128i out;
+        if (premultiplied)
+        {
+            __m128i alpha = _mm_srli_epi32(in, 24);
+            __m128i spread = _mm_or_si128(alpha, _mm_or_si128(_mm_slli_epi32(alpha, 8), _mm_slli_epi32(alpha, 16)));
+            out = _mm_or_si128(_mm_sub_epi32(spread, _mm_and_si128(in, colorMask)), _mm_and_si128(in, alphaMask));
+        }
+        else
+        {
+            out = _mm_xor_si128(in, colorMask);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), out);
+    }
+#elif defined(__ARM_NEON)
+    uint32x4_t colorMask = vdupq_n_u32(0x00ffffff);
+    uint32x4_t alphaMask = vdupq_n_u32(0xff000000);
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32x4_t in = vld1q_u32(pixels + i);
+        uint32x4_t out;
+        if (premultiplied)
+        {
+            uint32x4_t alpha = vshrq_n_u32(in, 24);
+            uint32x4_t spread = vorrq_u32(alpha, vorrq_u32(vshlq_n_u32(alpha, 8), vshlq_n_u32(alpha, 16)));
+            out = vorrq_u32(vsubq_u32(spread, vandq_u32(in, colorMask)), vandq_u32(in, alphaMask));
+        }
+        else
+        {
+            out = veorq_u32(in, colorMask);
+        }
+        vst1q_u32(pixels + i, out);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        quint32 alpha = pixels[i] >> 24;
+        pixels[i] = premultiplied ? ((alpha * 0x010101) - (pixels[i] & 0x00ffffff)) | (pixels[i] & 0xff000000)
+                                  : pixels[i] ^ 0x00ffffff;
+    }
+}
+
+/**
+ * @brief FrameFilter::outline - Paints a one pixel outline around everything opaque, on the transparent
+ * pixels that share an edge with an opaque one
+ * @param source - The image being outlined
+ * @param destination - A copy of `source` to paint the outline on
+ * @param paint - The outline pixel, packed for the format of `source`
+ * @param opaque - Returns true for a pixel that is opaque
+ */
+template <typename Pixel, typename Opaque>
+void FrameFilter::outline(const QImage &source, QImage &destination, Pixel paint, Opaque opaque)
+{
+    int width = source.width();
+    int height = source.height();
+    for (int y = 0; y < height; y++)
+    {
+        const Pixel *above = y > 0 ? reinterpret_cast<const Pixel *>(source.constScanLine(y - 1)) : nullptr;
+        const Pixel *row = reinterpret_cast<const Pixel *>(source.constScanLine(y));
+        const Pixel *below = y + 1 < height ? reinterpret_cast<const Pixel *>(source.constScanLine(y + 1)) : nullptr;
+        Pixel *out = reinterpret_cast<Pixel *>(destination.scanLine(y));
+
+        for (int x = 0; x < width; x++)
+        {
+            if (opaque(row[x]))
+            {
+                continue;
+            }
+            if ((x > 0 && opaque(row[x - 1])) || (x + 1 < width && opaque(row[x + 1]))
+                || (above != nullptr && opaque(above[x])) || (below != nullptr && opaque(below[x])))
+            {
+                out[x] = paint;
+            }
+        }
+    }
+}
+
+/**
+ * @brief FrameFilter::dropShadow - Paints a hard shadow of everything opaque, moved by `offset`, on the
+ * transparent pixels it lands on, so the shadow falls behind what casts it
+ * @param source - The image casting the shadow
+ * @param destination - A copy of `source` to paint the shadow on
+ * @param paint - The shadow pixel, packed for the format of `source`
+ * @param offset - How far the shadow falls
+ * @param opaque - Returns true for a pixel that is opaque
+ */
+template <typename Pixel, typename Opaque>
+void FrameFilter::dropShadow(const QImage &source, QImage &destination, Pixel paint, QPoint offset, Opaque opaque)
+{
+    int width = source.width();
+    int height = source.height();
+    int firstColumn = std::max(offset.x(), 0);
+    int lastColumn = std::min(width + offset.x(), width);
+    for (int y = std::max(offset.y(), 0); y < std::min(height + offset.y(), height); y++)
+    {
+        const Pixel *caster = reinterpret_cast<const Pixel *>(source.constScanLine(y - offset.y()));
+        const Pixel *row = reinterpret_cast<const Pixel *>(source.constScanLine(y));
+        Pixel *out = reinterpret_cast<Pixel *>(destination.scanLine(y));
+
+        for (int x = firstColumn; x < lastColumn; x++)
+        {
+            if (!opaque(row[x]) && opaque(caster[x - offset.x()]))
+            {
+                out[x] = paint;
+            }
+        }
+    }
+}
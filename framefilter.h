@@ -0,0 +1,85 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * FrameFilter Header
+ *
+ * Brief:
+ * The FrameFilter runs one filter over a frame or layer:
+ * replacing a color, shifting hue, saturation and value,
+ * inverting, flipping, rotating, outlining or casting a
+ * drop shadow. The kernels work on scanlines in the
+ * image's own format, so indexed images stay indexed.
+ *
+*/
+
+#ifndef FRAMEFILTER_H
+#define FRAMEFILTER_H
+
+#include <QImage>
+#include <QPoint>
+#include <QRgb>
+#include <QString>
+
+#include "enums.h"
+
+class FrameFilter
+{
+public:
+    /// What a filter does. Each filter only reads the fields it needs
+    struct Settings
+    {
+        FilterType type = FilterType::Invert;
+
+        /// The color replaced, or the color of an outline or drop shadow
+        QRgb color = 0;
+
+        /// The color a replaced color becomes
+        QRgb replacement = 0;
+
+        /// Degrees to turn the hue by, and percentages to add to saturation and value
+        int hue = 0;
+        int saturation = 0;
+        int value = 0;
+
+        /// How far the drop shadow falls from what casts it
+        QPoint offset = QPoint(1, 1);
+    };
+
+    /// Returns `image` with the filter run over it. Outlines and drop shadows are only drawn on
+    /// transparent pixels, so they show on layers above an opaque background
+    static QImage apply(const QImage &image, const Settings &settings);
+
+    /// Returns `color` as a color filter changes it, or unchanged for the other filters
+    static QRgb mapColor(QRgb color, const Settings &settings);
+
+    /// Returns true if the filter only changes colors, not where they are
+    static bool mapsColors(FilterType type);
+
+    /// Name shown to the user for a filter
+    static QString name(FilterType type);
+
+private:
+    /// Changes every pixel of a 32 bit image with a color filter
+    static void mapPixels(QImage &image, const Settings &settings);
+
+    /// Swaps every copy of `from` in a row for `to`, four pixels at a time where the platform allows
+    static void replaceSpan(quint32 *pixels, int count, quint32 from, quint32 to);
+
+    /// Inverts a row of pixels, four at a time where the platform allows. Premultiplied and RGB32 pixels
+    /// are inverted against their alpha
+    static void invertSpan(quint32 *pixels, int count, bool premultiplied);
+
+    /// Paints `paint` on the transparent pixels next to opaque ones
+    template <typename Pixel, typename Opaque>
+    static void outline(const QImage &source, QImage &destination, Pixel paint, Opaque opaque);
+
+    /// Paints `paint` on the transparent pixels that an opaque pixel `offset` away casts a shadow on
+    template <typename Pixel, typename Opaque>
+    static void dropShadow(const QImage &source, QImage &destination, Pixel paint, QPoint offset, Opaque opaque);
+};
+
+#endif // FRAMEFILTER_H
@@ -0,0 +1,293 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * GifEncoder Source
+ *
+ * Brief:
+ * The GifEncoder writes an animated GIF one frame at a
+ * time. Each frame gets its own palette of at most 256
+ * colors and is LZW compressed straight into the output,
+ * so only the frame being written is held in memory.
+ *
+*/
+
+#include <algorithm>
+
+#include "gifencoder.h"
+#include "palette.h"
+
+/// Every frame is compressed with 8 bit LZW codes, which fits any palette size
+const int LZW_MIN_CODE_SIZE = 8;
+/// GIF codes are at most 12 bits long
+const int LZW_MAX_CODE = 4095;
+/// Size of the LZW dictionary's hash table. A prime comfortably larger than the 4096 codes it holds
+const int LZW_TABLE_SIZE = 8191;
+
+/**
+ * @brief appendShort - Appends a little endian 16 bit value, as every number in a GIF is stored
+ * @param bytes
+ * @param value
+ */
+static void appendShort(QByteArray &bytes, int value)
+{
+    bytes.append(char(value & 0xff));
+    bytes.append(char((value >> 8) & 0xff));
+}
+
+/**
+ * @brief GifEncoder::GifEncoder - Writes the GIF header, the screen size and the extension that makes
+ * the animation loop
+ * @param device - Where the GIF is written, already open
+ * @param size - Size of every frame
+ */
+GifEncoder::GifEncoder(QIODevice *device, QSize size)
+    : device(device)
+    , size(size)
+    , failed(false)
+{
+    QByteArray header("GIF89a");
+    appendShort(header, size.width());
+    appendShort(header, size.height());
+    // No global color table, every frame brings its own
+    header.append(char(0));
+    header.append(char(0));
+    header.append(char(0));
+
+    // NETSCAPE2.0 application extension, looping forever
+    header.append("\x21\xff\x0b" "NETSCAPE2.0" "\x03\x01", 16);
+    appendShort(header, 0);
+    header.append(char(0));
+
+    write(header);
+}
+
+/**
+ * @brief GifEncoder::addFrame - Writes one frame, cropped to `area`, with a palette made from the
+ * colors that are actually in that area
+ * @param frame - The whole frame
+ * @param previous - The frame before it, or a null image to write every visible pixel
+ * @param area - The part of the frame to write. An empty area still writes one transparent pixel, so
+ * the frame's delay is kept
+ * @param delay - How long the frame is shown, in hundredths of a second
+ * @param keep - Whether the frame is left in place for the next one, rather than cleared to transparent
+ */
+void GifEncoder::addFrame(const QImage &frame, const QImage &previous, QRect area, int delay, bool keep)
+{
+    area = area.intersected(QRect(QPoint(0, 0), size));
+    if (area.isEmpty())
+    {
+        area = QRect(0, 0, 1, 1);
+    }
+
+    // Both frames are 32 bit, so rows can be compared pixel by pixel
+    bool drawOver = !previous.isNull();
+    auto previousRow = [&](int y) {
+        return drawOver ? reinterpret_cast<const QRgb *>(previous.constScanLine(y)) : nullptr;
+    };
+    auto isTransparent = [](const QRgb *row, const QRgb *before, int x) {
+        return before != nullptr ? row[x] == before[x] : qAlpha(row[x]) < 128;
+    };
+
+    // Every visible color and how often it's used. The palette is built the same way as an indexed
+    // document's, so entry 0 is transparent and more than 255 colors are merged with median cut
+    Palette colors;
+    for (int y = area.top(); y <= area.bottom(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        const QRgb *before = previousRow(y);
+        for (int x = area.left(); x <= area.right(); x++)
+        {
+            if (!isTransparent(row, before, x))
+            {
+                colors.addColor(row[x]);
+            }
+        }
+    }
+
+    QList<QRgb> palette = colors.build();
+
+    // Each color is only matched to its entry once
+    QHash<QRgb, quint8> lookup;
+    auto indexOf = [&](QRgb color) {
+        auto match = lookup.constFind(color);
+        if (match == lookup.constEnd())
+        {
+            match = lookup.insert(color, quint8(Palette::nearest(palette, color)));
+        }
+        return *match;
+    };
+
+    std::vector<quint8> indices;
+    indices.reserve(size_t(area.width()) * area.height());
+    for (int y = area.top(); y <= area.bottom(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        const QRgb *before = previousRow(y);
+        for (int x = area.left(); x <= area.right(); x++)
+        {
+            indices.push_back(isTransparent(row, before, x) ? Palette::TRANSPARENT_INDEX : indexOf(row[x] | 0xff000000));
+        }
+    }
+
+    // Color tables hold a power of two entries, at least 2
+    int tableBits = 1;
+    while ((1 << tableBits) < int(palette.size()))
+    {
+        tableBits++;
+    }
+
+    QByteArray block;
+
+    // Graphic control extension: how long to show the frame, what happens to it afterwards, and which
+    // index is transparent. Kept frames are left in place (1), others are restored to the background (2)
+    int disposal = keep ? 1 : 2;
+    block.append("\x21\xf9\x04", 3);
+    block.append(char((disposal << 2) | 1));
+    appendShort(block, delay);
+    block.append(char(Palette::TRANSPARENT_INDEX));
+    block.append(char(0));
+
+    // Image descriptor with a local color table
+    block.append(char(0x2c));
+    appendShort(block, area.x());
+    appendShort(block, area.y());
+    appendShort(block, area.width());
+    appendShort(block, area.height());
+    block.append(char(0x80 | (tableBits - 1)));
+
+    for (int i = 0; i < (1 << tableBits); i++)
+    {
+        QRgb color = i < int(palette.size()) ? palette[i] : 0;
+        block.append(char(qRed(color)));
+        block.append(char(qGreen(color)));
+        block.append(char(qBlue(color)));
+    }
+
+    block.append(char(LZW_MIN_CODE_SIZE));
+    block.append(compress(indices));
+    block.append(char(0));
+
+    write(block);
+}
+
+/**
+ * @brief GifEncoder::finish - Writes the trailer that ends the GIF
+ * @return False if any part of the GIF failed to write
+ */
+bool GifEncoder::finish()
+{
+    write(QByteArray(1, char(0x3b)));
+    return !failed;
+}
+
+/**
+ * @brief GifEncoder::compress - Variable length LZW compression as GIF uses it. Codes start one bit
+ * wider than the minimum code size and grow as the dictionary fills; once all 4096 codes are used the
+ * dictionary is cleared. The packed bits are split into sub-blocks of up to 255 bytes
+ * @param indices - Palette indices, row by row
+ * @return The sub-blocks, without the block terminator
+ */
+QByteArray GifEncoder::compress(const std::vector<quint8> &indices)
+{
+    const int clearCode = 1 << LZW_MIN_CODE_SIZE;
+
+    // Open addressing hash table from (prefix code, next index) to the code of that string
+    std::vector<qint32> keys(LZW_TABLE_SIZE, -1);
+    std::vector<quint16> codes(LZW_TABLE_SIZE);
+
+    QByteArray packed;
+    quint32 bitBuffer = 0;
+    int bitCount = 0;
+    auto writeCode = [&](int code, int length) {
+        bitBuffer |= quint32(code) << bitCount;
+        bitCount += length;
+        while (bitCount >= 8)
+        {
+            packed.append(char(bitBuffer & 0xff));
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    };
+
+    int codeSize = LZW_MIN_CODE_SIZE + 1;
+    int lastCode = clearCode + 1;
+    writeCode(clearCode, codeSize);
+
+    int current = -1;
+    for (quint8 index : indices)
+    {
+        if (current < 0)
+        {
+            current = index;
+            continue;
+        }
+
+        qint32 key = (current << 8) | index;
+        int slot = key % LZW_TABLE_SIZE;
+        while (keys[slot] != -1 && keys[slot] != key)
+        {
+            slot = (slot + 1) % LZW_TABLE_SIZE;
+        }
+
+        if (keys[slot] == key)
+        {
+            current = codes[slot];
+            continue;
+        }
+
+        writeCode(current, codeSize);
+        keys[slot] = key;
+        codes[slot] = quint16(++lastCode);
+        if (lastCode >= (1 << codeSize))
+        {
+            codeSize++;
+        }
+
+        if (lastCode == LZW_MAX_CODE)
+        {
+            writeCode(clearCode, codeSize);
+            std::fill(keys.begin(), keys.end(), -1);
+            codeSize = LZW_MIN_CODE_SIZE + 1;
+            lastCode = clearCode + 1;
+        }
+
+        current = index;
+    }
+
+    if (current >= 0)
+    {
+        writeCode(current, codeSize);
+    }
+    writeCode(clearCode, codeSize);
+    writeCode(clearCode + 1, LZW_MIN_CODE_SIZE + 1);
+    if (bitCount > 0)
+    {
+        packed.append(char(bitBuffer & 0xff));
+    }
+
+    QByteArray blocks;
+    blocks.reserve(packed.size() + packed.size() / 255 + 1);
+    for (qsizetype i = 0; i < packed.size(); i += 255)
+    {
+        qsizetype length = std::min<qsizetype>(255, packed.size() - i);
+        blocks.append(char(length));
+        blocks.append(packed.constData() + i, length);
+    }
+    return blocks;
+}
+
+/**
+ * @brief GifEncoder::write - Writes to the device, remembering if anything failed
+ * @param bytes
+ */
+void GifEncoder::write(const QByteArray &bytes)
+{
+    if (device->write(bytes) != bytes.size())
+    {
+        failed = true;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * GifEncoder Header
+ *
+ * Brief:
+ * The GifEncoder writes an animated GIF one frame at a
+ * time. Each frame gets its own palette of at most 256
+ * colors and is LZW compressed straight into the output,
+ * so only the frame being written is held in memory.
+ *
+*/
+
+#ifndef GIFENCODER_H
+#define GIFENCODER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QImage>
+#include <QRect>
+#include <vector>
+
+class GifEncoder
+{
+public:
+    /// Starts a GIF of frames `size` big on `device`, looping forever
+    GifEncoder(QIODevice *device, QSize size);
+
+    /// Writes the pixels of `frame` inside `area`. Both frames must be 32 bit RGB or ARGB.
+    ///
+    /// With a `previous` frame, pixels that didn't change since it are left transparent, which compresses
+    /// far better. Without one, pixels that are mostly transparent stay transparent. With `keep`, the frame
+    /// stays on screen for the next one to be drawn over; otherwise it's cleared once its `delay`, in
+    /// hundredths of a second, is up
+    void addFrame(const QImage &frame, const QImage &previous, QRect area, int delay, bool keep);
+
+    /// Writes the trailer. Returns false if anything failed to write
+    bool finish();
+
+private:
+    QIODevice *device;
+    QSize size;
+    bool failed;
+
+    /// LZW compresses palette indices into GIF data sub-blocks
+    static QByteArray compress(const std::vector<quint8> &indices);
+
+    void write(const QByteArray &bytes);
+};
+
+#endif // GIFENCODER_H
@@ -0,0 +1,548 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Journal Source
+ *
+ * Brief:
+ * The Journal is an append-only log of every edit made
+ * since the project was last checkpointed. Records are
+ * small and only encoded on the UI thread; they are
+ * written and synced to disk in batches on a background
+ * thread. After a crash the journal is replayed on top of
+ * the last checkpoint, so no more than the last batch of
+ * edits is lost.
+ *
+*/
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "journal.h"
+#include "profiler.h"
+
+/**
+ * @brief setupStream - Puts a stream in the byte order the journal format uses
+ * @param stream
+ */
+static void setupStream(QDataStream &stream)
+{
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+}
+
+/**
+ * @brief syncToDisk - Flushes a file and waits until the operating system has stored it, so what was
+ * written survives a crash or power loss
+ * @param file
+ */
+static void syncToDisk(QFile &file)
+{
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    fsync(file.handle());
+#endif
+}
+
+/**
+ * @brief Journal::Recovery::isValid - Returns true if a journal was found and its project is still the
+ * way the journal left it
+ * @return
+ */
+bool Journal::Recovery::isValid() const
+{
+    return !journalPath.isEmpty();
+}
+
+/**
+ * @brief Journal::Journal - Constructor. Nothing is journaled until `open` or `resume` is called
+ * @param parent
+ */
+Journal::Journal(QObject *parent)
+    : QObject(parent)
+{
+    // One writer keeps batches in order
+    writer.setMaxThreadCount(1);
+
+    syncTimer.setInterval(SYNC_INTERVAL_MS);
+    connect(&syncTimer, &QTimer::timeout, this, &Journal::sync);
+}
+
+/**
+ * @brief Journal::~Journal - Writes out anything still pending. The journal is left on disk, since only
+ * `discard` means the project was closed cleanly
+ */
+Journal::~Journal()
+{
+    flush();
+}
+
+/**
+ * @brief Journal::open - Starts a new, empty journal for a project, replacing any journal it had
+ * @param basePath - The project the journal is checkpointed into. It doesn't need to exist yet
+ * @return True if the journal could be created
+ */
+bool Journal::open(const QString &basePath)
+{
+    discard();
+
+    QSaveFile newJournal(journalPathFor(basePath));
+    QByteArray newHeader = header(basePath);
+    if (!newJournal.open(QIODevice::WriteOnly) || newJournal.write(newHeader) != newHeader.size()
+        || !newJournal.commit())
+    {
+        return false;
+    }
+
+    path = journalPathFor(basePath);
+    base = basePath;
+    headerBytes = newHeader.size();
+    checkpointPosition = appended;
+    checkpointRequested = false;
+    return openFile();
+}
+
+/**
+ * @brief Journal::resume - Carries on appending to a recovered journal. Anything after the records that
+ * were replayed, such as a damaged record or a barrier, is cut off first
+ * @param recovery
+ * @return True if the journal could be reopened
+ */
+bool Journal::resume(const Recovery &recovery)
+{
+    discard();
+
+    QFile recovered(recovery.journalPath);
+    if (!recovery.isValid() || !recovered.resize(recovery.validBytes))
+    {
+        return false;
+    }
+
+    path = recovery.journalPath;
+    base = recovery.basePath;
+    headerBytes = header(base).size();
+    checkpointPosition = 0;
+    appended = recovery.validBytes - headerBytes;
+    checkpointRequested = false;
+    return openFile();
+}
+
+/**
+ * @brief Journal::isOpen - Returns true while edits are being journaled
+ * @return
+ */
+bool Journal::isOpen() const
+{
+    return file != nullptr;
+}
+
+/**
+ * @brief Journal::basePath - Returns the project this journal is checkpointed into
+ * @return
+ */
+QString Journal::basePath() const
+{
+    return base;
+}
+
+/**
+ * @brief Journal::append - Encodes a record onto the batch waiting to be written. Each record is framed
+ * by its length and a checksum, so a record torn by a crash is recognised and ignored
+ * @param record
+ */
+void Journal::append(const Record &record)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+
+    Profiler::Scope scope("journal");
+
+    QByteArray payload = encode(record);
+    QDataStream out(&pending, QIODevice::Append);
+    setupStream(out);
+    out << quint32(payload.size()) << qChecksum(payload);
+    out.writeRawData(payload.constData(), payload.size());
+    appended += qint64(sizeof(quint32) + sizeof(quint16)) + payload.size();
+
+    if (!syncTimer.isActive())
+    {
+        syncTimer.start();
+    }
+
+    // Replay stops at a barrier, so everything before it has to reach the project before more is lost
+    if (!checkpointRequested
+        && (record.action == JournalAction::Barrier || appended - checkpointPosition >= CHECKPOINT_BYTES))
+    {
+        checkpointRequested = true;
+        emit checkpointNeeded();
+    }
+}
+
+/**
+ * @brief Journal::position - Returns how many bytes of records were ever appended to this journal
+ * @return
+ */
+qint64 Journal::position() const
+{
+    return appended;
+}
+
+/**
+ * @brief Journal::needsCheckpoint - Returns true if the journal holds edits its project doesn't
+ * @return
+ */
+bool Journal::needsCheckpoint() const
+{
+    return isOpen() && appended > checkpointPosition;
+}
+
+/**
+ * @brief Journal::checkpointed - Drops the records a saved snapshot already holds. The records after them
+ * are copied into a fresh journal stamped with the saved project, which atomically replaces the old one
+ * @param snapshotPosition - `position()` when the snapshot was taken
+ * @param savedPath - Where the snapshot was written
+ * @return True if the journal now applies to `savedPath`
+ */
+bool Journal::checkpointed(qint64 snapshotPosition, const QString &savedPath)
+{
+    if (!isOpen() || snapshotPosition > appended)
+    {
+        return false;
+    }
+
+    // A snapshot older than the last checkpoint lacks records the journal no longer holds, so the
+    // journal can't be moved onto it. Saves are written in the order they're taken, so this is rare
+    if (snapshotPosition < checkpointPosition)
+    {
+        return false;
+    }
+    qint64 offset = snapshotPosition - checkpointPosition;
+
+    Profiler::Scope scope("journal checkpoint");
+
+    flush();
+    file->close();
+    file.reset();
+
+    QFile old(path);
+    QByteArray tail;
+    if (old.open(QIODevice::ReadOnly) && old.seek(headerBytes + offset))
+    {
+        tail = old.readAll();
+    }
+    old.close();
+
+    QString newPath = journalPathFor(savedPath);
+    QByteArray newHeader = header(savedPath);
+    QSaveFile newJournal(newPath);
+    bool written = newJournal.open(QIODevice::WriteOnly) && newJournal.write(newHeader) == newHeader.size()
+                   && newJournal.write(tail) == tail.size() && newJournal.commit();
+    if (!written)
+    {
+        // The old journal still holds every record, so journaling carries on there
+        openFile();
+        return false;
+    }
+
+    // Saving under a new name leaves the old journal, and any untitled checkpoint, behind
+    if (newPath != path)
+    {
+        QFile::remove(path);
+        if (base == untitledProjectPath() && savedPath != base)
+        {
+            QFile::remove(base);
+        }
+    }
+
+    path = newPath;
+    base = savedPath;
+    headerBytes = newHeader.size();
+    checkpointPosition = snapshotPosition;
+    checkpointRequested = false;
+    return openFile();
+}
+
+/**
+ * @brief Journal::discard - Stops journaling and deletes the journal, so nothing is recovered next time
+ */
+void Journal::discard()
+{
+    if (!isOpen())
+    {
+        return;
+    }
+
+    syncTimer.stop();
+    writer.waitForDone();
+    pending.clear();
+    file->close();
+    file.reset();
+
+    QFile::remove(path);
+    QFile::remove(activeJournalMarker());
+    path.clear();
+    base.clear();
+}
+
+/**
+ * @brief Journal::journalPathFor - Returns where the journal of a project is kept
+ * @param projectPath
+ * @return
+ */
+QString Journal::journalPathFor(const QString &projectPath)
+{
+    return projectPath + ".journal";
+}
+
+/**
+ * @brief Journal::untitledProjectPath - Returns where a document that was never saved is checkpointed
+ * @return
+ */
+QString Journal::untitledProjectPath()
+{
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    return directory + "/untitled.ssp";
+}
+
+/**
+ * @brief Journal::recover - Reads the journal left behind by a session that didn't close cleanly. Records
+ * are read up to the first one that is torn or damaged, or the first barrier. A journal whose project
+ * was changed since it was last checkpointed no longer applies to it, so it's deleted instead
+ * @return The records to replay, or an invalid recovery if there is nothing to recover
+ */
+Journal::Recovery Journal::recover()
+{
+    Profiler::Scope scope("journal recover");
+
+    Recovery recovery;
+
+    QFile marker(activeJournalMarker());
+    if (!marker.open(QIODevice::ReadOnly))
+    {
+        return recovery;
+    }
+    QString journalPath = QString::fromUtf8(marker.readAll());
+    marker.close();
+
+    QFile journal(journalPath);
+    if (!journal.open(QIODevice::ReadOnly))
+    {
+        QFile::remove(activeJournalMarker());
+        return recovery;
+    }
+    QByteArray bytes = journal.readAll();
+    journal.close();
+
+    QDataStream in(bytes);
+    setupStream(in);
+
+    char magic[4];
+    quint16 version = 0;
+    QString basePath;
+    qint64 baseSize = 0;
+    qint64 baseModified = 0;
+    if (in.readRawData(magic, 4) == 4)
+    {
+        in >> version >> basePath >> baseSize >> baseModified;
+    }
+
+    QFileInfo baseInfo(basePath);
+    bool baseMatches = baseSize < 0 ? !baseInfo.exists()
+                                    : baseInfo.exists() && baseInfo.size() == baseSize
+                                          && baseInfo.lastModified().toMSecsSinceEpoch() == baseModified;
+    if (in.status() != QDataStream::Ok || std::memcmp(magic, MAGIC, 4) != 0 || version != VERSION || !baseMatches)
+    {
+        QFile::remove(journalPath);
+        QFile::remove(activeJournalMarker());
+        return recovery;
+    }
+
+    recovery.journalPath = journalPath;
+    recovery.basePath = basePath;
+    recovery.validBytes = in.device()->pos();
+
+    while (!in.atEnd())
+    {
+        quint32 length = 0;
+        quint16 checksum = 0;
+        in >> length >> checksum;
+        if (in.status() != QDataStream::Ok || length > quint64(bytes.size() - in.device()->pos()))
+        {
+            break;
+        }
+
+        QByteArray payload(length, Qt::Uninitialized);
+        in.readRawData(payload.data(), length);
+
+        Record record;
+        if (qChecksum(payload) != checksum || !decode(payload, record) || record.action == JournalAction::Barrier)
+        {
+            break;
+        }
+
+        recovery.records.push_back(std::move(record));
+        recovery.validBytes = in.device()->pos();
+    }
+
+    return recovery;
+}
+
+/**
+ * @brief Journal::sync - Hands the batch of pending records to the writer thread, which appends them and
+ * syncs the file. The UI thread never waits on the disk
+ */
+void Journal::sync()
+{
+    if (!isOpen() || pending.isEmpty())
+    {
+        syncTimer.stop();
+        return;
+    }
+
+    QByteArray batch = std::move(pending);
+    pending = QByteArray();
+    std::shared_ptr<QFile> target = file;
+    writer.start([target, batch]() {
+        target->write(batch);
+        syncToDisk(*target);
+    });
+}
+
+/**
+ * @brief Journal::flush - Waits for the writer thread, then writes and syncs what is still pending
+ */
+void Journal::flush()
+{
+    writer.waitForDone();
+    if (isOpen() && !pending.isEmpty())
+    {
+        file->write(pending);
+        syncToDisk(*file);
+        pending.clear();
+    }
+}
+
+/**
+ * @brief Journal::openFile - Opens the journal for appending and remembers it as the active journal
+ * @return True if the journal could be opened
+ */
+bool Journal::openFile()
+{
+    auto journalFile = std::make_shared<QFile>(path);
+    if (!journalFile->open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return false;
+    }
+    file = std::move(journalFile);
+
+    QSaveFile marker(activeJournalMarker());
+    if (marker.open(QIODevice::WriteOnly))
+    {
+        marker.write(path.toUtf8());
+        marker.commit();
+    }
+    return true;
+}
+
+/**
+ * @brief Journal::header - Encodes a journal header. The project's size and modification time are
+ * stamped into it, so a journal can tell if its project was saved without it since
+ * @param basePath
+ * @return
+ */
+QByteArray Journal::header(const QString &basePath)
+{
+    QFileInfo baseInfo(basePath);
+
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    setupStream(out);
+    out.writeRawData(MAGIC, 4);
+    out << VERSION << basePath;
+    out << qint64(baseInfo.exists() ? baseInfo.size() : -1)
+        << qint64(baseInfo.exists() ? baseInfo.lastModified().toMSecsSinceEpoch() : 0);
+    return bytes;
+}
+
+/**
+ * @brief Journal::encode - Encodes the payload of one record. A stroke's pixels are already compressed;
+ * the palette of indexed pixels is left out, since replay draws them onto frames that have it
+ * @param record
+ * @return
+ */
+QByteArray Journal::encode(const Record &record)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    setupStream(out);
+    out << qint32(record.action) << record.first << record.second << record.third << double(record.amount)
+        << quint32(record.color) << record.frameIndex;
+
+    if (record.action == JournalAction::Stroke)
+    {
+        out << record.area << record.pixels.width << record.pixels.height << record.pixels.format
+            << record.pixels.data;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Journal::decode - Decodes the payload of one record
+ * @param payload
+ * @param record
+ * @return False if the payload is damaged
+ */
+bool Journal::decode(const QByteArray &payload, Record &record)
+{
+    QDataStream in(payload);
+    setupStream(in);
+
+    qint32 action = 0;
+    double amount = 0;
+    quint32 color = 0;
+    in >> action >> record.first >> record.second >> record.third >> amount >> color >> record.frameIndex;
+    if (action < 0 || action > qint32(JournalAction::Barrier))
+    {
+        return false;
+    }
+    record.action = JournalAction(action);
+    record.amount = amount;
+    record.color = color;
+
+    if (record.action == JournalAction::Stroke)
+    {
+        in >> record.area >> record.pixels.width >> record.pixels.height >> record.pixels.format
+            >> record.pixels.data;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+/**
+ * @brief Journal::activeJournalMarker - Returns the file naming the journal in use
+ * @return
+ */
+QString Journal::activeJournalMarker()
+{
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    return directory + "/recovery";
+}
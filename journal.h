@@ -0,0 +1,195 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Journal Header
+ *
+ * Brief:
+ * The Journal is an append-only log of every edit made
+ * since the project was last checkpointed. Records are
+ * small and only encoded on the UI thread; they are
+ * written and synced to disk in batches on a background
+ * thread. After a crash the journal is replayed on top of
+ * the last checkpoint, so no more than the last batch of
+ * edits is lost.
+ *
+ * Layout (little endian):
+ *   header   "PISJ", version, base project path, and the size and modification
+ *            time the base project had when the journal was last checkpointed
+ *   records  length, CRC-16 and payload of each record: action, arguments, the
+ *            current frame, and for strokes the changed area and its new pixels
+ *
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QByteArray>
+#include <QColor>
+#include <QFile>
+#include <QObject>
+#include <QRect>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+#include "enums.h"
+#include "framechunk.h"
+
+class Journal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// The first bytes of a journal file
+    static constexpr char MAGIC[4] = {'P', 'I', 'S', 'J'};
+
+    /// Version of the journal format. Version 2 added a third argument, for the anchor or filter of a
+    /// resize, and version 3 added filters. Journals of other versions are not recovered
+    static constexpr quint16 VERSION = 3;
+
+    /// How often appended records are written out and synced to disk
+    static constexpr int SYNC_INTERVAL_MS = 1000;
+
+    /// How often the journal is checkpointed into the project, and how large it may grow before it
+    /// asks to be checkpointed sooner
+    static constexpr int CHECKPOINT_INTERVAL_MS = 2 * 60 * 1000;
+    static constexpr qint64 CHECKPOINT_BYTES = 4 * 1024 * 1024;
+
+    /// One edit. Which fields are used depends on `action`
+    struct Record
+    {
+        JournalAction action = JournalAction::Barrier;
+
+        /// Arguments of the edit: a frame or layer index, an offset, a size, an anchor or a flag
+        qint32 first = 0;
+        qint32 second = 0;
+        qint32 third = 0;
+
+        /// A layer opacity, or a palette color
+        qreal amount = 0;
+        QRgb color = 0;
+
+        /// The frame that was current when the edit was made, or the frame a stroke was drawn on
+        quint32 frameIndex = 0;
+
+        /// The part of the frame a stroke changed, and its pixels after the stroke
+        QRect area;
+        FrameChunk pixels;
+    };
+
+    /// A journal left behind by a session that didn't close cleanly
+    struct Recovery
+    {
+        QString journalPath;
+
+        /// The project the records apply to. It doesn't exist if the document was never checkpointed
+        QString basePath;
+
+        /// Every record up to the first damaged one or barrier, and how many bytes of the file they
+        /// take up, header included
+        std::vector<Record> records;
+        qint64 validBytes = 0;
+
+        /// Returns true if there is something to recover
+        bool isValid() const;
+    };
+
+    explicit Journal(QObject *parent = nullptr);
+    ~Journal();
+
+    /// Starts a new, empty journal for the project at `basePath`, replacing its old journal. The journal
+    /// is remembered, so it can be found after a crash
+    bool open(const QString &basePath);
+
+    /// Carries on appending to a recovered journal, after the records that were replayed
+    bool resume(const Recovery &recovery);
+
+    /// Returns true while edits are being journaled
+    bool isOpen() const;
+
+    /// The project this journal is checkpointed into
+    QString basePath() const;
+
+    /// Adds an edit to the journal. It's only encoded here; writing and syncing happen in the background
+    void append(const Record &record);
+
+    /// Returns how far the journal has been appended to. A snapshot of the project taken now holds every
+    /// edit before this position
+    qint64 position() const;
+
+    /// Returns true if edits were journaled since the last checkpoint
+    bool needsCheckpoint() const;
+
+    /// Drops the records before `snapshotPosition`, the `position()` when the project was snapshotted,
+    /// once that snapshot was written to `savedPath`. Saving under a new name moves the journal with it
+    bool checkpointed(qint64 snapshotPosition, const QString &savedPath);
+
+    /// Stops journaling and deletes the journal, once the project was closed cleanly
+    void discard();
+
+    /// Where the journal of the project at `projectPath` is kept: next to it
+    static QString journalPathFor(const QString &projectPath);
+
+    /// Where a document that was never saved is checkpointed
+    static QString untitledProjectPath();
+
+    /// Finds and reads the journal of a session that didn't close cleanly. Returns an invalid recovery
+    /// if there is none, or if its project was saved after the journal was last checkpointed
+    static Recovery recover();
+
+signals:
+    /// Emitted once the journal has grown large, or holds an edit that can't be replayed, and should be
+    /// checkpointed into the project soon
+    void checkpointNeeded();
+
+private:
+    QString path;
+    QString base;
+
+    /// The journal file. Once open, it's only written by the writer thread
+    std::shared_ptr<QFile> file;
+    QThreadPool writer;
+
+    /// Records encoded but not yet handed to the writer
+    QByteArray pending;
+
+    /// Size of the journal's header, which records are counted from
+    qint64 headerBytes = 0;
+
+    /// Bytes of records ever appended, and the position of the first record still in the journal file
+    qint64 appended = 0;
+    qint64 checkpointPosition = 0;
+
+    /// True once a checkpoint was asked for, until the next one is made
+    bool checkpointRequested = false;
+
+    QTimer syncTimer;
+
+    /// Hands the pending records to the writer thread, which writes and syncs them
+    void sync();
+
+    /// Waits for the writer, then writes and syncs anything still pending on this thread
+    void flush();
+
+    /// Opens the journal file at `path` for appending
+    bool openFile();
+
+    /// Encodes the header for a journal of the project at `basePath`, stamped with its current size and
+    /// modification time
+    static QByteArray header(const QString &basePath);
+
+    /// Encodes and decodes one record's payload
+    static QByteArray encode(const Record &record);
+    static bool decode(const QByteArray &payload, Record &record);
+
+    /// A file remembering which journal is in use, so it can be found after a crash
+    static QString activeJournalMarker();
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,509 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * LayerStack Source
+ *
+ * Brief:
+ * A LayerStack is the ordered list of layers that make
+ * up one frame, bottom layer first. Each layer can be
+ * hidden, faded or blended with the layers below it.
+ * The flattened frame is cached, and when a layer
+ * changes only the tiles it changed are composited again.
+ *
+*/
+
+#include <cstring>
+
+#include "layerstack.h"
+#include "palette.h"
+#include "profiler.h"
+
+/**
+ * @brief LayerStack::LayerStack - Constructor for a stack of one layer
+ * @param background - The pixels of the only layer
+ */
+LayerStack::LayerStack(const QImage &background)
+    : LayerStack({Layer{"Background", background}}, 0)
+{}
+
+/**
+ * @brief LayerStack::LayerStack - Constructor for a stack of existing layers
+ * @param layers - Bottom layer first. Must not be empty
+ * @param activeIndex - The layer the tools draw on
+ */
+LayerStack::LayerStack(std::vector<Layer> layers, int activeIndex)
+    : layers(std::move(layers))
+    , active(qBound(0, activeIndex, int(this->layers.size()) - 1))
+    , tilesAcross(0)
+    , anyDirty(false)
+{
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::count
+ * @return The number of layers
+ */
+int LayerStack::count() const
+{
+    return int(layers.size());
+}
+
+/**
+ * @brief LayerStack::layer - Returns a layer for reading
+ * @param index - Counted from the bottom layer
+ * @return
+ */
+const LayerStack::Layer &LayerStack::layer(int index) const
+{
+    return layers.at(index);
+}
+
+/**
+ * @brief LayerStack::activeIndex
+ * @return The index of the layer the tools draw on
+ */
+int LayerStack::activeIndex() const
+{
+    return active;
+}
+
+/**
+ * @brief LayerStack::setActiveIndex - Selects the layer the tools draw on
+ * @param index
+ */
+void LayerStack::setActiveIndex(int index)
+{
+    active = qBound(0, index, count() - 1);
+}
+
+/**
+ * @brief LayerStack::size
+ * @return The size of every layer
+ */
+QSize LayerStack::size() const
+{
+    return layers.front().image.size();
+}
+
+/**
+ * @brief LayerStack::insertLayer - Adds a transparent layer and makes it active. A transparent layer
+ * doesn't change the flattened frame, unless it changes whether the frame is opaque. On an indexed
+ * frame the new layer is indexed too, filled with the palette's transparent entry
+ * @param index
+ * @param name
+ */
+void LayerStack::insertLayer(int index, const QString &name)
+{
+    QImage image;
+    const QImage &bottom = layers.front().image;
+    if (bottom.format() == QImage::Format_Indexed8)
+    {
+        image = QImage(size(), QImage::Format_Indexed8);
+        image.setColorTable(bottom.colorTable());
+        image.fill(uint(Palette::TRANSPARENT_INDEX));
+    }
+    else
+    {
+        image = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+    }
+
+    index = qBound(0, index, count());
+    layers.insert(layers.begin() + index, Layer{name, image});
+    active = index;
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::removeLayer - Removes a layer, making the one below it active
+ * @param index
+ */
+void LayerStack::removeLayer(int index)
+{
+    if (count() <= 1 || index < 0 || index >= count())
+    {
+        return;
+    }
+
+    layers.erase(layers.begin() + index);
+    if (active >= index && active > 0)
+    {
+        active--;
+    }
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::moveLayer - Moves a layer up or down the stack
+ * @param fromIndex
+ * @param toIndex
+ */
+void LayerStack::moveLayer(int fromIndex, int toIndex)
+{
+    toIndex = qBound(0, toIndex, count() - 1);
+    if (fromIndex < 0 || fromIndex >= count() || fromIndex == toIndex)
+    {
+        return;
+    }
+
+    Layer moved = std::move(layers[fromIndex]);
+    layers.erase(layers.begin() + fromIndex);
+    layers.insert(layers.begin() + toIndex, std::move(moved));
+
+    if (active == fromIndex)
+    {
+        active = toIndex;
+    }
+    else if (fromIndex < active && toIndex >= active)
+    {
+        active--;
+    }
+    else if (fromIndex > active && toIndex <= active)
+    {
+        active++;
+    }
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::setVisible - Shows or hides a layer
+ * @param index
+ * @param visible
+ */
+void LayerStack::setVisible(int index, bool visible)
+{
+    layers.at(index).visible = visible;
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::setOpacity - Fades a layer
+ * @param index
+ * @param opacity - From 0, invisible, to 1, opaque
+ */
+void LayerStack::setOpacity(int index, qreal opacity)
+{
+    layers.at(index).opacity = qBound(0.0, opacity, 1.0);
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::setBlendMode - Changes how a layer mixes with the layers below it
+ * @param index
+ * @param blendMode
+ */
+void LayerStack::setBlendMode(int index, BlendMode blendMode)
+{
+    layers.at(index).blendMode = blendMode;
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::setColorTable - Gives every indexed layer a new palette. Their pixels stay as they
+ * are, but every tile looks different, so the whole frame is composited again
+ * @param colors
+ */
+void LayerStack::setColorTable(const QList<QRgb> &colors)
+{
+    for (Layer &layer : layers)
+    {
+        if (layer.image.format() == QImage::Format_Indexed8)
+        {
+            layer.image.setColorTable(colors);
+        }
+    }
+    markAllDirty();
+}
+
+/**
+ * @brief LayerStack::setImage - Replaces a layer's pixels. Handing back the image the layer already
+ * holds does nothing. Otherwise each tile is compared row by row with memcmp, and only the tiles that
+ * differ are marked to be composited again
+ * @param index
+ * @param image - Must be the size of the stack
+ * @return True if any pixel changed
+ */
+bool LayerStack::setImage(int index, const QImage &image)
+{
+    Layer &layer = layers.at(index);
+    if (layer.image.cacheKey() == image.cacheKey())
+    {
+        return false;
+    }
+
+    QImage old = layer.image;
+    layer.image = image;
+    if (old.size() != image.size() || old.format() != image.format() || old.colorTable() != image.colorTable())
+    {
+        markAllDirty();
+        return true;
+    }
+
+    bool changed = false;
+    int bytesPerPixel = image.depth() / 8;
+    for (int i = 0; i < int(dirtyTiles.size()); i++)
+    {
+        QRect area = QRect((i % tilesAcross) * TILE_SIZE, (i / tilesAcross) * TILE_SIZE, TILE_SIZE, TILE_SIZE)
+                         .intersected(image.rect());
+        for (int y = area.top(); y <= area.bottom(); y++)
+        {
+            if (std::memcmp(old.constScanLine(y) + area.left() * bytesPerPixel,
+                            image.constScanLine(y) + area.left() * bytesPerPixel,
+                            area.width() * bytesPerPixel)
+                != 0)
+            {
+                dirtyTiles[i] = true;
+                anyDirty = true;
+                changed = true;
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief LayerStack::editImage - Returns a layer's pixels for editing in place
+ * @param index
+ * @return
+ */
+QImage &LayerStack::editImage(int index)
+{
+    markAllDirty();
+    return layers.at(index).image;
+}
+
+/**
+ * @brief LayerStack::imageBuffer - Returns a layer's pixels for drawing on in place, such as by the tools
+ * during a stroke. Only the tiles reported to `markDirty` are composited again
+ * @param index
+ * @return
+ */
+QImage &LayerStack::imageBuffer(int index)
+{
+    return layers.at(index).image;
+}
+
+/**
+ * @brief LayerStack::markDirty - Marks the tiles under `area` to be composited again
+ * @param area
+ */
+void LayerStack::markDirty(QRect area)
+{
+    area = area.intersected(QRect(QPoint(0, 0), size()));
+    if (area.isEmpty())
+    {
+        return;
+    }
+
+    for (int tileY = area.top() / TILE_SIZE; tileY <= area.bottom() / TILE_SIZE; tileY++)
+    {
+        for (int tileX = area.left() / TILE_SIZE; tileX <= area.right() / TILE_SIZE; tileX++)
+        {
+            dirtyTiles[tileY * tilesAcross + tileX] = true;
+        }
+    }
+    anyDirty = true;
+}
+
+/**
+ * @brief LayerStack::composite - Brings the flattened frame up to date and returns it. Each row of
+ * dirty tiles is composited as one rectangle per run: cleared, then every visible layer drawn over it
+ * with its opacity and blend mode. A frame that is just its bottom layer isn't composited at all
+ * @return
+ */
+const QImage &LayerStack::composite()
+{
+    if (isPassThrough())
+    {
+        return layers.front().image;
+    }
+
+    QImage::Format format = compositeFormat();
+    if (cache.size() != size() || cache.format() != format)
+    {
+        cache = QImage(size(), format);
+        markAllDirty();
+    }
+
+    if (!anyDirty)
+    {
+        return cache;
+    }
+
+    Profiler::Scope scope("composite");
+    QPainter painter(&cache);
+    int tilesDown = int(dirtyTiles.size()) / tilesAcross;
+    for (int tileY = 0; tileY < tilesDown; tileY++)
+    {
+        int tileX = 0;
+        while (tileX < tilesAcross)
+        {
+            if (!dirtyTiles[tileY * tilesAcross + tileX])
+            {
+                tileX++;
+                continue;
+            }
+
+            int firstX = tileX;
+            while (tileX < tilesAcross && dirtyTiles[tileY * tilesAcross + tileX])
+            {
+                dirtyTiles[tileY * tilesAcross + tileX] = false;
+                tileX++;
+            }
+
+            QRect area = QRect(firstX * TILE_SIZE, tileY * TILE_SIZE, (tileX - firstX) * TILE_SIZE, TILE_SIZE)
+                             .intersected(cache.rect());
+
+            painter.setOpacity(1.0);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.fillRect(area, Qt::transparent);
+
+            for (int i = 0; i < count(); i++)
+            {
+                const Layer &layer = layers[i];
+                if (!layer.visible || layer.opacity <= 0.0)
+                {
+                    continue;
+                }
+                painter.setOpacity(layer.opacity);
+                painter.setCompositionMode(compositionMode(layer.blendMode));
+                painter.drawImage(area.topLeft(), layer.image, area);
+            }
+        }
+    }
+    anyDirty = false;
+
+    Profiler::count("layers composited", count());
+    return cache;
+}
+
+/**
+ * @brief LayerStack::transformed - Runs `transform` on every layer, such as to crop, extend or scale them
+ * @param transform - Returns the new image for a layer, given its pixels and the color of any new space
+ * @return
+ */
+LayerStack LayerStack::transformed(const std::function<QImage(const QImage &image, QColor fill)> &transform) const
+{
+    std::vector<Layer> resizedLayers;
+    resizedLayers.reserve(layers.size());
+    for (int i = 0; i < count(); i++)
+    {
+        Layer layer = layers[i];
+        // An indexed bottom layer has a transparent palette entry, but is treated as opaque like the
+        // single image frame it was made from
+        bool opaque = i == 0
+                      && (!layer.image.hasAlphaChannel() || layer.image.format() == QImage::Format_Indexed8);
+        layer.image = transform(layer.image, opaque ? QColor(Qt::white) : QColor(Qt::transparent));
+        resizedLayers.push_back(layer);
+    }
+    return LayerStack(std::move(resizedLayers), active);
+}
+
+/**
+ * @brief LayerStack::memoryUsage - Bytes held by the layers and the flattened frame
+ * @return
+ */
+size_t LayerStack::memoryUsage() const
+{
+    size_t bytes = sizeof(LayerStack) + cache.sizeInBytes() + dirtyTiles.size() / 8;
+    for (const Layer &layer : layers)
+    {
+        bytes += sizeof(Layer) + layer.image.sizeInBytes();
+    }
+    return bytes;
+}
+
+/**
+ * @brief LayerStack::blendModeName - Returns the name shown to the user for a blend mode
+ * @param blendMode
+ * @return
+ */
+QString LayerStack::blendModeName(BlendMode blendMode)
+{
+    switch (blendMode)
+    {
+    case BlendMode::Normal:
+        return "Normal";
+    case BlendMode::Multiply:
+        return "Multiply";
+    case BlendMode::Screen:
+        return "Screen";
+    case BlendMode::Overlay:
+        return "Overlay";
+    case BlendMode::Darken:
+        return "Darken";
+    case BlendMode::Lighten:
+        return "Lighten";
+    case BlendMode::Add:
+        return "Add";
+    }
+    return QString();
+}
+
+/**
+ * @brief LayerStack::markAllDirty - Marks every tile to be composited again, resizing the tile grid to
+ * the layers first
+ */
+void LayerStack::markAllDirty()
+{
+    tilesAcross = (size().width() + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesDown = (size().height() + TILE_SIZE - 1) / TILE_SIZE;
+    dirtyTiles.assign(size_t(tilesAcross) * tilesDown, true);
+    anyDirty = true;
+}
+
+/**
+ * @brief LayerStack::isPassThrough - Checks if the flattened frame is exactly the bottom layer
+ * @return
+ */
+bool LayerStack::isPassThrough() const
+{
+    const Layer &bottom = layers.front();
+    return count() == 1 && bottom.visible && bottom.opacity >= 1.0 && bottom.blendMode == BlendMode::Normal;
+}
+
+/**
+ * @brief LayerStack::compositeFormat - Picks the format of the flattened frame. Premultiplied alpha is
+ * the fastest format for QPainter to blend into
+ * @return
+ */
+QImage::Format LayerStack::compositeFormat() const
+{
+    const Layer &bottom = layers.front();
+    bool opaque = bottom.visible && bottom.opacity >= 1.0 && bottom.blendMode == BlendMode::Normal
+                  && !bottom.image.hasAlphaChannel();
+    return opaque ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied;
+}
+
+/**
+ * @brief LayerStack::compositionMode - Maps a blend mode onto the QPainter mode that does it
+ * @param blendMode
+ * @return
+ */
+QPainter::CompositionMode LayerStack::compositionMode(BlendMode blendMode)
+{
+    switch (blendMode)
+    {
+    case BlendMode::Normal:
+        return QPainter::CompositionMode_SourceOver;
+    case BlendMode::Multiply:
+        return QPainter::CompositionMode_Multiply;
+    case BlendMode::Screen:
+        return QPainter::CompositionMode_Screen;
+    case BlendMode::Overlay:
+        return QPainter::CompositionMode_Overlay;
+    case BlendMode::Darken:
+        return QPainter::CompositionMode_Darken;
+    case BlendMode::Lighten:
+        return QPainter::CompositionMode_Lighten;
+    case BlendMode::Add:
+        return QPainter::CompositionMode_Plus;
+    }
+    return QPainter::CompositionMode_SourceOver;
+}
@@ -0,0 +1,136 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * LayerStack Header
+ *
+ * Brief:
+ * A LayerStack is the ordered list of layers that make
+ * up one frame, bottom layer first. Each layer can be
+ * hidden, faded or blended with the layers below it.
+ * The flattened frame is cached, and when a layer
+ * changes only the tiles it changed are composited again.
+ *
+*/
+
+#ifndef LAYERSTACK_H
+#define LAYERSTACK_H
+
+#include <QImage>
+#include <QList>
+#include <QPainter>
+#include <QRect>
+#include <QString>
+#include <functional>
+#include <vector>
+
+#include "enums.h"
+
+class LayerStack
+{
+public:
+    /// Width and height of the tiles the flattened frame is composited in
+    static constexpr int TILE_SIZE = 64;
+
+    /// One layer of a frame
+    struct Layer
+    {
+        QString name;
+        QImage image;
+        bool visible = true;
+        qreal opacity = 1.0;
+        BlendMode blendMode = BlendMode::Normal;
+    };
+
+    /// A stack holding only `background`, as a layer named "Background"
+    explicit LayerStack(const QImage &background);
+
+    /// A stack of `layers`, bottom first, with `activeIndex` selected. Every layer must be the same size
+    LayerStack(std::vector<Layer> layers, int activeIndex);
+
+    /// Number of layers, and the layer at `index`, counted from the bottom
+    int count() const;
+    const Layer &layer(int index) const;
+
+    /// The layer the tools draw on
+    int activeIndex() const;
+    void setActiveIndex(int index);
+
+    /// Size every layer has
+    QSize size() const;
+
+    /// Adds an empty, transparent layer at `index`. It's indexed if the bottom layer is
+    void insertLayer(int index, const QString &name);
+
+    /// Removes a layer. The last layer can't be removed
+    void removeLayer(int index);
+
+    /// Moves a layer from `fromIndex` to `toIndex`, keeping it active if it was
+    void moveLayer(int fromIndex, int toIndex);
+
+    /// Layer settings. Each one composites the whole frame again
+    void setVisible(int index, bool visible);
+    void setOpacity(int index, qreal opacity);
+    void setBlendMode(int index, BlendMode blendMode);
+
+    /// Gives every indexed layer the palette `colors`, compositing the whole frame again
+    void setColorTable(const QList<QRgb> &colors);
+
+    /// Replaces the pixels of a layer. Only the tiles whose pixels differ are composited again.
+    /// Returns false if nothing changed
+    bool setImage(int index, const QImage &image);
+
+    /// Returns a layer's pixels for editing. Since any pixel may change, the whole frame is
+    /// composited again next time
+    QImage &editImage(int index);
+
+    /// Returns a layer's pixels to draw on in place. Unlike `editImage` nothing is marked, so whatever
+    /// is drawn must be reported with `markDirty`
+    QImage &imageBuffer(int index);
+
+    /// Marks `area` to be composited again, after the active layer was drawn on in place
+    void markDirty(QRect area);
+
+    /// Returns the flattened frame, compositing any tiles that changed first. The tools draw on the
+    /// active layer in place, so a stroke shows up as soon as its tiles are marked dirty
+    const QImage &composite();
+
+    /// Returns a copy of the stack with `transform` run on every layer, for resizing or scaling the
+    /// whole frame. `transform` is given the color new space should be: white on an opaque or indexed
+    /// bottom layer, and transparent everywhere else
+    LayerStack transformed(const std::function<QImage(const QImage &image, QColor fill)> &transform) const;
+
+    /// Returns true if the flattened frame is just the bottom layer, as it is for a frame of one
+    /// visible, normal layer. Such a frame is never composited
+    bool isPassThrough() const;
+
+    /// Returns how many bytes the layers hold, counting pixels shared with other stacks in full
+    size_t memoryUsage() const;
+
+    /// Name shown to the user for a blend mode
+    static QString blendModeName(BlendMode blendMode);
+
+private:
+    std::vector<Layer> layers;
+    int active;
+
+    /// The flattened frame, and which of its tiles are out of date
+    QImage cache;
+    int tilesAcross;
+    std::vector<bool> dirtyTiles;
+    bool anyDirty;
+
+    /// Marks every tile out of date
+    void markAllDirty();
+
+    /// Format of the flattened frame. Frames with an opaque bottom layer stay opaque
+    QImage::Format compositeFormat() const;
+
+    /// The painter mode that blends like `blendMode`
+    static QPainter::CompositionMode compositionMode(BlendMode blendMode);
+};
+
+#endif // LAYERSTACK_H
@@ -17,16 +17,24 @@
 #include <QApplication>
 #include <QColor>
 #include <QImage>
+#include <QInputDialog>
 #include <QLabel>
+#include <QActionGroup>
 #include <QLayout>
+#include <QMenu>
 #include <QMouseEvent>
 #include <QObject>
 #include <QPainter>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QTimer>
 #include <iostream>
 
+#include "layerstack.h"
 #include "mainwindow.h"
+#include "profiler.h"
+#include "resizedialog.h"
+#include "thumbnailcache.h"
 #include "ui_mainwindow.h"
 
 MainWindow::MainWindow(QWidget *parent)
@@ -38,6 +46,13 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Connect signals and slots for files
     connectFileActions();
+    // Connect signals and slots for the profiler
+    connectProfilerActions();
+    // Connect signals and slots for layers
+    connectLayerActions();
+    // Connect signals and slots for the palette
+    connectPaletteActions();
+    connectFilterActions();
     // Connect signals and slots for tools
     connectToolButtons();
     // Connect signals and slots for frames
@@ -90,6 +105,10 @@ void MainWindow::connectToolButtons()
         highlightSelectedTool(ui->bucketButton);
     });
 
+    // Right clicking the bucket shows its fill settings
+    ui->bucketButton->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->bucketButton, &QPushButton::customContextMenuRequested, this, &MainWindow::bucketMenuRequested);
+
     // Connect color buttons to their respective slots
     connect(ui->colorButton, &QPushButton::released, this, &MainWindow::colorButtonPressed);
     connect(ui->selectedColorButton, &QPushButton::released, this, &MainWindow::colorButtonPressed);
@@ -98,6 +117,10 @@ void MainWindow::connectToolButtons()
     connect(ui->undoButton, &QPushButton::released, this, &MainWindow::undoButtonPressed);
     connect(ui->redoButton, &QPushButton::released, this, &MainWindow::redoButtonPressed);   
     connect(ui->brushSizeBox, &QComboBox::currentIndexChanged, this, &MainWindow::brushSizeChanged);
+
+    // Right clicking the brush size shows the brush shapes
+    ui->brushSizeBox->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->brushSizeBox, &QComboBox::customContextMenuRequested, this, &MainWindow::brushMenuRequested);
 }
 
 /**
@@ -119,6 +142,16 @@ void MainWindow::connectFrameButtons()
             this,
             &MainWindow::moveFrameDownButtonPressed);
 
+    // Rows all have the same size and are laid out in batches, so long timelines stay quick to
+    // scroll, and only the rows on screen ask for thumbnails
+    ui->frameListWidget->setUniformItemSizes(true);
+    ui->frameListWidget->setLayoutMode(QListView::Batched);
+    ui->frameListWidget->setIconSize(QSize(ThumbnailCache::THUMBNAIL_SIZE, ThumbnailCache::THUMBNAIL_SIZE));
+    connect(ui->frameListWidget->verticalScrollBar(),
+            &QScrollBar::valueChanged,
+            this,
+            &MainWindow::requestVisibleThumbnails);
+
     connect(ui->frameListWidget, &QListWidget::itemClicked, this, &MainWindow::frameSelected);
     connect(ui->frameListWidget, &QListWidget::itemClicked, this, [this](QListWidgetItem *item) {
         emit setFrameToEdit(item->data(0).toInt());
@@ -143,9 +176,174 @@ void MainWindow::connectFileActions()
     connect(ui->saveFileAction, &QAction::triggered, this, &MainWindow::saveFileAction);
     connect(ui->newFileAction, &QAction::triggered, this, &MainWindow::newFileAction);
     connect(ui->openFileAction, &QAction::triggered, this, &MainWindow::openFileAction);
+    connect(ui->exportAnimationAction, &QAction::triggered, this, &MainWindow::exportAnimationAction);
+    connect(ui->exportAtlasAction, &QAction::triggered, this, &MainWindow::exportAtlasAction);
     connect(ui->resizeCanvasAction, &QAction::triggered, this, &MainWindow::sizeCanvasAction);
 }
 
+/**
+ * @brief MainWindow::connectProfilerActions - Connects the profiler menu. The profiler only runs while
+ * its timings are shown or a trace is being recorded. Stopping a trace asks where to save it
+ */
+void MainWindow::connectProfilerActions()
+{
+    connect(ui->showProfilerAction, &QAction::toggled, this, [this](bool checked) {
+        Profiler::setEnabled(checked || Profiler::isTracing());
+        canvas()->setOverlayVisible(checked);
+    });
+
+    connect(ui->recordTraceAction, &QAction::toggled, this, [this](bool checked) {
+        if (checked) {
+            Profiler::setTracing(true);
+            showStatus("Recording trace");
+            return;
+        }
+
+        Profiler::setTracing(false);
+        Profiler::setEnabled(ui->showProfilerAction->isChecked());
+
+        QString filePath = QFileDialog::getSaveFileName(this,
+                                                        tr("Save Trace"),
+                                                        "trace.json",
+                                                        "Chrome Trace (*.json);;");
+        if (filePath.isEmpty()) {
+            return;
+        }
+        if (Profiler::writeTrace(filePath)) {
+            showStatus("Saved trace to " + filePath, 3000);
+        } else {
+            showStatus("Could not save trace to " + filePath, 3000);
+        }
+    });
+
+    connect(ui->resetProfilerAction, &QAction::triggered, this, []() { Profiler::reset(); });
+}
+
+/**
+ * @brief MainWindow::connectLayerActions - Connects the layer menu. Blend modes are listed in code, one
+ * action per mode. The status bar shows which mode the active layer uses
+ */
+void MainWindow::connectLayerActions()
+{
+    connect(ui->newLayerAction, &QAction::triggered, this, [this]() { emit addLayer(); });
+    connect(ui->deleteLayerAction, &QAction::triggered, this, [this]() { emit deleteLayer(); });
+    connect(ui->raiseLayerAction, &QAction::triggered, this, [this]() { emit moveLayer(1); });
+    connect(ui->lowerLayerAction, &QAction::triggered, this, [this]() { emit moveLayer(-1); });
+    connect(ui->selectLayerAboveAction, &QAction::triggered, this, [this]() { emit selectLayer(1); });
+    connect(ui->selectLayerBelowAction, &QAction::triggered, this, [this]() { emit selectLayer(-1); });
+    connect(ui->toggleLayerAction, &QAction::triggered, this, [this]() { emit toggleLayerVisibility(); });
+
+    connect(ui->layerOpacityAction, &QAction::triggered, this, [this]() {
+        bool accepted = false;
+        int percent = QInputDialog::getInt(this, tr("Layer Opacity"), tr("Opacity (%):"), 100, 0, 100, 5, &accepted);
+        if (accepted) {
+            emit setLayerOpacity(percent);
+        }
+    });
+
+    for (BlendMode blendMode : {BlendMode::Normal,
+                                BlendMode::Multiply,
+                                BlendMode::Screen,
+                                BlendMode::Overlay,
+                                BlendMode::Darken,
+                                BlendMode::Lighten,
+                                BlendMode::Add}) {
+        QAction *action = ui->blendModeMenu->addAction(LayerStack::blendModeName(blendMode));
+        connect(action, &QAction::triggered, this, [this, blendMode]() { emit setLayerBlendMode(blendMode); });
+    }
+}
+
+/**
+ * @brief MainWindow::connectPaletteActions - Connects the palette menu. Replacing a palette color
+ * replaces the entry closest to the pen color, then makes the new color the pen color
+ */
+void MainWindow::connectPaletteActions()
+{
+    connect(ui->indexedColorAction, &QAction::triggered, this, [this](bool checked) {
+        emit setIndexedColor(checked);
+    });
+
+    connect(ui->replacePaletteColorAction, &QAction::triggered, this, [this]() {
+        QColor color = QColorDialog::getColor(currentColor, this, tr("Replace Palette Color"));
+        if (!color.isValid()) {
+            return;
+        }
+
+        emit replacePaletteColor(currentColor, color);
+        emit setPenColor(color);
+        recieveNewColor(color);
+    });
+}
+
+/**
+ * @brief MainWindow::connectFilterActions - Fills the filter menu. Filters that need a color use the pen
+ * color; replacing a color replaces the pen color with a new one, then makes the new color the pen color
+ */
+void MainWindow::connectFilterActions()
+{
+    for (FilterType type : {FilterType::ReplaceColor,
+                            FilterType::AdjustHsv,
+                            FilterType::Invert,
+                            FilterType::FlipHorizontal,
+                            FilterType::FlipVertical,
+                            FilterType::RotateClockwise,
+                            FilterType::RotateCounterClockwise,
+                            FilterType::Outline,
+                            FilterType::DropShadow}) {
+        if (type == FilterType::FlipHorizontal || type == FilterType::Outline) {
+            ui->filterMenu->addSeparator();
+        }
+
+        QAction *action = ui->filterMenu->addAction(FrameFilter::name(type));
+        connect(action, &QAction::triggered, this, [this, type]() {
+            FrameFilter::Settings settings;
+            settings.type = type;
+            settings.color = currentColor.rgba();
+            bool accepted = true;
+
+            if (type == FilterType::ReplaceColor) {
+                QColor color = QColorDialog::getColor(currentColor, this, tr("Replace Color"));
+                if (!color.isValid()) {
+                    return;
+                }
+                settings.replacement = color.rgba();
+                emit filterFrames(settings);
+                emit setPenColor(color);
+                recieveNewColor(color);
+                return;
+            }
+
+            if (type == FilterType::AdjustHsv) {
+                settings.hue = QInputDialog::getInt(this, tr("Hue/Saturation/Value"), tr("Hue (degrees):"), 0, -180, 180, 1, &accepted);
+                if (accepted) {
+                    settings.saturation = QInputDialog::getInt(this, tr("Hue/Saturation/Value"), tr("Saturation (%):"), 0, -100, 100, 5, &accepted);
+                }
+                if (accepted) {
+                    settings.value = QInputDialog::getInt(this, tr("Hue/Saturation/Value"), tr("Value (%):"), 0, -100, 100, 5, &accepted);
+                }
+            } else if (type == FilterType::DropShadow) {
+                int distance = QInputDialog::getInt(this, tr("Drop Shadow"), tr("Offset (pixels):"), 1, 1, 64, 1, &accepted);
+                settings.offset = QPoint(distance, distance);
+            }
+
+            if (accepted) {
+                emit filterFrames(settings);
+            }
+        });
+    }
+}
+
+/**
+ * @brief MainWindow::showIndexedColor - Ticks the indexed color action if frames are indexed, such as
+ * after an undo or opening a project, without converting anything
+ * @param indexed
+ */
+void MainWindow::showIndexedColor(bool indexed)
+{
+    ui->indexedColorAction->setChecked(indexed);
+    ui->replacePaletteColorAction->setEnabled(indexed);
+}
+
 //-----Tool updates-----//
 
 /**
@@ -165,6 +363,73 @@ void MainWindow::colorButtonPressed()
     ui->selectedColorButton->update();
 }
 
+/**
+ * @brief MainWindow::bucketMenuRequested - Shows a menu for choosing which pixels the bucket fills and
+ * how close a color has to be to the clicked one, then emits the new fill settings
+ * @param pos - Where the bucket button was right clicked
+ */
+void MainWindow::bucketMenuRequested(const QPoint &pos)
+{
+    QMenu menu(this);
+    QActionGroup modes(&menu);
+
+    auto addMode = [&](const QString &text, FillMode mode) {
+        QAction *action = menu.addAction(text);
+        action->setCheckable(true);
+        action->setChecked(fillMode == mode);
+        modes.addAction(action);
+        connect(action, &QAction::triggered, this, [this, mode]() { fillMode = mode; });
+    };
+
+    addMode("Fill Connected Pixels", FillMode::FourConnected);
+    addMode("Fill Connected Pixels (Including Diagonals)", FillMode::EightConnected);
+    addMode("Replace Color Everywhere", FillMode::ReplaceAll);
+    menu.addSeparator();
+    QAction *toleranceAction = menu.addAction(QString("Tolerance: %1...").arg(fillTolerance));
+
+    QAction *chosen = menu.exec(ui->bucketButton->mapToGlobal(pos));
+    if (chosen == nullptr)
+    {
+        return;
+    }
+
+    if (chosen == toleranceAction)
+    {
+        fillTolerance = QInputDialog::getInt(this, "Fill Tolerance",
+                                             "How far a color may be from the clicked color (0 - 255)",
+                                             fillTolerance, 0, 255);
+    }
+
+    emit selectFillSettings(fillMode, fillTolerance);
+}
+
+/**
+ * @brief MainWindow::brushMenuRequested - Shows a menu for choosing the shape of the brush, then emits
+ * the chosen shape
+ * @param pos - Where the brush size box was right clicked
+ */
+void MainWindow::brushMenuRequested(const QPoint &pos)
+{
+    QMenu menu(this);
+    QActionGroup shapes(&menu);
+
+    auto addShape = [&](const QString &text, BrushShape shape) {
+        QAction *action = menu.addAction(text);
+        action->setCheckable(true);
+        action->setChecked(brushShape == shape);
+        shapes.addAction(action);
+        connect(action, &QAction::triggered, this, [this, shape]() {
+            brushShape = shape;
+            emit selectBrushShape(shape);
+        });
+    };
+
+    addShape("Square Brush", BrushShape::Square);
+    addShape("Round Brush", BrushShape::Circle);
+
+    menu.exec(ui->brushSizeBox->mapToGlobal(pos));
+}
+
 /**
  * @brief MainWindow::brushSizeChanged - Emits the brush size and color when the brush size is changed
  */
@@ -212,15 +477,6 @@ void MainWindow::undoButtonPressed()
     emit undoAction();
 }
 
-/**
- * @brief MainWindow::updateCanvas - Update the canvas with the provided image
- * @param image
- */
-void MainWindow::updateCanvas(QImage image)
-{
-    canvas()->setImage(&image);
-}
-
 /**
  * @brief MainWindow::redoButtonPressed - Emit the redo action signal
  */
@@ -245,17 +501,24 @@ void MainWindow::initializeAnimationPreview()
 
 /**
  * @brief MainWindow::playAnimation - Display the animation by updating the animation screen with the current frame
- * @param frameImage
+ * @param preview - The frame, already scaled to `animationPreviewSize()`
+ */
+void MainWindow::playAnimation(const QPixmap &preview)
+{
+    ui->animationScreen->setPixmap(preview);
+}
+
+/**
+ * @brief MainWindow::animationPreviewSize - Returns the size animation frames should be scaled to fit,
+ * or an invalid size if they should be shown at their actual size
+ * @return
  */
-void MainWindow::playAnimation(const QImage &frameImage)
+QSize MainWindow::animationPreviewSize()
 {
-    QPixmap p;
     if (ui->actualSizeCheckBox->isChecked()) {
-        p = QPixmap::fromImage(frameImage);
-    } else {
-        p = QPixmap::fromImage(frameImage.scaled(ui->animationScreen->size(), Qt::KeepAspectRatio));
+        return QSize();
     }
-    ui->animationScreen->setPixmap(p);
+    return ui->animationScreen->size();
 }
 
 /**
@@ -269,25 +532,41 @@ void MainWindow::fpsSliderChanged(int value)
 }
 
 /**
- * @brief MainWindow::receiveAnimationFrameData - Receive animation frame data and play the frame with a delay
- * @param frame
- * @param delay
+ * @brief MainWindow::showFPS - Moves the FPS slider to `fps`, such as after opening a project
+ * @param fps
  */
-void MainWindow::receiveAnimationFrameData(QImage frame, int delay)
+void MainWindow::showFPS(int fps)
 {
-    QTimer::singleShot(delay, this, [this, frame]() { playAnimation(frame); });
+    ui->fpsSlider->setValue(fps);
 }
 
 //-----Frame updates-----//
 
 /**
- * @brief MainWindow::sizeCanvasAction - Handle the action of resizing the canvas by prompting the user for a new canvas size and emitting the new size
+ * @brief MainWindow::sizeCanvasAction - Handle the action of resizing the canvas by asking the user how to resize
+ * it, then emitting either the new size and anchor or the new size and scale filter
  */
 void MainWindow::sizeCanvasAction()
 {
+    ResizeDialog dialog(canvasSize, this);
+    if (dialog.exec() != QDialog::Accepted || dialog.chosenSize() == canvasSize) {
+        return;
+    }
 
-    int size = QInputDialog::getInt(this, "Canvas Size", "Set Canvas Size", 64, 8, 128, 8);
-    emit resizeCanvas(size, size);
+    if (dialog.scaling()) {
+        emit scaleCanvas(dialog.chosenSize().width(), dialog.chosenSize().height(), dialog.filter());
+    } else {
+        emit resizeCanvas(dialog.chosenSize().width(), dialog.chosenSize().height(), dialog.anchor());
+    }
+}
+
+/**
+ * @brief MainWindow::showCanvasSize - Remembers the size of the frame being shown, for the resize dialog to start from
+ * @param size
+ */
+void MainWindow::showCanvasSize(QSize size)
+{
+    canvasSize = size;
 }
 
 /**
@@ -398,12 +677,44 @@ void MainWindow::openFileAction()
                                                     tr("Open File"),
                                                     "C://",
                                                     "Sprite Pixel Image (*.ssp);;");
-    frameList.clear();
-    ui->frameListWidget->clear();
-    addFrameToList();
+    // The frame list is rebuilt once the project has been loaded
     emit loadFile(QString(filename));
 }
 
+/**
+ * @brief MainWindow::exportAnimationAction - Prompts for where to export the animation, then emits the
+ * signal to export it. The format follows the chosen file's extension
+ */
+void MainWindow::exportAnimationAction()
+{
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                                    tr("Export Animation"),
+                                                    "C://",
+                                                    "Animated GIF (*.gif);;Animated PNG (*.png *.apng)");
+    if (filePath.isEmpty())
+    {
+        return;
+    }
+    emit exportAnimation(filePath);
+}
+
+/**
+ * @brief MainWindow::exportAtlasAction - Prompts for where to write the atlas description, then emits the
+ * signal to export it. The atlas pages are written next to it
+ */
+void MainWindow::exportAtlasAction()
+{
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                                    tr("Export Sprite Atlas"),
+                                                    "C://",
+                                                    "Sprite Atlas (*.json)");
+    if (filePath.isEmpty())
+    {
+        return;
+    }
+    emit exportAtlas(filePath);
+}
+
 /**
  * @brief MainWindow::newFileAction - Handle the action of creating a new file by clearing the frame list and emitting the signal to create a new file
  */
@@ -426,6 +737,82 @@ void MainWindow::addFramesToList(int count)
     }
 }
 
+/**
+ * @brief MainWindow::showFrameList - Makes the frame list show `frameCount` frames with `currentFrame`
+ * selected. The list is only rebuilt when the number of frames changed
+ * @param frameCount
+ * @param currentFrame
+ */
+void MainWindow::showFrameList(int frameCount, int currentFrame)
+{
+    if (frameList.size() != frameCount) {
+        frameList.clear();
+        ui->frameListWidget->clear();
+        addFramesToList(frameCount);
+    }
+
+    ui->frameListWidget->setCurrentRow(currentFrame);
+    requestVisibleThumbnails();
+}
+
+/**
+ * @brief MainWindow::requestVisibleThumbnails - Asks for the thumbnails of the frames whose rows are on
+ * screen. Rows that haven't been laid out yet are estimated from the thumbnail height
+ */
+void MainWindow::requestVisibleThumbnails()
+{
+    QListWidget *list = ui->frameListWidget;
+    if (list->count() == 0) {
+        return;
+    }
+
+    QModelIndex top = list->indexAt(QPoint(1, 1));
+    QModelIndex bottom = list->indexAt(QPoint(1, list->viewport()->height() - 2));
+
+    int firstFrame = top.isValid() ? top.row() : 0;
+    int lastFrame = bottom.isValid()
+                        ? bottom.row()
+                        : firstFrame + list->viewport()->height() / ThumbnailCache::THUMBNAIL_SIZE + 1;
+
+    emit thumbnailsNeeded(firstFrame, qMin(lastFrame, int(list->count()) - 1));
+}
+
+/**
+ * @brief MainWindow::showThumbnail - Shows a thumbnail as the icon of a frame's row
+ * @param frameIndex
+ * @param thumbnail
+ */
+void MainWindow::showThumbnail(int frameIndex, const QImage &thumbnail)
+{
+    if (frameIndex < 0 || frameIndex >= frameList.size() || thumbnail.isNull()) {
+        return;
+    }
+
+    frameList[frameIndex]->setIcon(QIcon(QPixmap::fromImage(thumbnail)));
+}
+
+/**
+ * @brief MainWindow::showProgress - Shows how far a long edit has got. Edits over every frame run while the
+ * event loop waits for them, so the status bar is repainted straight away
+ * @param done - How many frames are done
+ * @param total - How many frames there are
+ */
+void MainWindow::showProgress(int done, int total)
+{
+    ui->statusbar->showMessage(done < total ? tr("Processing frames: %1 of %2").arg(done).arg(total) : QString());
+    ui->statusbar->repaint();
+}
+
+/**
+ * @brief MainWindow::showStatus - Shows a message in the status bar, such as save or load progress
+ * @param message
+ * @param timeout - How long to show the message in milliseconds, or 0 to keep it until replaced
+ */
+void MainWindow::showStatus(const QString &message, int timeout)
+{
+    ui->statusbar->showMessage(message, timeout);
+}
+
 /**
  * @brief MainWindow::keyPressEvent - Key press events
  * @param event
@@ -492,6 +879,10 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
         {
             emit toggleAnimation();
         }
+        else if (key == Qt::Key_F12)
+        {
+            ui->showProfilerAction->toggle(); // F12: Profiler overlay
+        }
         // The keys being pressed aren't relevant here,
         // but maybe it'll be something the canvas cares about
         canvas()->keyPressEvent(event);
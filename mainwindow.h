@@ -29,6 +29,7 @@
 
 #include "enums.h"
 #include "canvas.h"
+#include "framefilter.h"
 #include "ui_mainwindow.h"
 
 QT_BEGIN_NAMESPACE
@@ -50,14 +51,18 @@ public:
     /// Accessor for the canvas
     Canvas *canvas();
 
-    /// Canvas update methods
-    void updateCanvas(QImage image);
+    /// Size the animation preview is scaled to fit, invalid when shown at actual size
+    QSize animationPreviewSize();
+
+    /// Frame list update method
     void addFramesToList(int count);
 
 signals:
     /// Tool related signals
     void selectActiveTool(ToolType tool);
     void selectBrushSettings(int size, QColor &color);
+    void selectFillSettings(FillMode mode, int tolerance);
+    void selectBrushShape(BrushShape shape);
     void setPenColor(const QColor &color);
 
     /// Undo and redo signals
@@ -69,8 +74,26 @@ signals:
     void addFrame();
     void deleteFrame();
     void moveFrame(int fromIndex, int toIndex);
-    void resizeCanvas(int width, int height);
+    void resizeCanvas(int width, int height, ResizeAnchor anchor);
+    void scaleCanvas(int width, int height, ScaleFilter filter);
     void setFrame(int frameIndex);
+    void thumbnailsNeeded(int firstFrame, int lastFrame);
+
+    /// Layer related signals. Offsets are positive towards the top of the stack
+    void addLayer();
+    void deleteLayer();
+    void moveLayer(int offset);
+    void selectLayer(int offset);
+    void toggleLayerVisibility();
+    void setLayerOpacity(int percent);
+    void setLayerBlendMode(BlendMode blendMode);
+
+    /// Palette related signals. Replacing a palette color swaps the entry closest to `from` for `to`
+    void setIndexedColor(bool indexed);
+    void replacePaletteColor(QColor from, QColor to);
+
+    /// Filter related signal, for running a filter over every frame
+    void filterFrames(const FrameFilter::Settings &settings);
 
     /// Animation related signals
     void startAnimation(bool play);
@@ -80,16 +103,20 @@ signals:
     /// File related signals
     void saveFile(const QString &filePath);
     void loadFile(const QString &filePath);
+    void exportAnimation(const QString &filePath);
+    void exportAtlas(const QString &filePath);
     void newFile();
 
 public slots:
     /// Animation related Slot
-    void playAnimation(const QImage &frameImage);
+    void playAnimation(const QPixmap &preview);
 
 private slots:
     /// Tool related slots
     void colorButtonPressed();
     void brushSizeChanged();
+    void bucketMenuRequested(const QPoint &pos);
+    void brushMenuRequested(const QPoint &pos);
 
     /// Undo and redo slots
     void undoButtonPressed();
@@ -111,10 +138,19 @@ private slots:
     void saveFileAction();
     void openFileAction();
     void newFileAction();
+    void exportAnimationAction();
+    void exportAtlasAction();
 
 public slots:
     void recieveNewColor(QColor color);
-    void receiveAnimationFrameData(QImage frame, int delay);
+    void showFrameList(int frameCount, int currentFrame);
+    void showFPS(int fps);
+    void showStatus(const QString &message, int timeout = 0);
+    void requestVisibleThumbnails();
+    void showThumbnail(int frameIndex, const QImage &thumbnail);
+    void showIndexedColor(bool indexed);
+    void showCanvasSize(QSize size);
+    void showProgress(int done, int total);
     
 private:
     Ui::MainWindow *ui;
@@ -122,6 +158,7 @@ private:
     QList<QListWidgetItem *> frameList;
 
     QImage image;
+    QSize canvasSize;
     bool actualSize;
     bool changed;
 
@@ -133,11 +170,22 @@ private:
     void highlightSelectedTool(QPushButton *button);
     void connectFrameButtons();
     void connectFileActions();
+    void connectProfilerActions();
+    void connectLayerActions();
+    void connectPaletteActions();
+    void connectFilterActions();
     void connectAnimationButtons();
 
     /// Current color variable
     QColor currentColor = (QColor(Qt::black));
 
+    /// Current brush shape
+    BrushShape brushShape = BrushShape::Square;
+
+    /// Current bucket fill settings
+    FillMode fillMode = FillMode::FourConnected;
+    int fillTolerance = 0;
+
 protected:
     /// helper method to draw when a mouse occurs
     void drawOnEvent(QMouseEvent *event);
@@ -17,13 +17,18 @@
  *
 */
 
+#include <QDebug>
 #include <QImage>
-#include <QLabel>
 #include <QObject>
-#include <QPixmap>
+#include <QtConcurrent>
 #include <algorithm>
+#include <numeric>
 
+#include "blitter.h"
 #include "model.h"
+#include "palette.h"
+#include "profiler.h"
+#include "resampler.h"
 
 //-----Model-----//
 
@@ -53,221 +58,1509 @@ Model::Model(QObject *parent)
     : QObject(parent)
     , frames()
     , canvasSettings(QVector2D(frames.first().width(), frames.first().height()))
-    , justUndid(false)
 {
     connect(&toolBar, &ToolBar::colorChanged, this, &Model::recievePenColor);
+
+    playTimer.setSingleShot(true);
+    playTimer.setTimerType(Qt::PreciseTimer);
+    connect(&playTimer, &QTimer::timeout, this, &Model::playAnimationFrames);
+}
+
+//-----Model::Frames-----//
+
+/**
+ * @brief Model::Frames::Frames - Constructor for the Frames class
+ * @param width
+ * @param height
+ */
+Model::Frames::Frames(uint width, uint height)
+    : cacheBudget(DEFAULT_CACHE_BUDGET)
+    , chunkCache(std::make_shared<ChunkCache>())
+{
+    generateFrame(width, height);
+}
+
+/**
+ * @brief Model::Frames::Frames - Default constructor for Frames with default size
+ */
+Model::Frames::Frames()
+    : Model::Frames::Frames(64, 64)
+{}
+
+/**
+ * @brief Model::Frames::generateFrame - Generate a new frame with the specified width and height. While
+ * frames are indexed, it's filled with the palette entry closest to white
+ * @param width
+ * @param height
+ */
+void Model::Frames::generateFrame(int width, int height)
+{
+    if (!palette.isEmpty())
+    {
+        QImage indexedFrame(width, height, QImage::Format_Indexed8);
+        indexedFrame.setColorTable(palette);
+        indexedFrame.fill(uint(Palette::nearest(palette, qRgb(255, 255, 255))));
+        push(indexedFrame);
+        frames.back().paletteRevision = paletteRevision;
+        return;
+    }
+
+    QImage defaultFrame(width, height, QImage::Format_RGB32);
+    defaultFrame.fill(QColor(Qt::white));
+    push(defaultFrame);
+}
+
+/**
+ * @brief Model::Frames::numFrames - Returns the number of frames in our vector
+ * @return
+ */
+uint Model::Frames::numFrames()
+{
+    return frames.size();
+}
+
+/**
+ * @brief Model::Frames::materialize - Decodes the frame at index if it's only held compressed or tiled,
+ * making room for it by evicting the least recently used frames first
+ * @param index
+ * @return
+ */
+Model::Frames::StoredFrame &Model::Frames::materialize(uint index)
+{
+    StoredFrame &frame = storedFrame(index);
+    frame.lastUsed = ++useCounter;
+
+    if (frame.image.isNull())
+    {
+        frame.image = frame.tilesValid ? frame.tiles.toImage() : frame.chunk.decode();
+
+        // Tiles and chunks keep the palette the frame had when they were made
+        if (!palette.isEmpty() && frame.image.format() == QImage::Format_Indexed8)
+        {
+            frame.image.setColorTable(palette);
+        }
+
+        // A damaged chunk still has to give the tools something to draw on
+        if (frame.image.isNull())
+        {
+            qDebug() << "frame" << index << "could not be decoded, replacing it with a blank frame";
+            frame.image = QImage(qMax(frame.chunk.width, 1), qMax(frame.chunk.height, 1), QImage::Format_RGB32);
+            frame.image.fill(QColor(Qt::white));
+            frame.chunk = FrameChunk();
+            frame.tilesValid = false;
+            frame.revision = ++revisionCounter;
+            frame.imageKey = 0;
+        }
+
+        // A copy handed out before the frame was last evicted is still recognised by its old key
+        if (frame.imageKey == 0)
+        {
+            frame.imageKey = frame.image.cacheKey();
+        }
+
+        evictFor(index);
+    }
+
+    return frame;
+}
+
+/**
+ * @brief Model::Frames::evictFor - Drops decoded frames from memory, least recently used first, until
+ * the decoded frames fit in the cache budget. Frames that have tiles or a compressed copy are simply
+ * dropped; edited frames are tiled first so no work is lost. Tiling is much cheaper than compressing,
+ * and only the tiles the edit touched are copied. The pinned frame is never dropped
+ * @param keepIndex - A frame that must stay decoded
+ */
+void Model::Frames::evictFor(uint keepIndex)
+{
+    qsizetype decodedBytes = 0;
+    for (const StoredFrame &frame : frames)
+    {
+        decodedBytes += frame.image.sizeInBytes();
+    }
+
+    while (decodedBytes > cacheBudget)
+    {
+        StoredFrame *oldest = nullptr;
+        for (uint i = 0; i < frames.size(); i++)
+        {
+            StoredFrame &frame = frames[i];
+            if (i != keepIndex && !frame.pinned && !frame.image.isNull()
+                && (oldest == nullptr || frame.lastUsed < oldest->lastUsed))
+            {
+                oldest = &frame;
+            }
+        }
+
+        if (oldest == nullptr)
+        {
+            return;
+        }
+
+        // A frame unedited since it was last saved can fall back on the chunk that was written
+        if (oldest->chunk.isEmpty() && !oldest->layers)
+        {
+            oldest->chunk = chunkCache->find(oldest->image);
+        }
+        if (!oldest->tilesValid && oldest->chunk.isEmpty())
+        {
+            oldest->tiles = TiledImage::fromImage(oldest->image, oldest->tiles);
+            oldest->tilesValid = true;
+        }
+        decodedBytes -= oldest->image.sizeInBytes();
+        oldest->image = QImage();
+    }
+}
+
+/**
+ * @brief Model::Frames::get - Gets the frame at a specifc indoex in our vector for editing. Its
+ * compressed copy is dropped and its tiles marked out of date, since the frame may no longer match them
+ * @param index
+ * @param layer - For a frame with layers, the layer to edit, or -1 for the active layer
+ * @return
+ */
+QImage &Model::Frames::get(uint index, int layer)
+{
+    if (LayerStack *stack = storedFrame(index).layers.get())
+    {
+        touch(index);
+        return stack->editImage(layer < 0 ? stack->activeIndex() : layer);
+    }
+
+    StoredFrame &frame = materialize(index);
+    frame.chunk = FrameChunk();
+    frame.tilesValid = false;
+    frame.revision = ++revisionCounter;
+    frame.imageKey = 0;
+    return frame.image;
+}
+
+/**
+ * @brief Model::Frames::set - Replaces the frame at index. Handing back an image that still shares its
+ * pixels with the stored frame, like an unedited copy from `read`, is recognised and does nothing
+ * @param index
+ * @param frame
+ */
+void Model::Frames::set(uint index, const QImage &frame)
+{
+    assert(frames.size() > index);
+    StoredFrame &stored = frames.at(index);
+    if (stored.layers)
+    {
+        if (stored.layers->setImage(stored.layers->activeIndex(), frame))
+        {
+            stored.paletteRevision = 0;
+            touch(index);
+        }
+        return;
+    }
+
+    if (stored.imageKey != 0 && stored.imageKey == frame.cacheKey())
+    {
+        return;
+    }
+
+    stored.image = frame;
+    stored.chunk = FrameChunk();
+    stored.tilesValid = false;
+    stored.lastUsed = ++useCounter;
+    stored.revision = ++revisionCounter;
+    stored.imageKey = frame.cacheKey();
+
+    // An indexed image drawn on before the palette last changed still holds the old palette
+    stored.paletteRevision = 0;
+    evictFor(index);
+}
+
+/**
+ * @brief Model::Frames::read - Gets the frame at a specific index in our vector for reading
+ * @param index
+ * @return
+ */
+const QImage &Model::Frames::read(uint index)
+{
+    if (LayerStack *stack = storedFrame(index).layers.get())
+    {
+        return stack->composite();
+    }
+    return materialize(index).image;
+}
+
+/**
+ * @brief Model::Frames::editBuffer - Gets the buffer the tools draw on for the frame at index, and pins
+ * the frame so the buffer isn't dropped while it's shown. Handing out the frame's own pixels, instead of
+ * a copy that's stored back afterwards, means neither has to be copied when the first pixel is drawn
+ * @param index
+ * @return The active layer, or the frame itself if it has no layers
+ */
+QImage &Model::Frames::editBuffer(uint index)
+{
+    for (StoredFrame &frame : frames)
+    {
+        frame.pinned = false;
+    }
+
+    // A frame with layers has no image of its own to decode, so the active layer is handed out as it is
+    StoredFrame &frame = storedFrame(index);
+    frame.pinned = true;
+    if (LayerStack *stack = frame.layers.get())
+    {
+        return stack->imageBuffer(stack->activeIndex());
+    }
+    return materialize(index).image;
+}
+
+/**
+ * @brief Model::Frames::isEditBuffer - Checks whether an image is the frame's edit buffer by its address alone
+ * @param index
+ * @param image
+ * @return True if `image` is the frame's active layer, or the frame itself if it has no layers
+ */
+bool Model::Frames::isEditBuffer(uint index, const QImage *image) const
+{
+    assert(frames.size() > index);
+    const StoredFrame &frame = frames.at(index);
+    if (LayerStack *stack = frame.layers.get())
+    {
+        return image == &stack->imageBuffer(stack->activeIndex());
+    }
+    return image == &frame.image;
+}
+
+/**
+ * @brief Model::Frames::markEdited - Records that the frame at index was drawn on in place. Its tiles and
+ * compressed copy no longer match it, so they're dropped, and its new revision has thumbnails made again
+ * @param index
+ * @param area - The pixels that changed, composited again on a frame with layers
+ */
+void Model::Frames::markEdited(uint index, QRect area)
+{
+    StoredFrame &frame = storedFrame(index);
+    if (LayerStack *stack = frame.layers.get())
+    {
+        stack->markDirty(area);
+        touch(index);
+        return;
+    }
+
+    frame.chunk = FrameChunk();
+    frame.tilesValid = false;
+    frame.revision = ++revisionCounter;
+    frame.imageKey = 0;
+    frame.lastUsed = ++useCounter;
+}
+
+/**
+ * @brief Model::Frames::layers - Gets the layers of the frame at index
+ * @param index
+ * @return The layers, or null if the frame is a single image
+ */
+LayerStack *Model::Frames::layers(uint index)
+{
+    return storedFrame(index).layers.get();
+}
+
+/**
+ * @brief Model::Frames::layerStack - Gets the layers of the frame at index, shared with the frame
+ * @param index
+ * @return The layers, or null if the frame is a single image
+ */
+std::shared_ptr<LayerStack> Model::Frames::layerStack(uint index)
+{
+    return storedFrame(index).layers;
+}
+
+/**
+ * @brief Model::Frames::editLayers - Gets the layers of the frame at index for editing. A single image
+ * frame becomes a stack holding just that image. The frame's own image, compressed copy and tiles are
+ * dropped, since from here on the layers are what the frame is
+ * @param index
+ * @return
+ */
+LayerStack &Model::Frames::editLayers(uint index)
+{
+    StoredFrame &frame = storedFrame(index);
+    if (!frame.layers)
+    {
+        frame.layers = std::make_shared<LayerStack>(materialize(index).image);
+        frame.image = QImage();
+        frame.chunk = FrameChunk();
+        frame.imageKey = 0;
+    }
+    touch(index);
+    return *frame.layers;
+}
+
+/**
+ * @brief Model::Frames::setLayers - Replaces the layers of the frame at index, such as with the layers
+ * it had before an undone change
+ * @param index
+ * @param stack - The new layers, or null to flatten the frame into a single image
+ */
+void Model::Frames::setLayers(uint index, std::shared_ptr<LayerStack> stack)
+{
+    assert(frames.size() > index);
+    StoredFrame &frame = frames.at(index);
+    if (!stack && !frame.layers)
+    {
+        return;
+    }
+
+    if (stack)
+    {
+        frame.image = QImage();
+        frame.chunk = FrameChunk();
+        frame.imageKey = 0;
+    }
+    else
+    {
+        frame.image = frame.layers->composite();
+        frame.imageKey = frame.image.cacheKey();
+        frame.lastUsed = ++useCounter;
+    }
+    frame.layers = std::move(stack);
+
+    // Layers from the history may still hold an older palette
+    frame.paletteRevision = 0;
+    touch(index);
+    evictFor(index);
+}
+
+/**
+ * @brief Model::Frames::touch - Gives the frame at index a new revision, and marks its tiles out of date
+ * @param index
+ */
+void Model::Frames::touch(uint index)
+{
+    assert(frames.size() > index);
+    StoredFrame &frame = frames.at(index);
+    frame.revision = ++revisionCounter;
+    frame.tilesValid = false;
+}
+
+/**
+ * @brief Model::Frames::first - Returns the frame at the front of our vector
+ * @return
+ */
+QImage Model::Frames::first()
+{
+    return read(0);
+}
+
+/**
+ * @brief Model::Frames::last - Returns the frame at the back of our vector
+ * @return
+ */
+QImage Model::Frames::last()
+{
+    return read(frames.size() - 1);
+}
+
+/**
+ * @brief Model::Frames::push - Pushes back the input parameter frame into our frame vector
+ * @param frame
+ */
+void Model::Frames::push(QImage frame)
+{
+    frames.push_back({frame, FrameChunk(), ++useCounter, ++revisionCounter, frame.cacheKey()});
+    evictFor(frames.size() - 1);
+}
+
+/**
+ * @brief Model::Frames::pushCompressed - Pushes back a compressed frame. Nothing is decoded until the
+ * frame is first used
+ * @param chunk
+ */
+void Model::Frames::pushCompressed(FrameChunk chunk)
+{
+    frames.push_back({QImage(), chunk, 0, ++revisionCounter, 0});
 }
 
-//-----Model::Frames-----//
+/**
+ * @brief Model::Frames::insert - Inserts the parameter frame at the specified index
+ * @param frame
+ * @param index
+ */
+void Model::Frames::insert(QImage frame, uint index)
+{
+    frames.insert(frames.begin() + index, {frame, FrameChunk(), ++useCounter, ++revisionCounter, frame.cacheKey()});
+    evictFor(index);
+}
+
+/**
+ * @brief Model::Frames::insertTiled - Inserts a tiled frame at the specified index. Nothing is decoded
+ * until the frame is first used
+ * @param frame
+ * @param index
+ */
+void Model::Frames::insertTiled(TiledImage frame, uint index)
+{
+    StoredFrame stored;
+    stored.revision = ++revisionCounter;
+    stored.tiles = std::move(frame);
+    stored.tilesValid = true;
+    frames.insert(frames.begin() + index, std::move(stored));
+}
+
+/**
+ * @brief Model::Frames::remove - Removes the frame at the specifc index in our frame vector
+ * @param index
+ */
+void Model::Frames::remove(uint index)
+{
+    assert(frames.size() > index);
+    frames.erase(frames.begin() + index);
+}
+
+/**
+ * @brief Model::Frames::pop - Pops the frame in our vector
+ */
+void Model::Frames::pop()
+{
+    frames.pop_back();
+}
+
+/**
+ * @brief Model::Frames::swap - Swaps two frames in our vector at the specifed index parameters
+ * @param firstIndex
+ * @param secondIndex
+ */
+void Model::Frames::swap(int firstIndex, int secondIndex)
+{
+    std::iter_swap(frames.begin() + firstIndex, frames.begin() + secondIndex);
+}
+
+/**
+ * @brief Model::Frames::clearFrames - Clears our entire vector of frames, going back to 32 bit color
+ */
+void Model::Frames::clearFrames()
+{
+    frames.clear();
+    palette.clear();
+    ++paletteRevision;
+    chunkCache->clear();
+}
+
+/**
+ * @brief Model::Frames::exchange - Swaps our entire vector of frames with another one. Tiles and layers
+ * are shared, so no pixels are copied, but edited frames are tiled on the way out
+ * @param otherFrames
+ * @param otherLayers - The layers of each of `otherFrames`, null for single image frames
+ */
+void Model::Frames::exchange(std::vector<TiledImage> &otherFrames,
+                             std::vector<std::shared_ptr<LayerStack>> &otherLayers)
+{
+    std::vector<TiledImage> ourFrames;
+    std::vector<std::shared_ptr<LayerStack>> ourLayers;
+    ourFrames.reserve(frames.size());
+    ourLayers.reserve(frames.size());
+    for (uint i = 0; i < frames.size(); i++)
+    {
+        ourFrames.push_back(tiled(i));
+        ourLayers.push_back(frames[i].layers);
+    }
+
+    frames.clear();
+    for (uint i = 0; i < otherFrames.size(); i++)
+    {
+        insertTiled(std::move(otherFrames[i]), i);
+        if (i < otherLayers.size() && otherLayers[i])
+        {
+            setLayers(i, std::move(otherLayers[i]));
+        }
+    }
+
+    otherFrames.swap(ourFrames);
+    otherLayers.swap(ourLayers);
+}
+
+/**
+ * @brief Model::Frames::compressed - Returns the compressed copy of a frame, which is only available
+ * if the frame hasn't been edited since it was loaded, saved or evicted. An indexed chunk is given the current
+ * palette, since the palette may have changed without touching the frame
+ * @param index
+ * @return
+ */
+FrameChunk Model::Frames::compressed(uint index)
+{
+    assert(frames.size() > index);
+    StoredFrame &frame = frames.at(index);
+    if (frame.chunk.isEmpty() && !frame.layers)
+    {
+        frame.chunk = chunkCache->find(frame.image);
+    }
+
+    FrameChunk chunk = frame.chunk;
+    if (!palette.isEmpty() && chunk.format == QImage::Format_Indexed8)
+    {
+        chunk.colorTable = palette;
+    }
+    return chunk;
+}
+
+/**
+ * @brief Model::Frames::savedChunks - Returns the chunks the last save wrote. Saving fills it, so the
+ * next save only compresses what was edited since
+ * @return
+ */
+std::shared_ptr<ChunkCache> Model::Frames::savedChunks()
+{
+    return chunkCache;
+}
+
+/**
+ * @brief Model::Frames::tiled - Returns the frame at index as shared tiles. A frame edited since it was
+ * last tiled is tiled again against its old tiles, so only the tiles that changed are copied
+ * @param index
+ * @return
+ */
+TiledImage Model::Frames::tiled(uint index)
+{
+    StoredFrame &frame = storedFrame(index);
+    if (!frame.tilesValid)
+    {
+        QImage image = frame.layers ? frame.layers->composite()
+                       : frame.image.isNull() ? materialize(index).image
+                                              : frame.image;
+        frame.tiles = TiledImage::fromImage(image, frame.tiles);
+        frame.tilesValid = true;
+    }
+    return frame.tiles;
+}
+
+/**
+ * @brief Model::Frames::detachFromFile - Copies compressed frames that point into a memory-mapped
+ * project file into memory of their own. Once nothing points into it, the file is unmapped and closed
+ */
+void Model::Frames::detachFromFile()
+{
+    for (StoredFrame &frame : frames)
+    {
+        frame.chunk = frame.chunk.detached();
+    }
+}
+
+/**
+ * @brief Model::Frames::isDecoded - Returns true if the frame at index is decoded in memory
+ * @param index
+ * @return
+ */
+bool Model::Frames::isDecoded(uint index)
+{
+    assert(frames.size() > index);
+    return !frames.at(index).image.isNull() || frames.at(index).layers;
+}
+
+/**
+ * @brief Model::Frames::revision - Returns the revision of the frame at index. It changes whenever the
+ * frame is handed out for editing or replaced, but not when it's moved, compressed or decoded
+ * @param index
+ * @return
+ */
+quint64 Model::Frames::revision(uint index)
+{
+    assert(frames.size() > index);
+    return frames.at(index).revision;
+}
+
+/**
+ * @brief Model::Frames::setCacheBudget - Sets how many bytes of decoded frames are kept in memory,
+ * evicting frames right away if there are too many
+ * @param bytes
+ */
+void Model::Frames::setCacheBudget(qsizetype bytes)
+{
+    cacheBudget = bytes;
+    if (!frames.empty())
+    {
+        evictFor(frames.size());
+    }
+}
+
+/**
+ * @brief Model::Frames::isIndexed - Returns true if frames are stored as palette indices
+ * @return
+ */
+bool Model::Frames::isIndexed()
+{
+    return !palette.isEmpty();
+}
+
+/**
+ * @brief Model::Frames::getPalette - Returns the palette every indexed frame uses
+ * @return The palette, or an empty list while frames hold 32 bit colors
+ */
+const QList<QRgb> &Model::Frames::getPalette()
+{
+    return palette;
+}
+
+/**
+ * @brief Model::Frames::setPalette - Replaces the shared palette. No frame is touched here: each one is
+ * given the new palette the next time it's used, and its pixels, tiles and compressed copy stay valid
+ * since only the colors the indices stand for changed. Every frame gets a new revision, so previews of
+ * it are made again
+ * @param colors - The new palette, or an empty list for 32 bit color
+ */
+void Model::Frames::setPalette(const QList<QRgb> &colors)
+{
+    palette = colors;
+    ++paletteRevision;
+    for (StoredFrame &frame : frames)
+    {
+        frame.revision = ++revisionCounter;
+    }
+}
+
+/**
+ * @brief Model::Frames::storedFrame - Returns the frame at index. If the palette changed since the frame was
+ * last used, its decoded image and layers are given the new one first
+ * @param index
+ * @return
+ */
+Model::Frames::StoredFrame &Model::Frames::storedFrame(uint index)
+{
+    assert(frames.size() > index);
+    StoredFrame &frame = frames.at(index);
+    if (frame.paletteRevision == paletteRevision)
+    {
+        return frame;
+    }
+
+    frame.paletteRevision = paletteRevision;
+    if (palette.isEmpty())
+    {
+        return frame;
+    }
+
+    if (frame.image.format() == QImage::Format_Indexed8 && frame.image.colorTable() != palette)
+    {
+        // The image is still the one stored, so a copy handed back unedited must still be recognised
+        bool unedited = frame.imageKey != 0;
+        frame.image.setColorTable(palette);
+        frame.imageKey = unedited ? frame.image.cacheKey() : 0;
+    }
+    if (frame.layers)
+    {
+        frame.layers->setColorTable(palette);
+    }
+    return frame;
+}
+
+/**
+ * @brief Model::Frames::setFramePixel - Sets a pixel point of the specific frame with a specific color
+ * @param frame
+ * @param x
+ * @param y
+ * @param color
+ */
+void Model::Frames::setFramePixel(QImage &frame, int x, int y, uint color)
+{
+    frame.setPixel(x, y, color);
+}
+
+/**
+ * @brief Model::beginStroke - Starts recording a stroke for undo. Pixels are only copied once a tool
+ * is about to draw over them, so this doesn't copy the frame
+ * @param image
+ */
+void Model::beginStroke(QImage *image)
+{
+    uint index = getCanvasSettings().getCurrentFrameIndex();
+    LayerStack *stack = frames.layers(index);
+    strokeLayer = stack != nullptr ? stack->activeIndex() : 0;
+    strokeArea = QRect();
+    history.beginStroke(*image, index, strokeLayer);
+    clickDrawn = false;
+    strokeHasPoint = false;
+}
+
+/**
+ * @brief Model::endStroke - Stores what the stroke changed in the undo history and the journal, and marks
+ * the current frame as edited. Nothing is copied, since the stroke was drawn on the frame itself
+ * @param image
+ */
+void Model::endStroke(QImage *image)
+{
+    Profiler::Scope scope("undo record");
+    // A stroke that changed nothing leaves the frame, and its thumbnail, as they were
+    if (history.endStroke(*image))
+    {
+        // Strokes drawn on the frame's own buffer only need marking. Anything else is stored as the frame,
+        // sharing its pixels
+        uint index = getCanvasSettings().getCurrentFrameIndex();
+        if (frames.isEditBuffer(index, image))
+        {
+            frames.markEdited(index, strokeArea);
+        }
+        else
+        {
+            frames.set(index, *image);
+        }
+        journalPixels(index, strokeLayer, *image, strokeArea);
+        emit framesEdited();
+    }
+}
+
+/**
+ * @brief Model::undo - Undo logic
+ */
+void Model::undo()
+{
+    Profiler::Scope scope("undo");
+    history.undo([this](UndoHistory::Change &change) { applyChange(change, true); });
+}
+
+/**
+ * @brief Model::redo - Redo logic
+ */
+void Model::redo()
+{
+    Profiler::Scope scope("redo");
+    history.redo([this](UndoHistory::Change &change) { applyChange(change, false); });
+}
+
+/**
+ * @brief Model::applyChange - Undoes or redoes a change from the history. Changes can belong to any
+ * frame, so the change's frame becomes the current frame and the view is told about it
+ * @param change - The change to undo or redo. Frames leaving the document are stored back into it
+ * @param undoing - True to undo the change, false to redo it
+ */
+void Model::applyChange(UndoHistory::Change &change, bool undoing)
+{
+    uint currentIndex = getCanvasSettings().getCurrentFrameIndex();
+
+    // Inserting and removing a frame are opposites of each other
+    bool insertingFrame = (change.action == HistoryAction::InsertFrame) != undoing;
+
+    switch (change.action)
+    {
+    case HistoryAction::EditPixels:
+    {
+        QImage &image = frames.get(change.frameIndex, change.layerIndex);
+        UndoHistory::applyDelta(image, change.delta, undoing);
+        journalPixels(change.frameIndex, change.layerIndex, image, change.delta.area);
+        currentIndex = change.frameIndex;
+        break;
+    }
+    case HistoryAction::InsertFrame:
+    case HistoryAction::RemoveFrame:
+    {
+        if (insertingFrame)
+        {
+            frames.insertTiled(change.frame, change.frameIndex);
+            frames.setLayers(change.frameIndex, std::move(change.layers));
+            change.frame = TiledImage();
+            change.layers.reset();
+            currentIndex = change.frameIndex;
+        }
+        else
+        {
+            change.frame = frames.tiled(change.frameIndex);
+            change.layers = frames.layerStack(change.frameIndex);
+            frames.remove(change.frameIndex);
+            currentIndex = change.frameIndex > 0 ? change.frameIndex - 1 : 0;
+        }
+        break;
+    }
+    case HistoryAction::SwapFrames:
+    {
+        journalEdit(JournalAction::MoveFrame, change.frameIndex, change.otherFrameIndex);
+        frames.swap(change.frameIndex, change.otherFrameIndex);
+        currentIndex = undoing ? change.frameIndex : change.otherFrameIndex;
+        break;
+    }
+    case HistoryAction::ResizeFrames:
+    {
+        frames.exchange(change.frames, change.frameLayers);
+        break;
+    }
+    case HistoryAction::EditLayers:
+    {
+        std::shared_ptr<LayerStack> current = frames.layerStack(change.frameIndex);
+        frames.setLayers(change.frameIndex, std::move(change.layers));
+        change.layers = std::move(current);
+        currentIndex = change.frameIndex;
+        break;
+    }
+    case HistoryAction::ConvertFrames:
+    case HistoryAction::EditPalette:
+    {
+        if (change.action == HistoryAction::ConvertFrames)
+        {
+            frames.exchange(change.frames, change.frameLayers);
+        }
+        QList<QRgb> current = frames.getPalette();
+        frames.setPalette(change.palette);
+        change.palette = std::move(current);
+        break;
+    }
+    }
+
+    // Strokes and swaps are journaled like any other edit. What the rest restore is only held by the
+    // history, so replaying has to stop here, and the journal is checkpointed past it instead
+    if (change.action != HistoryAction::EditPixels && change.action != HistoryAction::SwapFrames)
+    {
+        journalEdit(JournalAction::Barrier);
+    }
+
+    getCanvasSettings().setCurrentFrameIndex(currentIndex);
+
+    emit frameListChanged(frames.numFrames(), currentIndex);
+    emit updateCanvas(currentIndex);
+    emit framesEdited();
+}
 
 /**
- * @brief Model::Frames::Frames - Constructor for the Frames class
- * @param width
- * @param height
+ * @brief Model::addFrame - Adds a blank frame, the size of the current one, to the end of the animation
+ * and makes it the current frame
  */
-Model::Frames::Frames(uint width, uint height)
+void Model::addFrame()
 {
-    generateFrame(width, height);
+    journalEdit(JournalAction::AddFrame);
+
+    const QImage &current = frames.read(getCanvasSettings().getCurrentFrameIndex());
+    frames.generateFrame(current.width(), current.height());
+
+    UndoHistory::Change change;
+    change.action = HistoryAction::InsertFrame;
+    change.frameIndex = frames.numFrames() - 1;
+    history.push(std::move(change));
+
+    getCanvasSettings().setCurrentFrameIndex(frames.numFrames() - 1);
+    emit framesEdited();
 }
 
 /**
- * @brief Model::Frames::Frames - Default constructor for Frames with default size
+ * @brief Model::deleteFrame - Removes the frame at `index`. The removed frame is kept by the history
+ * as shared tiles rather than copied, so it can be brought back with undo
+ * @param index
  */
-Model::Frames::Frames()
-    : Model::Frames::Frames(64, 64)
-{}
+void Model::deleteFrame(uint index)
+{
+    journalEdit(JournalAction::DeleteFrame, index);
+
+    UndoHistory::Change change;
+    change.action = HistoryAction::RemoveFrame;
+    change.frameIndex = index;
+    change.frame = frames.tiled(index);
+    change.layers = frames.layerStack(index);
+
+    frames.remove(index);
+    history.push(std::move(change));
+
+    // Only modify the current frame index if the deleted frame is not the first (index 0)
+    if (index > 0)
+    {
+        getCanvasSettings().setCurrentFrameIndex(index - 1);
+    }
+    emit framesEdited();
+}
 
 /**
- * @brief Model::Frames::generateFrame - Generate a new frame with the specified width and height
- * @param width
- * @param height
+ * @brief Model::moveFrame - Swaps two frames and makes `toIndex` the current frame
+ * @param fromIndex
+ * @param toIndex
  */
-void Model::Frames::generateFrame(int width, int height)
+void Model::moveFrame(uint fromIndex, uint toIndex)
 {
-    QImage defaultFrame(width, height, QImage::Format_RGB32);
-    defaultFrame.fill(QColor(Qt::white));
-    frames.push_back(defaultFrame);
+    journalEdit(JournalAction::MoveFrame, fromIndex, toIndex);
+    frames.swap(fromIndex, toIndex);
+
+    UndoHistory::Change change;
+    change.action = HistoryAction::SwapFrames;
+    change.frameIndex = fromIndex;
+    change.otherFrameIndex = toIndex;
+    history.push(std::move(change));
+
+    getCanvasSettings().setCurrentFrameIndex(toIndex);
+    emit framesEdited();
 }
 
 /**
- * @brief Model::Frames::numFrames - Returns the number of frames in our vector
- * @return
+ * @brief Model::resizeFrames - Crops or extends every frame to `width` x `height`, keeping the edge or
+ * corner `anchor` names in place and filling new space with white. The old frames are kept by the history
+ * @param width
+ * @param height
+ * @param anchor
  */
-uint Model::Frames::numFrames()
+void Model::resizeFrames(int width, int height, ResizeAnchor anchor)
 {
-    return frames.size();
+    journalEdit(JournalAction::ResizeFrames, width, height, qint32(anchor));
+    QSize size(width, height);
+    transformFrames([size, anchor](const QImage &image, QColor fill) {
+        return Resampler::resizeCanvas(image, size, anchor, fill);
+    });
 }
 
 /**
- * @brief Model::Frames::get - Gets the frame at a specifc indoex in our vector
- * @param index
- * @return
+ * @brief Model::scaleFrames - Scales every frame with `filter`. Nearest neighbour sampling scales to
+ * `width` x `height`, and the pixel art filters by their own factor. The old frames are kept by the history
+ * @param width
+ * @param height
+ * @param filter
  */
-QImage &Model::Frames::get(uint index)
+void Model::scaleFrames(int width, int height, ScaleFilter filter)
 {
-    assert(frames.size() > index);
-    return frames.at(index);
+    journalEdit(JournalAction::ScaleFrames, width, height, qint32(filter));
+    QSize size(width, height);
+    transformFrames([size, filter](const QImage &image, QColor) {
+        return Resampler::scale(image, size, filter);
+    });
 }
 
 /**
- * @brief Model::Frames::first - Returns the frame at the front of our vector
- * @return
+ * @brief Model::filterFrames - Runs a filter over every frame. A color filter on indexed frames only needs
+ * to recolor the shared palette, which is recorded for undo like any palette edit. Every other filter runs
+ * over the pixels of each frame and layer in parallel, and the old frames are kept by the history
+ * @param settings - Which filter to run, and how
  */
-QImage Model::Frames::first()
+void Model::filterFrames(const FrameFilter::Settings &settings)
 {
-    return frames.front();
+    // The drop shadow offset or the hue and saturation shift fit the integer arguments, and the value
+    // shift the amount. A replaced color is the only filter with two colors, so its replacement goes in
+    // the second argument
+    bool shadow = settings.type == FilterType::DropShadow;
+    journalEdit(JournalAction::FilterFrames,
+                qint32(settings.type),
+                settings.type == FilterType::ReplaceColor ? qint32(settings.replacement)
+                : shadow                                  ? settings.offset.x()
+                                                          : settings.hue,
+                shadow ? settings.offset.y() : settings.saturation,
+                settings.value,
+                settings.color);
+
+    QList<QRgb> palette = frames.getPalette();
+    if (!palette.isEmpty() && FrameFilter::mapsColors(settings.type))
+    {
+        UndoHistory::Change change;
+        change.action = HistoryAction::EditPalette;
+        change.palette = palette;
+        history.push(std::move(change));
+
+        for (int i = 0; i < int(palette.size()); i++)
+        {
+            if (i != Palette::TRANSPARENT_INDEX)
+            {
+                palette[i] = FrameFilter::mapColor(palette[i], settings);
+            }
+        }
+        frames.setPalette(palette);
+        emit framesTransformed(int(frames.numFrames()), int(frames.numFrames()));
+        emit framesEdited();
+        return;
+    }
+
+    transformFrames([settings](const QImage &image, QColor) { return FrameFilter::apply(image, settings); });
 }
 
 /**
- * @brief Model::Frames::last - Returns the frame at the back of our vector
- * @return
+ * @brief Model::transformFrames - Resizes or scales every frame at once. The frames are gathered here,
+ * since decoding them on demand isn't thread safe, then each one is decoded if needed, transformed and
+ * tiled on the thread pool. Frames with layers have each layer transformed and are composited again
+ * @param transform - Returns the new image for a frame or layer, given its pixels and the color of new space
  */
-QImage Model::Frames::last()
+void Model::transformFrames(const std::function<QImage(const QImage &image, QColor fill)> &transform)
 {
-    return frames.back();
+    uint count = frames.numFrames();
+    std::vector<std::shared_ptr<LayerStack>> sourceLayers(count);
+    std::vector<FrameChunk> sourceChunks(count);
+    std::vector<QImage> sourceImages(count);
+    for (uint i = 0; i < count; ++i)
+    {
+        sourceLayers[i] = frames.layerStack(i);
+        if (sourceLayers[i])
+        {
+            continue;
+        }
+
+        // Frames that weren't edited since they were loaded or saved are decoded on the thread pool
+        sourceChunks[i] = frames.compressed(i);
+        if (sourceChunks[i].isEmpty())
+        {
+            sourceImages[i] = frames.read(i);
+        }
+    }
+
+    std::vector<TiledImage> transformedFrames(count);
+    std::vector<std::shared_ptr<LayerStack>> transformedLayers(count);
+    std::vector<uint> indices(count);
+    std::iota(indices.begin(), indices.end(), 0u);
+
+    auto transformFrame = [&](uint i) {
+        if (sourceLayers[i])
+        {
+            auto stack = std::make_shared<LayerStack>(sourceLayers[i]->transformed(transform));
+            transformedFrames[i] = TiledImage::fromImage(stack->composite());
+            transformedLayers[i] = std::move(stack);
+            return;
+        }
+
+        QImage image = sourceImages[i].isNull() ? sourceChunks[i].decode() : sourceImages[i];
+        transformedFrames[i] = TiledImage::fromImage(transform(image, QColor(Qt::white)));
+    };
+
+    // Frames are handed to the thread pool in batches, so progress can be reported from this thread
+    // between them. Each batch still keeps every thread busy
+    uint batchSize = std::max(uint(QThreadPool::globalInstance()->maxThreadCount()) * 4, (count + 9) / 10);
+    for (uint first = 0; first < count; first += batchSize)
+    {
+        uint last = std::min(first + batchSize, count);
+        QtConcurrent::blockingMap(indices.begin() + first, indices.begin() + last, transformFrame);
+        emit framesTransformed(int(last), int(count));
+    }
+
+    // After the exchange the change holds the frames from before the resize
+    frames.exchange(transformedFrames, transformedLayers);
+
+    UndoHistory::Change change;
+    change.action = HistoryAction::ResizeFrames;
+    change.frames = std::move(transformedFrames);
+    change.frameLayers = std::move(transformedLayers);
+    history.push(std::move(change));
+    emit framesEdited();
 }
 
 /**
- * @brief Model::Frames::push - Pushes back the input parameter frame into our frame vector
- * @param frame
+ * @brief Model::recordLayers - Pushes a copy of the current frame's layers onto the history, so the
+ * edit about to be made to them can be undone. Layers share their pixels, so the copy is cheap
+ * @return The current frame's layers, ready to edit
  */
-void Model::Frames::push(QImage frame)
+LayerStack &Model::recordLayers()
 {
-    frames.push_back(frame);
+    uint index = getCanvasSettings().getCurrentFrameIndex();
+    LayerStack &stack = frames.editLayers(index);
+
+    UndoHistory::Change change;
+    change.action = HistoryAction::EditLayers;
+    change.frameIndex = index;
+    change.layers = std::make_shared<LayerStack>(stack);
+    history.push(std::move(change));
+    return stack;
 }
 
 /**
- * @brief Model::Frames::insert - Inserts the parameter frame at the specified index
- * @param frame
- * @param index
+ * @brief Model::addLayer - Adds a transparent layer above the active layer of the current frame and
+ * makes it active
  */
-void Model::Frames::insert(QImage frame, uint index)
+void Model::addLayer()
 {
-    frames.insert(frames.begin() + index, frame);
+    journalEdit(JournalAction::AddLayer);
+    LayerStack &stack = recordLayers();
+    stack.insertLayer(stack.activeIndex() + 1, QString("Layer %1").arg(stack.count()));
+    emit framesEdited();
 }
 
 /**
- * @brief Model::Frames::remove - Removes the frame at the specifc index in our frame vector
- * @param index
+ * @brief Model::deleteLayer - Removes the active layer of the current frame. A frame always keeps at
+ * least one layer
  */
-void Model::Frames::remove(uint index)
+void Model::deleteLayer()
 {
-    assert(frames.size() > index);
-    frames.erase(frames.begin() + index);
+    LayerStack *stack = frames.layers(getCanvasSettings().getCurrentFrameIndex());
+    if (stack == nullptr || stack->count() <= 1)
+    {
+        return;
+    }
+
+    journalEdit(JournalAction::DeleteLayer);
+    LayerStack &edited = recordLayers();
+    edited.removeLayer(edited.activeIndex());
+    emit framesEdited();
 }
 
 /**
- * @brief Model::Frames::pop - Pops the frame in our vector
+ * @brief Model::moveLayer - Moves the active layer of the current frame up or down the stack
+ * @param offset - Positive to move towards the top
  */
-void Model::Frames::pop()
+void Model::moveLayer(int offset)
 {
-    frames.pop_back();
+    LayerStack *stack = frames.layers(getCanvasSettings().getCurrentFrameIndex());
+    if (stack == nullptr)
+    {
+        return;
+    }
+
+    int target = stack->activeIndex() + offset;
+    if (target < 0 || target >= stack->count() || offset == 0)
+    {
+        return;
+    }
+
+    journalEdit(JournalAction::MoveLayer, offset);
+    LayerStack &edited = recordLayers();
+    edited.moveLayer(edited.activeIndex(), target);
+    emit framesEdited();
 }
 
 /**
- * @brief Model::Frames::swap - Swaps two frames in our vector at the specifed index parameters
- * @param firstIndex
- * @param secondIndex
+ * @brief Model::selectLayer - Makes the layer above or below the active one active. Which layer is
+ * active doesn't change the frame, so this isn't recorded for undo
+ * @param offset - Positive to select towards the top
  */
-void Model::Frames::swap(int firstIndex, int secondIndex)
+void Model::selectLayer(int offset)
 {
-    std::iter_swap(frames.begin() + firstIndex, frames.begin() + secondIndex);
+    if (LayerStack *stack = frames.layers(getCanvasSettings().getCurrentFrameIndex()))
+    {
+        // New layers go above the active one, so which layer is active still matters when replaying
+        journalEdit(JournalAction::SelectLayer, offset);
+        stack->setActiveIndex(stack->activeIndex() + offset);
+    }
 }
 
 /**
- * @brief Model::Frames::clearFrames - Clears our entire vector of frames
+ * @brief Model::setLayerVisible - Shows or hides the active layer of the current frame
+ * @param visible
  */
-void Model::Frames::clearFrames()
+void Model::setLayerVisible(bool visible)
 {
-    frames.clear();
+    journalEdit(JournalAction::SetLayerVisible, visible);
+    LayerStack &stack = recordLayers();
+    stack.setVisible(stack.activeIndex(), visible);
+    emit framesEdited();
 }
 
 /**
- * @brief Model::Frames::setFramePixel - Sets a pixel point of the specific frame with a specific color
- * @param frame
- * @param x
- * @param y
- * @param color
+ * @brief Model::setLayerOpacity - Fades the active layer of the current frame
+ * @param opacity - From 0 to 1
  */
-void Model::Frames::setFramePixel(QImage &frame, int x, int y, uint color)
+void Model::setLayerOpacity(qreal opacity)
 {
-    frame.setPixel(x, y, color);
+    journalEdit(JournalAction::SetLayerOpacity, 0, 0, 0, opacity);
+    LayerStack &stack = recordLayers();
+    stack.setOpacity(stack.activeIndex(), opacity);
+    emit framesEdited();
 }
 
 /**
- * @brief Model::updateFrame - Update the current frame with a new image
- * @param image
+ * @brief Model::setLayerBlendMode - Changes how the active layer of the current frame mixes with the
+ * layers below it
+ * @param blendMode
  */
-void Model::updateFrame(QImage *image)
+void Model::setLayerBlendMode(BlendMode blendMode)
 {
-    QImage imageToUpdate = image->copy();
-    frames.get(getCanvasSettings().getCurrentFrameIndex()) = imageToUpdate;
+    journalEdit(JournalAction::SetLayerBlendMode, qint32(blendMode));
+    LayerStack &stack = recordLayers();
+    stack.setBlendMode(stack.activeIndex(), blendMode);
+    emit framesEdited();
 }
 
 /**
- * @brief Model::addUndoStack - Adds frame image to the undo stack
- * @param image
+ * @brief Model::setIndexedColor - Converts every frame and layer to indexed or 32 bit color. Going to
+ * indexed color first counts the colors of every frame to build one shared palette, with entry 0 left
+ * transparent. Like a resize, the converted frames are swapped in as a whole and the old ones kept by
+ * the history
+ * @param indexed - True to store frames as palette indices
  */
-void Model::addUndoStack(QImage *image)
+void Model::setIndexedColor(bool indexed)
 {
-    QImage imageToAdd = image->copy();
-    undoBuffer.push_back(imageToAdd);
+    if (indexed == frames.isIndexed())
+    {
+        return;
+    }
 
-    if (justUndid)
+    Profiler::Scope scope("convert frames");
+    journalEdit(JournalAction::SetIndexedColor, indexed);
+
+    QList<QRgb> palette;
+    if (indexed)
     {
-        redoBuffer.clear();
+        Palette colors;
+        for (uint i = 0; i < frames.numFrames(); ++i) {
+            if (LayerStack *stack = frames.layers(i)) {
+                for (int l = 0; l < stack->count(); l++) {
+                    colors.addColors(stack->layer(l).image);
+                }
+            } else {
+                colors.addColors(frames.read(i));
+            }
+        }
+        palette = colors.build();
     }
+
+    auto convert = [indexed, &palette](const QImage &image) {
+        return indexed ? Palette::toIndexed(image, palette) : Palette::toRgb(image);
+    };
+
+    std::vector<TiledImage> convertedFrames;
+    std::vector<std::shared_ptr<LayerStack>> convertedLayers;
+    for (uint i = 0; i < frames.numFrames(); ++i) {
+        if (LayerStack *stack = frames.layers(i)) {
+            std::vector<LayerStack::Layer> layers;
+            for (int l = 0; l < stack->count(); l++) {
+                LayerStack::Layer layer = stack->layer(l);
+                layer.image = convert(layer.image);
+                layers.push_back(layer);
+            }
+            auto convertedStack = std::make_shared<LayerStack>(std::move(layers), stack->activeIndex());
+            convertedFrames.push_back(TiledImage::fromImage(convertedStack->composite()));
+            convertedLayers.push_back(std::move(convertedStack));
+            continue;
+        }
+
+        convertedFrames.push_back(TiledImage::fromImage(convert(frames.read(i))));
+        convertedLayers.push_back(nullptr);
+    }
+
+    // After the exchange the change holds the frames and palette from before the conversion
+    frames.exchange(convertedFrames, convertedLayers);
+
+    UndoHistory::Change change;
+    change.action = HistoryAction::ConvertFrames;
+    change.frames = std::move(convertedFrames);
+    change.frameLayers = std::move(convertedLayers);
+    change.palette = frames.getPalette();
+    frames.setPalette(palette);
+    history.push(std::move(change));
+    emit framesEdited();
 }
 
 /**
- * @brief Model::undo - Undo logic
+ * @brief Model::setPaletteColor - Replaces one entry of the shared palette, recoloring every pixel that
+ * uses it in every frame at once. Only the palette is recorded for undo, since no pixel changes
+ * @param index - The entry to replace. The transparent entry can't be replaced
+ * @param color - The new color, made fully opaque
  */
-void Model::undo()
+void Model::setPaletteColor(int index, QColor color)
 {
-    if (undoBuffer.empty())
+    QList<QRgb> palette = frames.getPalette();
+    if (index == Palette::TRANSPARENT_INDEX || index < 0 || index >= int(palette.size())
+        || palette[index] == color.rgb())
     {
         return;
     }
 
-    justUndid = true;
+    journalEdit(JournalAction::SetPaletteColor, index, 0, 0, 0, color.rgb());
 
-    redoBuffer.push_back(frames.get(getCanvasSettings().getCurrentFrameIndex()));
+    UndoHistory::Change change;
+    change.action = HistoryAction::EditPalette;
+    change.palette = palette;
+    history.push(std::move(change));
 
-    frames.get(getCanvasSettings().getCurrentFrameIndex()) = undoBuffer.back();
+    palette[index] = color.rgb();
+    frames.setPalette(palette);
+    emit framesEdited();
+}
+
+/**
+ * @brief Model::clearBuffers - Clears our undo and redo history
+ */
+void Model::clearBuffers()
+{
+    history.clear();
+}
 
-    emit updateCanvas(undoBuffer.back());
+/**
+ * @brief Model::setUndoMemoryBudget - Sets how many bytes the undo history may use. The oldest
+ * changes are forgotten first once the budget is exceeded
+ * @param bytes
+ */
+void Model::setUndoMemoryBudget(size_t bytes)
+{
+    history.setMemoryBudget(bytes);
+}
 
-    undoBuffer.pop_back();
+/**
+ * @brief Model::setJournal - Journals every edit made from now on, so it can be replayed after a crash
+ * @param newJournal - The journal to append to, or null to stop journaling
+ */
+void Model::setJournal(Journal *newJournal)
+{
+    journal = newJournal;
 }
 
 /**
- * @brief Model::redo - Redo logic
+ * @brief Model::replayJournal - Makes recovered edits again through the same operations that made them,
+ * with each record's frame as the current frame. Strokes are pasted back as the pixels they left behind.
+ * The journal is detached while replaying, so the records aren't appended to it a second time
+ * @param records - The edits to make, oldest first
+ * @return How many records were replayed. Replaying stops at the first record that doesn't fit the frames
  */
-void Model::redo()
+int Model::replayJournal(const std::vector<Journal::Record> &records)
 {
-    if (redoBuffer.empty())
+    Profiler::Scope scope("journal replay");
+
+    Journal *detached = journal;
+    journal = nullptr;
+
+    int replayed = 0;
+    for (const Journal::Record &record : records)
     {
-        return;
-    }
+        if (record.frameIndex >= frames.numFrames())
+        {
+            break;
+        }
+        getCanvasSettings().setCurrentFrameIndex(record.frameIndex);
+
+        bool applied = true;
+        switch (record.action)
+        {
+        case JournalAction::Stroke:
+        {
+            LayerStack *stack = frames.layers(record.frameIndex);
+            QImage pixels = record.pixels.decode();
+            applied = !pixels.isNull() && record.first >= 0 && record.first < (stack != nullptr ? stack->count() : 1);
+            if (applied)
+            {
+                Blitter::paste(frames.get(record.frameIndex, record.first), pixels, record.area.topLeft());
+            }
+            break;
+        }
+        case JournalAction::AddFrame:
+            addFrame();
+            break;
+        case JournalAction::DeleteFrame:
+            applied = record.first >= 0 && uint(record.first) < frames.numFrames();
+            if (applied)
+            {
+                deleteFrame(record.first);
+            }
+            break;
+        case JournalAction::MoveFrame:
+            applied = record.first >= 0 && uint(record.first) < frames.numFrames() && record.second >= 0
+                      && uint(record.second) < frames.numFrames();
+            if (applied)
+            {
+                moveFrame(record.first, record.second);
+            }
+            break;
+        case JournalAction::ResizeFrames:
+            applied = record.first > 0 && record.second > 0 && record.third >= 0
+                      && record.third <= qint32(ResizeAnchor::BottomRight);
+            if (applied)
+            {
+                resizeFrames(record.first, record.second, ResizeAnchor(record.third));
+            }
+            break;
+        case JournalAction::ScaleFrames:
+            applied = record.first > 0 && record.second > 0 && record.third >= 0
+                      && record.third <= qint32(ScaleFilter::Scale4x);
+            if (applied)
+            {
+                scaleFrames(record.first, record.second, ScaleFilter(record.third));
+            }
+            break;
+        case JournalAction::FilterFrames:
+        {
+            applied = record.first >= 0 && record.first <= qint32(FilterType::DropShadow);
+            if (!applied)
+            {
+                break;
+            }
+            FrameFilter::Settings settings;
+            settings.type = FilterType(record.first);
+            settings.color = record.color;
+            settings.replacement = QRgb(record.second);
+            settings.hue = record.second;
+            settings.saturation = record.third;
+            settings.value = int(record.amount);
+            settings.offset = QPoint(record.second, record.third);
+            filterFrames(settings);
+            break;
+        }
+        case JournalAction::AddLayer:
+            addLayer();
+            break;
+        case JournalAction::DeleteLayer:
+            deleteLayer();
+            break;
+        case JournalAction::MoveLayer:
+            moveLayer(record.first);
+            break;
+        case JournalAction::SelectLayer:
+            selectLayer(record.first);
+            break;
+        case JournalAction::SetLayerVisible:
+            setLayerVisible(record.first != 0);
+            break;
+        case JournalAction::SetLayerOpacity:
+            setLayerOpacity(record.amount);
+            break;
+        case JournalAction::SetLayerBlendMode:
+            applied = record.first >= 0 && record.first <= qint32(BlendMode::Add);
+            if (applied)
+            {
+                setLayerBlendMode(BlendMode(record.first));
+            }
+            break;
+        case JournalAction::SetIndexedColor:
+            setIndexedColor(record.first != 0);
+            break;
+        case JournalAction::SetPaletteColor:
+            setPaletteColor(record.first, QColor::fromRgb(record.color));
+            break;
+        case JournalAction::Barrier:
+            applied = false;
+            break;
+        }
 
-    justUndid = false;
+        if (!applied)
+        {
+            break;
+        }
+        replayed++;
+    }
 
-    undoBuffer.push_back(frames.get(getCanvasSettings().getCurrentFrameIndex()));
+    journal = detached;
 
-    frames.get(getCanvasSettings().getCurrentFrameIndex()) = redoBuffer.back();
+    uint currentIndex = getCanvasSettings().getCurrentFrameIndex();
+    emit frameListChanged(frames.numFrames(), currentIndex);
+    emit updateCanvas(currentIndex);
+    emit framesEdited();
+    return replayed;
+}
 
-    emit updateCanvas(redoBuffer.back());
+/**
+ * @brief Model::journalEdit - Journals an edit before it's made, along with the current frame it's made on
+ * @param action - The edit
+ * @param first - Its first argument, such as a frame index or offset
+ * @param second - Its second argument
+ * @param third - Its third argument, such as a resize anchor
+ * @param amount - A layer opacity
+ * @param color - A palette color
+ */
+void Model::journalEdit(JournalAction action, qint32 first, qint32 second, qint32 third, qreal amount, QRgb color)
+{
+    if (journal == nullptr)
+    {
+        return;
+    }
 
-    redoBuffer.pop_back();
+    Journal::Record record;
+    record.action = action;
+    record.first = first;
+    record.second = second;
+    record.third = third;
+    record.amount = amount;
+    record.color = color;
+    record.frameIndex = getCanvasSettings().getCurrentFrameIndex();
+    journal->append(record);
 }
 
 /**
- * @brief Model::clearBuffers - Clears our undo and redo buffers
+ * @brief Model::journalPixels - Journals part of a frame as it is now, compressed. Only the area a stroke
+ * changed is stored, so replaying it doesn't depend on the tool settings it was drawn with
+ * @param frameIndex
+ * @param layerIndex
+ * @param image - The frame or layer that was drawn on
+ * @param area - What the stroke changed
  */
-void Model::clearBuffers()
+void Model::journalPixels(uint frameIndex, int layerIndex, const QImage &image, QRect area)
 {
-    undoBuffer.clear();
-    redoBuffer.clear();
+    area &= image.rect();
+    if (journal == nullptr || area.isEmpty())
+    {
+        return;
+    }
+
+    Journal::Record record;
+    record.action = JournalAction::Stroke;
+    record.first = layerIndex;
+    record.frameIndex = frameIndex;
+    record.area = area;
+    record.pixels = FrameChunk::encode(image.copy(area));
+    record.pixels.colorTable.clear();
+    journal->append(record);
 }
 
 //-----Model::CanvasData-----//
@@ -354,24 +1647,107 @@ void Model::CanvasData::clearCanvasData()
  */
 void Model::recieveDrawOnEvent(QImage &image, QPoint pos)
 {
-    int brushSize = toolBar.CurrentTool()->brushSize;
+    Profiler::Scope scope("draw");
+    Tool *tool = toolBar.CurrentTool();
+    QRect changedRegion;
+
+    if (tool->drawsOncePerClick()) {
+        // Tools like the bucket act on the clicked pixel alone, and only once per click
+        if (clickDrawn) {
+            return;
+        }
+        clickDrawn = true;
 
-    if (brushSize == 0) {
+        changedRegion = tool->affectedArea(image, pos);
+        history.recordBefore(image, changedRegion);
         toolBar.drawWithCurrentTool(image, pos);
     } else {
+        // Every other tool stamps its whole brush at once
+        history.recordBefore(image, tool->stampArea(image, pos));
+        changedRegion = toolBar.stampWithCurrentTool(image, pos);
+    }
 
-        // Calculate and iterate the neighboring points based on the brush size
-        for (int dx = -brushSize; dx <= brushSize; ++dx) {
-            for (int dy = -brushSize; dy <= brushSize; ++dy) {
-                QPoint currentPos = pos + QPoint(dx, dy);
+    lastStrokePoint = pos;
+    strokeHasPoint = true;
+    strokeArea |= changedRegion;
 
-                // Check if the current position is within the image boundaries
-                if (image.rect().contains(currentPos)) {
-                    toolBar.drawWithCurrentTool(image, currentPos);
-                }
-            }
+    // Let the view repaint only what this draw touched
+    if (!changedRegion.isEmpty()) {
+        emit imageRegionChanged(changedRegion);
+    }
+}
+
+/**
+ * @brief Model::recieveStrokeEvent - Receives a batch of positions the mouse was dragged through and
+ * draws a continuous stroke through them, joining each position to the previous one with a line. The
+ * whole batch is reported as one changed region, so it is repainted once
+ * @param image
+ * @param positions
+ */
+void Model::recieveStrokeEvent(QImage &image, const QList<QPoint> &positions)
+{
+    Profiler::Scope scope("stroke");
+    Profiler::count("stroke points", positions.size());
+    if (positions.isEmpty() || toolBar.CurrentTool()->drawsOncePerClick()) {
+        return;
+    }
+
+    QRect changedRegion;
+    for (QPoint pos : positions) {
+        if (!strokeHasPoint) {
+            history.recordBefore(image, toolBar.CurrentTool()->stampArea(image, pos));
+            changedRegion |= toolBar.stampWithCurrentTool(image, pos);
+        } else {
+            changedRegion |= stampLine(image, lastStrokePoint, pos);
+        }
+
+        lastStrokePoint = pos;
+        strokeHasPoint = true;
+    }
+    strokeArea |= changedRegion;
+
+    if (!changedRegion.isEmpty()) {
+        emit imageRegionChanged(changedRegion);
+    }
+}
+
+/**
+ * @brief Model::stampLine - Stamps the current tool along the line between two positions using
+ * Bresenham's algorithm, so fast mouse movements don't leave gaps. `from` was already drawn by the
+ * previous position, so it is skipped
+ * @param image
+ * @param from
+ * @param to
+ * @return The changed region
+ */
+QRect Model::stampLine(QImage &image, QPoint from, QPoint to)
+{
+    Tool *tool = toolBar.CurrentTool();
+    QRect changedRegion;
+
+    int dx = qAbs(to.x() - from.x());
+    int dy = -qAbs(to.y() - from.y());
+    int stepX = from.x() < to.x() ? 1 : -1;
+    int stepY = from.y() < to.y() ? 1 : -1;
+    int error = dx + dy;
+    QPoint pos = from;
+
+    while (pos != to) {
+        int doubledError = 2 * error;
+        if (doubledError >= dy) {
+            error += dy;
+            pos.rx() += stepX;
         }
+        if (doubledError <= dx) {
+            error += dx;
+            pos.ry() += stepY;
+        }
+
+        history.recordBefore(image, tool->stampArea(image, pos));
+        changedRegion |= toolBar.stampWithCurrentTool(image, pos);
     }
+
+    return changedRegion;
 }
 
 /**
@@ -419,12 +1795,43 @@ void Model::recieveBrushSettings(int size, QColor color)
 }
 
 /**
- * @brief Model::updateFPS - Update the frames per second (FPS) value
+ * @brief Model::recieveFillSettings - Receive the bucket fill settings and process it
+ * @param mode
+ * @param tolerance
+ */
+void Model::recieveFillSettings(FillMode mode, int tolerance)
+{
+    toolBar.setFillSettings(mode, tolerance);
+}
+
+/**
+ * @brief Model::recieveBrushShape - Receive the brush shape and process it
+ * @param shape
+ */
+void Model::recieveBrushShape(BrushShape shape)
+{
+    toolBar.setBrushShape(shape);
+}
+
+/**
+ * @brief Model::updateFPS - Update the frames per second (FPS) value. During playback the clock is
+ * restarted from the frame being shown, so the new speed applies right away without skipping frames
  * @param otherFps
  */
 void Model::updateFPS(int otherFps)
 {
+    if (play)
+    {
+        playStartFrame = playedFrames();
+        playClock.restart();
+    }
+
     fps = otherFps;
+
+    if (play)
+    {
+        playAnimationFrames();
+    }
 }
 
 /**
@@ -433,6 +1840,11 @@ void Model::updateFPS(int otherFps)
  */
 void Model::updatePlay(bool otherPlay)
 {
+    if (otherPlay == play)
+    {
+        return;
+    }
+
     play = otherPlay;
     if (play)
     {
@@ -454,43 +1866,60 @@ bool Model::getPlayStatus()
 }
 
 /**
- * @brief Model::playAnimationFrames - Controls the animation of the current frames
+ * @brief Model::getFPS - Returns the frames per second the animation plays at
+ * @return
+ */
+int Model::getFPS()
+{
+    return fps;
+}
+
+/**
+ * @brief Model::playedFrames - Returns how many frames have been shown since playback started, worked
+ * out from the playback clock rather than by counting timer ticks
+ * @return
+ */
+qint64 Model::playedFrames()
+{
+    return playStartFrame + playClock.elapsed() * fps / 1000;
+}
+
+/**
+ * @brief Model::playAnimationFrames - Shows the frame the playback clock is on and schedules the next
+ * tick for exactly when the following frame is due. Only one frame is sent per tick
  */
 void Model::playAnimationFrames()
 {
-    if(play)
+    Profiler::Scope scope("animation tick");
+    if (!play || fps <= 0 || frames.numFrames() == 0)
     {
-        // Get how often to change the frame in milliseconds
-        int frameTime = calculateDelay();
-        int delay = 0;
+        return;
+    }
 
-        for (int i = 0; i < (int)frames.numFrames(); i++)
-        {
-            emit updateAnimationPreview(frames.get(i), delay);
-            delay += frameTime;
-        }
+    qint64 shown = playedFrames();
+    emit updateAnimationPreview(uint(shown % frames.numFrames()));
 
-    }
+    // Round the next frame's time up so the tick never lands just before it's due
+    qint64 nextFrameTime = ((shown - playStartFrame + 1) * 1000 + fps - 1) / fps;
+    playTimer.start(int(qMax<qint64>(0, nextFrameTime - playClock.elapsed())));
 }
 
 /**
- * @brief Model::beginAnimation - Starts the animation of the current frames
+ * @brief Model::beginAnimation - Starts the playback clock from the first frame
  */
 void Model::beginAnimation()
 {
-    timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, &Model::playAnimationFrames);
-
-    timer->start(calculateDelay() * frames.numFrames());
-
+    playStartFrame = 0;
+    playClock.start();
+    playAnimationFrames();
 }
 
 /**
- * @brief Model::endAnimation - Ends the animation of the current frames
+ * @brief Model::endAnimation - Stops playback
  */
 void Model::endAnimation()
 {
-    timer->stop();
+    playTimer.stop();
 }
 
 /**
@@ -19,28 +19,100 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <QElapsedTimer>
 #include <QImage>
-#include <QLabel>
+#include <QList>
 #include <QObject>
-#include <QVector2D>
-#include <QLabel>
 #include <QTimer>
+#include <QVector2D>
+#include <functional>
+#include <memory>
 
 #include "toolbar.h"
+#include "chunkcache.h"
 #include "enums.h"
+#include "framechunk.h"
+#include "framefilter.h"
+#include "journal.h"
+#include "layerstack.h"
+#include "tiledimage.h"
 #include "toolbar.h"
+#include "undohistory.h"
 
 
 class Model : public QObject
 {
 public:
 
-    /// Class for managing frames in the animation
+    /// Class for managing frames in the animation. Frames can be held compressed or as shared
+    /// tiles, and are only decoded when used. The most recently used decoded frames are kept in memory.
+    /// A frame can also be split into layers, in which case its image is the flattened layers
     class Frames
     {
-        std::vector<QImage> frames;
+        /// One frame. `image` is null while the frame is only held compressed or tiled, and `chunk` is
+        /// empty when the frame has been edited since it was last compressed. Frames with `layers`
+        /// keep no image, chunk or tiles of their own; the stack caches its flattened image instead
+        struct StoredFrame
+        {
+            QImage image;
+            FrameChunk chunk;
+            quint64 lastUsed = 0;
+            quint64 revision = 0;
+
+            /// `QImage::cacheKey()` of the image last stored, kept while the frame is only compressed
+            /// so an unchanged copy handed back to `set` can be recognised. 0 if it may have changed
+            qint64 imageKey = 0;
+
+            /// The frame split into shared tiles. Out of date tiles are kept when the frame is edited,
+            /// so tiling it again only copies the tiles that changed
+            TiledImage tiles;
+            bool tilesValid = false;
+
+            /// The frame's layers, or null for a frame of a single image
+            std::shared_ptr<LayerStack> layers;
+
+            /// `paletteRevision` of the palette the frame's decoded image and layers were last given
+            quint64 paletteRevision = 0;
+
+            /// True for the frame whose buffer the tools draw on. It's never evicted, so the buffer
+            /// handed out by `editBuffer` stays valid
+            bool pinned = false;
+        };
+
+        std::vector<StoredFrame> frames;
+
+        /// How many bytes of decoded frames to keep in memory
+        qsizetype cacheBudget;
+
+        /// Counts frame accesses, used to find the least recently used frame
+        quint64 useCounter = 0;
+
+        /// Counts changes to frames. Every frame gets a new revision whenever it may have changed
+        quint64 revisionCounter = 0;
+
+        /// The palette every frame is indexed into, or empty while frames hold 32 bit colors. Frames
+        /// are only given a new palette when next used, so changing it doesn't touch any pixels
+        QList<QRgb> palette;
+        quint64 paletteRevision = 0;
+
+        /// Chunks written by the last save, which unedited frames take as their compressed copy
+        std::shared_ptr<ChunkCache> chunkCache;
+
+        /// Returns the frame at index, first giving its decoded image and layers the current palette
+        StoredFrame &storedFrame(uint index);
+
+        /// Makes sure the frame at index is decoded and marks it as just used
+        StoredFrame &materialize(uint index);
+
+        /// Tiles or drops the least recently used decoded frames, other than `keepIndex`, until the
+        /// decoded frames fit in `cacheBudget`
+        void evictFor(uint keepIndex);
 
     public:
+        /// Default budget for decoded frames of 64 MB. Frames outside it are rebuilt from their
+        /// tiles, which is only a copy
+        static constexpr qsizetype DEFAULT_CACHE_BUDGET = 64 * 1024 * 1024;
+
         /// Initializes with 1 blank white frame of dimension `width` x `height`
         Frames(uint width, uint height);
 
@@ -50,14 +122,55 @@ public:
         /// Returns the number of frames in our current animation
         uint numFrames();
 
-        /// Returns the frame at index
-        QImage &get(uint index);
+        /// Returns the frame at index for editing. For a frame with layers, returns the layer at
+        /// `layer`, or the active layer if `layer` is -1
+        QImage &get(uint index, int layer = -1);
+
+        /// Stores `frame` as the frame at index, or as its active layer if it has layers. Storing the
+        /// same, unedited image the frame already holds does nothing, so its compressed copy and
+        /// revision are kept
+        void set(uint index, const QImage &frame);
+
+        /// Returns the frame at index for reading only, with any layers flattened. Unlike `get`, the
+        /// frame's compressed copy stays valid, so it can be dropped from memory again cheaply
+        const QImage &read(uint index);
+
+        /// Returns the buffer the tools draw on for the frame at index: its active layer, or the frame
+        /// itself. It's the frame's own pixels rather than a copy, so drawing on it never detaches, and
+        /// the frame is pinned in memory until another frame is. Drawing must be reported with
+        /// `markEdited`. Adding, removing or replacing frames or layers invalidates it
+        QImage &editBuffer(uint index);
+
+        /// Returns true if `image` is the buffer `editBuffer` hands out for the frame at index. Unlike
+        /// `editBuffer`, nothing is decoded, pinned or marked as used
+        bool isEditBuffer(uint index, const QImage *image) const;
+
+        /// Marks `area` of the frame at index as drawn on through its `editBuffer`. The frame's
+        /// compressed copy is dropped and it gets a new revision, and a frame with layers only has
+        /// `area` composited again
+        void markEdited(uint index, QRect area);
+
+        /// Returns the layers of the frame at index, or null if it's a single image. Changes made
+        /// through the pointer must be followed by `touch`
+        LayerStack *layers(uint index);
+        std::shared_ptr<LayerStack> layerStack(uint index);
+
+        /// Returns the layers of the frame at index for editing, splitting a single image frame into a
+        /// stack of one layer first
+        LayerStack &editLayers(uint index);
+
+        /// Replaces the layers of the frame at index. A null stack leaves the frame a single image
+        /// holding what the layers it had looked like
+        void setLayers(uint index, std::shared_ptr<LayerStack> stack);
+
+        /// Gives the frame at index a new revision after its layers were changed
+        void touch(uint index);
 
         /// returns the first and last frame of the animation
         QImage first();
         QImage last();
 
-        /// Generates a blank white frame of size width x height
+        /// Generates a blank white frame of size width x height, indexed if the frames use a palette
         void generateFrame(int width, int height);
 
         /// Sets a frame pixel with the drawn color
@@ -66,9 +179,15 @@ public:
         /// Adds an image as the last frame of our animation.
         void push(QImage frame);
 
+        /// Adds a compressed frame as the last frame of our animation. It is decoded when first used
+        void pushCompressed(FrameChunk chunk);
+
         /// Adds an image to our frame at `position`
         void insert(QImage frame, uint index);
 
+        /// Adds a tiled frame at `position`. It is decoded when first used
+        void insertTiled(TiledImage frame, uint index);
+
         /// Deletes the frame at index `position`
         void remove(uint index);
 
@@ -80,6 +199,43 @@ public:
 
         /// Clear all the data within the frame class object's frame vector
         void clearFrames();
+
+        /// Trades our whole list of frames with `otherFrames`, and their layers with `otherLayers`
+        void exchange(std::vector<TiledImage> &otherFrames,
+                      std::vector<std::shared_ptr<LayerStack>> &otherLayers);
+
+        /// Returns the compressed copy of a frame, or an empty chunk if it was edited since it was last
+        /// loaded or saved
+        FrameChunk compressed(uint index);
+
+        /// Returns the chunks written by the last save of these frames, for the next save to reuse
+        std::shared_ptr<ChunkCache> savedChunks();
+
+        /// Returns the frame at index as shared tiles, tiling it first if it was edited since
+        TiledImage tiled(uint index);
+
+        /// Copies every compressed frame out of the project file it was loaded from, so that file
+        /// is no longer memory-mapped
+        void detachFromFile();
+
+        /// Returns true if the frame at index is currently decoded in memory
+        bool isDecoded(uint index);
+
+        /// Returns a number that changes whenever the frame at index may have been edited or replaced.
+        /// Anything derived from a frame, like a scaled preview, can be kept until this changes
+        quint64 revision(uint index);
+
+        /// Sets how many bytes of decoded frames are kept in memory
+        void setCacheBudget(qsizetype bytes);
+
+        /// Returns true if frames are stored as indices into `getPalette`
+        bool isIndexed();
+
+        /// Returns the palette shared by every frame, empty if frames hold 32 bit colors
+        const QList<QRgb> &getPalette();
+
+        /// Replaces the shared palette, recoloring every indexed frame without changing its pixels
+        void setPalette(const QList<QRgb> &colors);
     };
 
     /// Class for managing canvas data
@@ -131,22 +287,83 @@ private:
     Frames frames;
     CanvasData canvasSettings;
     ToolBar toolBar;
-    bool justUndid;
+    UndoHistory history;
     int fps = 2;
     bool play = false;
-    QTimer *timer;
+
+    /// Playback clock. The frame shown is worked out from the time since `playClock` was started,
+    /// so late timer ticks never make the animation drift. `playTimer` fires once per frame
+    QTimer playTimer;
+    QElapsedTimer playClock;
+    qint64 playStartFrame = 0;
+
+    /// Returns how many frames have been shown since playback started, counting repeats
+    qint64 playedFrames();
+
+    /// True once a tool that draws once per click has drawn during the current stroke
+    bool clickDrawn = false;
+
+    /// Where the current stroke was last drawn, so the next position can be joined to it
+    QPoint lastStrokePoint;
+    bool strokeHasPoint = false;
+
+    /// Stamps the current tool at every pixel on the line from `from` to `to`, excluding `from`
+    QRect stampLine(QImage &image, QPoint from, QPoint to);
+
+    /// Where edits are journaled for crash recovery, or null if they aren't
+    Journal *journal = nullptr;
+
+    /// The layer the current stroke is drawn on, and everything it has changed so far
+    int strokeLayer = 0;
+    QRect strokeArea;
 
 public:
     explicit Model(QObject *parent = nullptr);
-    std::vector<QImage> undoBuffer;
-    std::vector<QImage> redoBuffer;
 
-    /// Adds to the undo stack
-    void addUndoStack(QImage *image);
+    /// Starts and finishes recording a stroke drawn on `image` for undo. `image` is normally the current
+    /// frame's edit buffer, drawn on in place; any other image is stored as the frame once it's drawn on
+    void beginStroke(QImage *image);
+    void endStroke(QImage *image);
     void clearBuffers();
     void undo();
     void redo();
-    void updateFrame(QImage *image);
+
+    /// Sets how many bytes of memory the undo history may use
+    void setUndoMemoryBudget(size_t bytes);
+
+    /// Journals every edit from now on into `journal`, or stops journaling if it's null
+    void setJournal(Journal *journal);
+
+    /// Makes the edits recovered from a journal again, without journaling them twice. Stops at the first
+    /// record that doesn't fit the frames. Returns how many records were replayed
+    int replayJournal(const std::vector<Journal::Record> &records);
+
+    /// Frame operations. These update the current frame index and are recorded for undo
+    void addFrame();
+    void deleteFrame(uint index);
+    void moveFrame(uint fromIndex, uint toIndex);
+    void resizeFrames(int width, int height, ResizeAnchor anchor = ResizeAnchor::TopLeft);
+    void scaleFrames(int width, int height, ScaleFilter filter);
+
+    /// Runs a filter over every frame and layer as one undo step. Color filters on indexed frames edit
+    /// the palette instead of the pixels
+    void filterFrames(const FrameFilter::Settings &settings);
+
+    /// Layer operations on the current frame. These are recorded for undo, apart from choosing the
+    /// active layer. The first layer added splits the frame into a background layer and the new one
+    void addLayer();
+    void deleteLayer();
+    void moveLayer(int offset);
+    void selectLayer(int offset);
+    void setLayerVisible(bool visible);
+    void setLayerOpacity(qreal opacity);
+    void setLayerBlendMode(BlendMode blendMode);
+
+    /// Palette operations, recorded for undo. Switching to indexed color converts every frame and layer
+    /// to indices into one palette built from all of them, and switching back converts them to 32 bits.
+    /// Changing an entry recolors every frame that uses it without touching any pixels
+    void setIndexedColor(bool indexed);
+    void setPaletteColor(int index, QColor color);
 
     /// Returns a reference to our container of frames
     Frames &getFrames();
@@ -159,20 +376,52 @@ public:
     void beginAnimation();
     void endAnimation();
     bool getPlayStatus();
+    int getFPS();
     double calculateDelay();
 
+private:
+    /// Undoes (or redoes) a change from the history on our frames
+    void applyChange(UndoHistory::Change &change, bool undoing);
+
+    /// Records the layers of the current frame for undo, then returns them for editing
+    LayerStack &recordLayers();
+
+    /// Runs `transform` on every frame, or every layer of frames with layers, spread across the thread
+    /// pool, then records the old frames for undo. `transform` is given the color of any new space.
+    /// Progress is reported with `framesTransformed` as the frames are done
+    void transformFrames(const std::function<QImage(const QImage &image, QColor fill)> &transform);
+
+    /// Journals an edit about to be made to the current frame
+    void journalEdit(JournalAction action,
+                     qint32 first = 0,
+                     qint32 second = 0,
+                     qint32 third = 0,
+                     qreal amount = 0,
+                     QRgb color = 0);
+
+    /// Journals the pixels in `area` of the frame at `frameIndex`, or of its layer at `layerIndex`, as
+    /// they are now
+    void journalPixels(uint frameIndex, int layerIndex, const QImage &image, QRect area);
+
 public slots:
     void recieveDrawOnEvent(QImage &image, QPoint pos);
+    void recieveStrokeEvent(QImage &image, const QList<QPoint> &positions);
     void recievePenColor(QColor color);
     void recieveActiveTool(ToolType tool);
     void recieveBrushSettings(int size, QColor color);
+    void recieveFillSettings(FillMode mode, int tolerance);
+    void recieveBrushShape(BrushShape shape);
     void updateFPS(int fps);
     void updatePlay(bool play);
 
 signals:
     void sendColor(QColor color);
-    void updateCanvas(QImage& image);
-    void updateAnimationPreview(QImage frame, int frameTime);
+    void updateCanvas(uint frameIndex);
+    void imageRegionChanged(QRect region);
+    void frameListChanged(int frameCount, int currentFrame);
+    void framesEdited();
+    void framesTransformed(int done, int total);
+    void updateAnimationPreview(uint frameIndex);
 };
 
 #endif // MODEL_H
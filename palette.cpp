@@ -0,0 +1,342 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Palette Source
+ *
+ * Brief:
+ * The Palette helps store frames as 8 bit indices into one
+ * palette shared by the whole document. It counts the
+ * colors of a set of frames and builds a palette for
+ * them, converts frames to and from indexed color, and
+ * finds the palette entry closest to a color so the tools
+ * can draw on indexed frames.
+ *
+*/
+
+#include <algorithm>
+#include <array>
+#include <climits>
+
+#include "palette.h"
+#include "profiler.h"
+
+/**
+ * @brief Palette::addColors - Counts every color used by an image. Pixels that are at least half opaque
+ * count as fully opaque, and the rest as transparent, which is always entry 0
+ * @param image
+ */
+void Palette::addColors(const QImage &image)
+{
+    QImage source = image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32
+                        ? image
+                        : image.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < source.height(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+        for (int x = 0; x < source.width(); x++)
+        {
+            if (qAlpha(row[x]) >= 128)
+            {
+                counts[row[x] | 0xff000000]++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Palette::addColor - Counts pixels of one color, for callers that look at pixels themselves
+ * @param color
+ * @param uses - How many pixels use the color
+ */
+void Palette::addColor(QRgb color, qint64 uses)
+{
+    counts[color | 0xff000000] += uses;
+}
+
+/**
+ * @brief Palette::build - Builds a palette for the colors counted so far
+ * @return A palette whose entry 0 is transparent
+ */
+QList<QRgb> Palette::build() const
+{
+    Profiler::Scope scope("build palette");
+
+    std::vector<Entry> entries;
+    entries.reserve(counts.size());
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it)
+    {
+        entries.push_back({it.key(), it.value()});
+    }
+
+    QList<QRgb> palette{qRgba(0, 0, 0, 0)};
+    if (int(entries.size()) < MAX_COLORS)
+    {
+        // Most used colors first, so the entries the user is likely to want are at the top
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.count != b.count ? a.count > b.count : a.color < b.color;
+        });
+        for (const Entry &entry : entries)
+        {
+            palette.append(entry.color);
+        }
+        return palette;
+    }
+
+    // Hash order changes from run to run, and median cut breaks ties by input order, so the entries are
+    // put in a fixed order first. The same frames then always give the same palette
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.color < b.color; });
+    palette.append(medianCut(std::move(entries), MAX_COLORS - 1));
+    return palette;
+}
+
+/**
+ * @brief Palette::toIndexed - Converts an image to indices into a palette. Each distinct color is
+ * only matched once, so converting a frame costs a hash lookup per pixel
+ * @param image
+ * @param palette
+ * @return An Indexed8 image using `palette` as its color table
+ */
+QImage Palette::toIndexed(const QImage &image, const QList<QRgb> &palette)
+{
+    Profiler::Scope scope("index frame");
+
+    if (image.isNull())
+    {
+        return QImage();
+    }
+    if (image.format() == QImage::Format_Indexed8 && image.colorTable() == palette)
+    {
+        return image;
+    }
+
+    QImage source = image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32
+                        ? image
+                        : image.convertToFormat(QImage::Format_ARGB32);
+    bool opaqueSource = !source.hasAlphaChannel();
+
+    QImage indexed(source.size(), QImage::Format_Indexed8);
+    indexed.setColorTable(palette);
+
+    QHash<QRgb, uchar> matches;
+    for (int i = 0; i < palette.size(); i++)
+    {
+        if (qAlpha(palette[i]) == 255 && !matches.contains(palette[i]))
+        {
+            matches.insert(palette[i], uchar(i));
+        }
+    }
+
+    for (int y = 0; y < source.height(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+        uchar *out = indexed.scanLine(y);
+        for (int x = 0; x < source.width(); x++)
+        {
+            if (!opaqueSource && qAlpha(row[x]) < 128)
+            {
+                out[x] = TRANSPARENT_INDEX;
+                continue;
+            }
+
+            QRgb color = row[x] | 0xff000000;
+            auto match = matches.constFind(color);
+            if (match == matches.cend())
+            {
+                match = matches.insert(color, uchar(nearest(palette, color)));
+            }
+            out[x] = *match;
+        }
+    }
+    return indexed;
+}
+
+/**
+ * @brief Palette::toRgb - Looks up every index in the image's color table
+ * @param image
+ * @return An RGB32 image, or ARGB32 if a transparent entry is used
+ */
+QImage Palette::toRgb(const QImage &image)
+{
+    if (image.format() != QImage::Format_Indexed8)
+    {
+        return image;
+    }
+
+    std::array<bool, MAX_COLORS> used{};
+    for (int y = 0; y < image.height(); y++)
+    {
+        const uchar *row = image.constScanLine(y);
+        for (int x = 0; x < image.width(); x++)
+        {
+            used[row[x]] = true;
+        }
+    }
+
+    bool transparent = false;
+    QList<QRgb> colors = image.colorTable();
+    for (int i = 0; i < int(colors.size()); i++)
+    {
+        transparent = transparent || (used[i] && qAlpha(colors[i]) < 255);
+    }
+    return image.convertToFormat(transparent ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+}
+
+/**
+ * @brief Palette::nearest - Finds the entry closest to a color. Transparent colors always match a
+ * transparent entry, and opaque colors are only matched with opaque entries
+ * @param palette
+ * @param color
+ * @return
+ */
+int Palette::nearest(const QList<QRgb> &palette, QRgb color)
+{
+    bool transparent = qAlpha(color) < 128;
+    int best = TRANSPARENT_INDEX;
+    int bestDistance = INT_MAX;
+
+    for (int i = 0; i < int(palette.size()); i++)
+    {
+        QRgb entry = palette[i];
+        if ((qAlpha(entry) < 128) != transparent)
+        {
+            continue;
+        }
+        if (transparent)
+        {
+            return i;
+        }
+
+        // Weighted the way the eye is most sensitive, so greens are told apart more finely than blues
+        int red = qRed(entry) - qRed(color);
+        int green = qGreen(entry) - qGreen(color);
+        int blue = qBlue(entry) - qBlue(color);
+        int distance = 3 * red * red + 4 * green * green + 2 * blue * blue;
+        if (distance < bestDistance)
+        {
+            best = i;
+            bestDistance = distance;
+            if (distance == 0)
+            {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Palette::medianCut - Repeatedly splits the box of colors with the widest channel at the point
+ * where half of its pixels fall on each side, then averages each box into one entry
+ * @param entries
+ * @param colors
+ * @return
+ */
+QList<QRgb> Palette::medianCut(std::vector<Entry> entries, int colors)
+{
+    // Each box is a range [first, last) of entries
+    struct Box
+    {
+        size_t first;
+        size_t last;
+    };
+
+    auto channel = [](QRgb color, int index) {
+        return index == 0 ? qRed(color) : index == 1 ? qGreen(color) : qBlue(color);
+    };
+
+    // Returns the channel with the widest range in a box, and that range
+    auto widest = [&](const Box &box) {
+        int bestChannel = 0;
+        int bestRange = -1;
+        for (int c = 0; c < 3; c++)
+        {
+            int low = 255;
+            int high = 0;
+            for (size_t i = box.first; i < box.last; i++)
+            {
+                int value = channel(entries[i].color, c);
+                low = std::min(low, value);
+                high = std::max(high, value);
+            }
+            if (high - low > bestRange)
+            {
+                bestChannel = c;
+                bestRange = high - low;
+            }
+        }
+        return std::make_pair(bestChannel, bestRange);
+    };
+
+    std::vector<Box> boxes{{0, entries.size()}};
+    while (int(boxes.size()) < colors)
+    {
+        int split = -1;
+        int splitChannel = 0;
+        int splitRange = 0;
+        for (int b = 0; b < int(boxes.size()); b++)
+        {
+            if (boxes[b].last - boxes[b].first < 2)
+            {
+                continue;
+            }
+            auto [c, range] = widest(boxes[b]);
+            if (range > splitRange)
+            {
+                split = b;
+                splitChannel = c;
+                splitRange = range;
+            }
+        }
+        if (split < 0)
+        {
+            break;
+        }
+
+        Box box = boxes[split];
+        std::sort(entries.begin() + box.first, entries.begin() + box.last, [&](const Entry &a, const Entry &b) {
+            return channel(a.color, splitChannel) < channel(b.color, splitChannel);
+        });
+
+        qint64 total = 0;
+        for (size_t i = box.first; i < box.last; i++)
+        {
+            total += entries[i].count;
+        }
+        qint64 half = 0;
+        size_t middle = box.first + 1;
+        for (size_t i = box.first; i < box.last - 1; i++)
+        {
+            half += entries[i].count;
+            middle = i + 1;
+            if (half * 2 >= total)
+            {
+                break;
+            }
+        }
+
+        boxes[split] = {box.first, middle};
+        boxes.push_back({middle, box.last});
+    }
+
+    QList<QRgb> palette;
+    for (const Box &box : boxes)
+    {
+        qint64 red = 0;
+        qint64 green = 0;
+        qint64 blue = 0;
+        qint64 total = 0;
+        for (size_t i = box.first; i < box.last; i++)
+        {
+            red += qint64(qRed(entries[i].color)) * entries[i].count;
+            green += qint64(qGreen(entries[i].color)) * entries[i].count;
+            blue += qint64(qBlue(entries[i].color)) * entries[i].count;
+            total += entries[i].count;
+        }
+        palette.append(qRgb(int(red / total), int(green / total), int(blue / total)));
+    }
+    return palette;
+}
@@ -0,0 +1,75 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Palette Header
+ *
+ * Brief:
+ * The Palette helps store frames as 8 bit indices into one
+ * palette shared by the whole document. It counts the
+ * colors of a set of frames and builds a palette for
+ * them, converts frames to and from indexed color, and
+ * finds the palette entry closest to a color so the tools
+ * can draw on indexed frames.
+ *
+*/
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <vector>
+
+class Palette
+{
+public:
+    /// Most entries an 8 bit palette can have
+    static constexpr int MAX_COLORS = 256;
+
+    /// Entry 0 of every palette is fully transparent, for erased pixels and empty layers
+    static constexpr int TRANSPARENT_INDEX = 0;
+
+    /// Counts the colors used by `image`, towards the palette `build` returns
+    void addColors(const QImage &image);
+
+    /// Counts `uses` more pixels of `color`, which is taken as fully opaque
+    void addColor(QRgb color, qint64 uses = 1);
+
+    /// Builds one palette for every color counted so far. If fewer than MAX_COLORS colors were
+    /// used, every color gets an entry of its own; otherwise similar colors are merged with
+    /// median cut, weighted by how often each color is used
+    QList<QRgb> build() const;
+
+    /// Converts `image` to 8 bit indices into `palette`. Colors not in the palette are matched to
+    /// the closest entry, and mostly transparent pixels become TRANSPARENT_INDEX
+    static QImage toIndexed(const QImage &image, const QList<QRgb> &palette);
+
+    /// Converts an indexed image back to 32 bit pixels. The result is only given an alpha channel
+    /// if some pixel uses a transparent entry
+    static QImage toRgb(const QImage &image);
+
+    /// Returns the index of the entry closest to `color`
+    static int nearest(const QList<QRgb> &palette, QRgb color);
+
+private:
+    /// A color and how many pixels use it
+    struct Entry
+    {
+        QRgb color;
+        qint64 count;
+    };
+
+    /// How many pixels use each color counted by `addColors`
+    QHash<QRgb, qint64> counts;
+
+    /// Merges `entries` into at most `colors` colors with weighted median cut
+    static QList<QRgb> medianCut(std::vector<Entry> entries, int colors);
+};
+
+#endif // PALETTE_H
@@ -0,0 +1,18 @@
+# Benchmarks for the drawing, rendering, fill, undo and file hot paths.
+# Built in release mode so the timings reflect what users run.
+
+QT = core gui concurrent
+
+CONFIG += c++17 console release
+CONFIG -= app_bundle
+
+TARGET = piss-bench
+
+include(core.pri)
+
+SOURCES += \
+    benchmark.cpp \
+    benchmain.cpp
+
+HEADERS += \
+    benchmark.h
@@ -0,0 +1,23 @@
+# Command-line tool for converting and exporting projects without a display.
+# Shares the model and file format code with the editor through core.pri.
+
+QT = core gui concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = piss-cli
+
+include(core.pri)
+
+SOURCES += \
+    batchprocessor.cpp \
+    climain.cpp
+
+HEADERS += \
+    batchprocessor.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,74 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * PreviewCache Source
+ *
+ * Brief:
+ * The PreviewCache keeps each frame's animation preview
+ * scaled and ready to show, so playback only has to swap
+ * pixmaps. A preview is scaled again only once its frame
+ * has been edited or the preview size has changed.
+ *
+*/
+
+#include "previewcache.h"
+#include "profiler.h"
+
+/**
+ * @brief PreviewCache::get - Returns the cached preview of a frame, scaling the frame again only if it
+ * has changed since the preview was made or a different size is wanted
+ * @param index - Which frame the preview is of
+ * @param revision - The frame's current revision, from `Model::Frames::revision()`
+ * @param size - The size to fit the preview in, or an invalid size for the frame's actual size
+ * @param frame - Returns the frame's image. Only called on a cache miss
+ * @return The preview pixmap
+ */
+QPixmap PreviewCache::get(uint index, quint64 revision, QSize size, const std::function<QImage()> &frame)
+{
+    if (index >= entries.size())
+    {
+        entries.resize(index + 1);
+    }
+
+    Entry &entry = entries[index];
+    if (entry.pixmap.isNull() || entry.revision != revision || entry.size != size)
+    {
+        Profiler::Scope scope("preview");
+        QImage image = frame();
+        if (size.isValid())
+        {
+            image = image.scaled(size, Qt::KeepAspectRatio);
+        }
+
+        entry.pixmap = QPixmap::fromImage(image);
+        entry.revision = revision;
+        entry.size = size;
+    }
+
+    return entry.pixmap;
+}
+
+/**
+ * @brief PreviewCache::resize - Drops the previews of frames past `frameCount`, such as after frames
+ * were deleted
+ * @param frameCount
+ */
+void PreviewCache::resize(uint frameCount)
+{
+    if (frameCount < entries.size())
+    {
+        entries.resize(frameCount);
+    }
+}
+
+/**
+ * @brief PreviewCache::clear - Drops every preview
+ */
+void PreviewCache::clear()
+{
+    entries.clear();
+}
@@ -0,0 +1,51 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * PreviewCache Header
+ *
+ * Brief:
+ * The PreviewCache keeps each frame's animation preview
+ * scaled and ready to show, so playback only has to swap
+ * pixmaps. A preview is scaled again only once its frame
+ * has been edited or the preview size has changed.
+ *
+*/
+
+#ifndef PREVIEWCACHE_H
+#define PREVIEWCACHE_H
+
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+#include <functional>
+#include <vector>
+
+class PreviewCache
+{
+public:
+    /// Returns the preview of frame `index` at `revision`, scaled to fit `size`, or at its actual size
+    /// if `size` is invalid. `frame` is only called when the preview has to be made again
+    QPixmap get(uint index, quint64 revision, QSize size, const std::function<QImage()> &frame);
+
+    /// Keeps only the previews of the first `frameCount` frames
+    void resize(uint frameCount);
+
+    /// Drops every preview
+    void clear();
+
+private:
+    struct Entry
+    {
+        quint64 revision = 0;
+        QSize size;
+        QPixmap pixmap;
+    };
+
+    std::vector<Entry> entries;
+};
+
+#endif // PREVIEWCACHE_H
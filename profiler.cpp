@@ -0,0 +1,299 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Profiler Source
+ *
+ * Brief:
+ * The Profiler times the hot paths of the editor with
+ * scoped timers and counters. Recent timings of each path
+ * are kept in a rolling window for the canvas overlay, and
+ * can also be recorded as a Chrome trace. While disabled,
+ * a timer costs one relaxed atomic load.
+ *
+*/
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+
+#include "profiler.h"
+
+std::atomic<bool> Profiler::enabled(false);
+std::atomic<bool> Profiler::tracing(false);
+QMutex Profiler::mutex;
+QHash<QByteArray, Profiler::Series> Profiler::series;
+QHash<QByteArray, qint64> Profiler::counterTotals;
+std::vector<Profiler::TraceEvent> Profiler::trace;
+size_t Profiler::traceStart = 0;
+QElapsedTimer Profiler::clock;
+
+/**
+ * @brief Profiler::setEnabled - Turns timing on or off. The shared clock starts the first time
+ * @param enable
+ */
+void Profiler::setEnabled(bool enable)
+{
+    {
+        QMutexLocker lock(&mutex);
+        if (!clock.isValid())
+        {
+            clock.start();
+        }
+    }
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Profiler::setTracing - Starts or stops recording every timed block. Tracing needs timing, so
+ * starting a trace also enables the profiler
+ * @param enable
+ */
+void Profiler::setTracing(bool enable)
+{
+    if (enable)
+    {
+        setEnabled(true);
+        QMutexLocker lock(&mutex);
+        trace.clear();
+        traceStart = 0;
+    }
+    tracing.store(enable, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Profiler::isTracing
+ * @return True while timed blocks are being recorded into the trace
+ */
+bool Profiler::isTracing()
+{
+    return tracing.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Profiler::count - Adds to a counter, if the profiler is enabled
+ * @param name - String literal naming the counter
+ * @param amount
+ */
+void Profiler::count(const char *name, qint64 amount)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    QMutexLocker lock(&mutex);
+    counterTotals[QByteArray::fromRawData(name, qstrlen(name))] += amount;
+}
+
+/**
+ * @brief Profiler::addSample - Adds a duration to a path's rolling window without it appearing in
+ * the trace, for durations that aren't a single block of code
+ * @param name - String literal naming the path
+ * @param nanoseconds
+ */
+void Profiler::addSample(const char *name, qint64 nanoseconds)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    QMutexLocker lock(&mutex);
+    Series &path = series[QByteArray::fromRawData(name, qstrlen(name))];
+    path.samples[path.next] = nanoseconds;
+    path.next = (path.next + 1) % WINDOW_SIZE;
+    path.count++;
+}
+
+/**
+ * @brief Profiler::now - Nanoseconds since the profiler was first enabled
+ * @return
+ */
+qint64 Profiler::now()
+{
+    return clock.nsecsElapsed();
+}
+
+/**
+ * @brief Profiler::record - Stores the duration of a finished Scope, and adds it to the trace while
+ * tracing. Once the trace is full, the oldest events are overwritten
+ * @param name
+ * @param start
+ * @param duration
+ */
+void Profiler::record(const char *name, qint64 start, qint64 duration)
+{
+    addSample(name, duration);
+
+    if (!isTracing())
+    {
+        return;
+    }
+
+    TraceEvent event{name, start, duration, quint64(quintptr(QThread::currentThreadId()))};
+    QMutexLocker lock(&mutex);
+    if (trace.size() < size_t(MAX_TRACE_EVENTS))
+    {
+        trace.push_back(event);
+    }
+    else
+    {
+        trace[traceStart] = event;
+        traceStart = (traceStart + 1) % trace.size();
+    }
+}
+
+/**
+ * @brief Profiler::summary - Works out the mean, median, 95th percentile and worst recent timing of
+ * every path, sorted by name
+ * @return
+ */
+std::vector<Profiler::Stats> Profiler::summary()
+{
+    std::vector<Stats> result;
+    QMutexLocker lock(&mutex);
+
+    for (auto it = series.constBegin(); it != series.constEnd(); ++it)
+    {
+        const Series &path = it.value();
+        int filled = int(std::min<qint64>(path.count, WINDOW_SIZE));
+        if (filled == 0)
+        {
+            continue;
+        }
+
+        std::vector<qint64> sorted(path.samples.begin(), path.samples.begin() + filled);
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0;
+        for (qint64 sample : sorted)
+        {
+            total += sample;
+        }
+
+        result.push_back({QString::fromLatin1(it.key()),
+                          path.count,
+                          total / filled / 1000.0,
+                          sorted[filled / 2] / 1000.0,
+                          sorted[std::min(filled - 1, filled * 95 / 100)] / 1000.0,
+                          sorted.back() / 1000.0});
+    }
+
+    std::sort(result.begin(), result.end(), [](const Stats &a, const Stats &b) { return a.name < b.name; });
+    return result;
+}
+
+/**
+ * @brief Profiler::counters
+ * @return The total of every counter since the last reset
+ */
+QHash<QString, qint64> Profiler::counters()
+{
+    QHash<QString, qint64> result;
+    QMutexLocker lock(&mutex);
+    for (auto it = counterTotals.constBegin(); it != counterTotals.constEnd(); ++it)
+    {
+        result[QString::fromLatin1(it.key())] = it.value();
+    }
+    return result;
+}
+
+/**
+ * @brief Profiler::report - One line per timed path and counter, for the canvas overlay
+ * @return
+ */
+QStringList Profiler::report()
+{
+    QStringList lines;
+    lines.append(QString("%1 %2 %3 %4 %5").arg("path (ms)", -16).arg("mean", 7).arg("p50", 7).arg("p95", 7).arg("max", 7));
+
+    for (const Stats &stats : summary())
+    {
+        lines.append(QString("%1 %2 %3 %4 %5")
+                         .arg(stats.name, -16)
+                         .arg(stats.mean / 1000.0, 7, 'f', 2)
+                         .arg(stats.median / 1000.0, 7, 'f', 2)
+                         .arg(stats.p95 / 1000.0, 7, 'f', 2)
+                         .arg(stats.max / 1000.0, 7, 'f', 2));
+    }
+
+    QHash<QString, qint64> totals = counters();
+    QStringList names = totals.keys();
+    names.sort();
+    for (const QString &name : names)
+    {
+        lines.append(QString("%1 %2").arg(name, -16).arg(totals[name], 7));
+    }
+
+    if (isTracing())
+    {
+        lines.append("recording trace");
+    }
+    return lines;
+}
+
+/**
+ * @brief Profiler::writeTrace - Writes every recorded event as a complete ("X") event of Chrome's trace
+ * event format. Thread ids are renumbered from 1 in the order the threads first appear
+ * @param filePath
+ * @return
+ */
+bool Profiler::writeTrace(const QString &filePath)
+{
+    QJsonArray events;
+    {
+        QMutexLocker lock(&mutex);
+        QHash<quint64, int> threadNumbers;
+
+        for (size_t i = 0; i < trace.size(); i++)
+        {
+            const TraceEvent &event = trace[(traceStart + i) % trace.size()];
+            if (!threadNumbers.contains(event.thread))
+            {
+                threadNumbers.insert(event.thread, threadNumbers.size() + 1);
+            }
+
+            QJsonObject entry;
+            entry["name"] = QString::fromLatin1(event.name);
+            entry["ph"] = "X";
+            entry["ts"] = event.start / 1000.0;
+            entry["dur"] = event.duration / 1000.0;
+            entry["pid"] = qint64(QCoreApplication::applicationPid());
+            entry["tid"] = threadNumbers[event.thread];
+            events.append(entry);
+        }
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+/**
+ * @brief Profiler::reset - Clears all collected timings, counters and trace events
+ */
+void Profiler::reset()
+{
+    QMutexLocker lock(&mutex);
+    series.clear();
+    counterTotals.clear();
+    trace.clear();
+    traceStart = 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Profiler Header
+ *
+ * Brief:
+ * The Profiler times the hot paths of the editor with
+ * scoped timers and counters. Recent timings of each path
+ * are kept in a rolling window for the canvas overlay, and
+ * can also be recorded as a Chrome trace. While disabled,
+ * a timer costs one relaxed atomic load.
+ *
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <atomic>
+#include <vector>
+
+class Profiler
+{
+public:
+    /// Summary of the recent timings of one path, in microseconds
+    struct Stats
+    {
+        QString name;
+        qint64 count;
+        double mean;
+        double median;
+        double p95;
+        double max;
+    };
+
+    /// Times the enclosing block, from construction to destruction. `name` must be a string literal,
+    /// since only the pointer is kept
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        qint64 start;
+    };
+
+    /// How many recent samples of each path the rolling window keeps
+    static constexpr int WINDOW_SIZE = 240;
+
+    /// Trace events kept before the oldest are dropped, about 40 MB of JSON
+    static constexpr int MAX_TRACE_EVENTS = 500000;
+
+    /// Turns timing on or off. Turning it off keeps what was already collected
+    static void setEnabled(bool enable);
+    static bool isEnabled();
+
+    /// Turns recording of every timed block into the trace on or off. Starting a trace clears the last one
+    static void setTracing(bool enable);
+    static bool isTracing();
+
+    /// Adds `amount` to the counter `name`, which must be a string literal
+    static void count(const char *name, qint64 amount = 1);
+
+    /// Records a duration measured elsewhere, such as the time between two repaints
+    static void addSample(const char *name, qint64 nanoseconds);
+
+    /// Returns the recent timings of every path, and the totals of every counter
+    static std::vector<Stats> summary();
+    static QHash<QString, qint64> counters();
+
+    /// Formats `summary()` and `counters()` as lines of text for the overlay
+    static QStringList report();
+
+    /// Writes the recorded trace as Chrome trace JSON, which chrome://tracing and Perfetto open.
+    /// Returns false if the file can't be written
+    static bool writeTrace(const QString &filePath);
+
+    /// Forgets every timing, counter and trace event
+    static void reset();
+
+private:
+    /// The last `WINDOW_SIZE` durations of one path, in nanoseconds
+    struct Series
+    {
+        std::array<qint64, WINDOW_SIZE> samples{};
+        int next = 0;
+        qint64 count = 0;
+    };
+
+    /// One timed block, for the trace
+    struct TraceEvent
+    {
+        const char *name;
+        qint64 start;
+        qint64 duration;
+        quint64 thread;
+    };
+
+    static std::atomic<bool> enabled;
+    static std::atomic<bool> tracing;
+
+    /// Everything below is guarded by `mutex`, and only touched while enabled
+    static QMutex mutex;
+    static QHash<QByteArray, Series> series;
+    static QHash<QByteArray, qint64> counterTotals;
+    static std::vector<TraceEvent> trace;
+    static size_t traceStart;
+
+    /// Shared clock, so every thread's timestamps line up in the trace
+    static QElapsedTimer clock;
+
+    static qint64 now();
+    static void record(const char *name, qint64 start, qint64 duration);
+};
+
+inline bool Profiler::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+inline Profiler::Scope::Scope(const char *name)
+    : name(name)
+    , start(isEnabled() ? now() : -1)
+{}
+
+inline Profiler::Scope::~Scope()
+{
+    if (start >= 0)
+    {
+        record(name, start, now() - start);
+    }
+}
+
+#endif // PROFILER_H
@@ -0,0 +1,748 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ProjectFile Source
+ *
+ * Brief:
+ * The ProjectFile reads and writes .ssp projects. Projects
+ * are stored in a versioned binary container: a header with
+ * the canvas settings, one compressed chunk per frame, and an
+ * index table saying where each chunk is. Older JSON based
+ * .ssp files can still be opened. Frames are compressed and
+ * decompressed in parallel, and saving and loading can run
+ * in the background while reporting progress. Projects can
+ * be opened lazily, leaving frames in the memory-mapped file
+ * until they are used.
+ *
+ * Layout (little endian):
+ *   header       "PISS", version, flags, frame width, frame height, frame count,
+ *                fps, zoom, offset x, offset y, current frame, index table offset
+ *   chunks       one zlib compressed block of packed pixel rows per frame, then one per layer
+ *   index table  offset, length, width, height and QImage::Format of each frame's chunk
+ *   layer table  (version 2) number of frames with layers, then for each: frame index, layer
+ *                count, active layer, and per layer its name, visibility, opacity, blend
+ *                mode and chunk entry. Frames with layers store them flattened as their chunk
+ *   palette      (version 3) number of entries, then each entry as an ARGB value. Empty
+ *                unless frames are indexed, in which case their chunks hold one byte per pixel
+ *
+*/
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPromise>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "palette.h"
+#include "profiler.h"
+#include "projectfile.h"
+
+/**
+ * @brief setupStream - Puts a stream in the byte order and precision the project format uses
+ * @param stream
+ */
+static void setupStream(QDataStream &stream)
+{
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+/**
+ * @brief encodeUnlessSaved - Compresses an image, unless the last save already wrote it as it is now
+ * @param image
+ * @param savedChunks - What the last save wrote, or null
+ * @return
+ */
+static FrameChunk encodeUnlessSaved(const QImage &image, const ChunkCache *savedChunks)
+{
+    FrameChunk chunk = savedChunks != nullptr ? savedChunks->find(image) : FrameChunk();
+    return chunk.isEmpty() ? FrameChunk::encode(image) : chunk;
+}
+
+/**
+ * @brief fileThreadPool - Background saves and loads run here, one at a time. Keeping them out of
+ * the global pool leaves every global thread free for compressing and decompressing frames
+ * @return
+ */
+static QThreadPool *fileThreadPool()
+{
+    static QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    return &pool;
+}
+
+/**
+ * @brief ProjectFile::Project::isValid - Returns true if the project has at least one frame
+ * @return
+ */
+bool ProjectFile::Project::isValid() const
+{
+    return !frames.empty();
+}
+
+/**
+ * @brief ProjectFile::Project::addFrame - Adds a decoded frame to the end of the project
+ * @param frame
+ */
+void ProjectFile::Project::addFrame(const QImage &frame)
+{
+    frames.push_back(frame);
+    chunks.push_back(FrameChunk());
+    layers.push_back(nullptr);
+}
+
+/**
+ * @brief ProjectFile::Project::addFrame - Adds a compressed frame to the end of the project
+ * @param chunk
+ */
+void ProjectFile::Project::addFrame(const FrameChunk &chunk)
+{
+    frames.push_back(QImage());
+    chunks.push_back(chunk);
+    layers.push_back(nullptr);
+}
+
+/**
+ * @brief ProjectFile::Project::addFrame - Adds a frame with layers to the end of the project. The
+ * flattened layers are kept alongside them
+ * @param stack
+ */
+void ProjectFile::Project::addFrame(const std::shared_ptr<LayerStack> &stack)
+{
+    frames.push_back(stack->composite());
+    chunks.push_back(FrameChunk());
+    layers.push_back(stack);
+}
+
+/**
+ * @brief ProjectFile::snapshot - Captures the frames and canvas settings of the model. Frames that are
+ * still compressed are taken as they are rather than decoded. Their bytes are copied out of the mapped
+ * project file first, since that file is about to be replaced. Layers are copied, which only shares
+ * their pixels, so the editor can keep changing them
+ * @param model
+ * @return
+ */
+ProjectFile::Project ProjectFile::snapshot(Model &model)
+{
+    Model::Frames &frames = model.getFrames();
+    frames.detachFromFile();
+
+    Project project;
+    for (uint i = 0; i < frames.numFrames(); i++)
+    {
+        FrameChunk chunk = frames.compressed(i);
+        if (LayerStack *stack = frames.layers(i))
+        {
+            project.addFrame(std::make_shared<LayerStack>(*stack));
+        }
+        else if (chunk.isEmpty())
+        {
+            project.addFrame(frames.read(i));
+        }
+        else
+        {
+            project.addFrame(chunk);
+        }
+    }
+    project.palette = frames.getPalette();
+    project.savedChunks = frames.savedChunks();
+    project.fps = model.getFPS();
+    project.zoom = model.getCanvasSettings().getZoom();
+    project.position = model.getCanvasSettings().getPosition();
+    project.currentFrame = model.getCanvasSettings().getCurrentFrameIndex();
+
+    return project;
+}
+
+/**
+ * @brief ProjectFile::restore - Moves the frames of a project into the model and applies its canvas
+ * settings. Compressed frames stay compressed until the model uses them. The undo history belongs to
+ * the old project, so it is cleared
+ * @param project - The project to restore
+ * @param model
+ */
+void ProjectFile::restore(Project &project, Model &model)
+{
+    Model::Frames &frames = model.getFrames();
+    frames.clearFrames();
+    if (!project.palette.isEmpty())
+    {
+        frames.setPalette(project.palette);
+    }
+    for (uint i = 0; i < project.frames.size(); i++)
+    {
+        if (project.frames[i].isNull())
+        {
+            frames.pushCompressed(project.chunks[i]);
+        }
+        else
+        {
+            frames.push(project.frames[i]);
+        }
+
+        if (i < project.layers.size() && project.layers[i])
+        {
+            frames.setLayers(i, project.layers[i]);
+        }
+    }
+
+    model.clearBuffers();
+    model.updateFPS(project.fps);
+    model.getCanvasSettings().setZoom(project.zoom);
+    model.getCanvasSettings().setPosition(project.position);
+    model.getCanvasSettings().setCurrentFrameIndex(
+        project.currentFrame < frames.numFrames() ? project.currentFrame : 0);
+}
+
+/**
+ * @brief ProjectFile::save - Saves the model to disk, blocking until done
+ * @param filePath - Where to save the project
+ * @param model - The project to save
+ * @return True if the project was saved
+ */
+bool ProjectFile::save(const QString &filePath, Model &model)
+{
+    return write(filePath, snapshot(model));
+}
+
+/**
+ * @brief ProjectFile::load - Loads a project into the model, blocking until done
+ * @param filePath - The project to open
+ * @param model - The model to load the project into
+ * @return True if the project was loaded
+ */
+bool ProjectFile::load(const QString &filePath, Model &model)
+{
+    Project project = read(filePath);
+    if (!project.isValid())
+    {
+        return false;
+    }
+
+    restore(project, model);
+    return true;
+}
+
+/**
+ * @brief ProjectFile::write - Streams the project to disk one frame at a time. Decoded frames are
+ * compressed on every core at once and written in order as soon as each one is ready; frames that are
+ * already compressed, or that the last save wrote and haven't been edited since, are written as they
+ * are, so saving a large project after a small edit only compresses what changed. The index table is written
+ * after the chunks and its position patched into the header at the end. The file is replaced
+ * atomically, so a failed save never leaves a half written project behind
+ * @param filePath - Where to save the project
+ * @param project - The project to save
+ * @param progress - Told how many frames have been written so far
+ * @return True if the project was saved
+ */
+bool ProjectFile::write(const QString &filePath,
+                        const Project &project,
+                        const ProgressCallback &progress)
+{
+    Profiler::Scope scope("save");
+    if (!project.isValid())
+    {
+        return false;
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    const QImage &firstFrame = project.frames.front();
+    QSize frameSize = firstFrame.isNull()
+                          ? QSize(project.chunks.front().width, project.chunks.front().height)
+                          : firstFrame.size();
+
+    QDataStream out(&file);
+    setupStream(out);
+
+    out.writeRawData(MAGIC, sizeof(MAGIC));
+    out << VERSION << quint16(0) << qint32(frameSize.width()) << qint32(frameSize.height())
+        << quint32(project.frames.size()) << qint32(project.fps) << project.zoom
+        << project.position.x() << project.position.y() << quint32(project.currentFrame);
+
+    // Placeholder for the index table offset, filled in once the chunks are written
+    qint64 indexOffsetPosition = file.pos();
+    out << quint64(0);
+
+    std::vector<FrameEntry> entries;
+    entries.reserve(project.frames.size());
+
+    std::vector<int> frameIndices(project.frames.size());
+    std::iota(frameIndices.begin(), frameIndices.end(), 0);
+
+    // Every chunk written is remembered by the image it holds, so the next save can skip compressing it
+    const ChunkCache *savedChunks = project.savedChunks.get();
+    QHash<qint64, FrameChunk> writtenChunks;
+
+    QFuture<FrameChunk> chunks = QtConcurrent::mapped(frameIndices, [&project, savedChunks](int i) {
+        return project.frames[i].isNull() ? project.chunks[i] : encodeUnlessSaved(project.frames[i], savedChunks);
+    });
+
+    for (int i = 0; i < int(project.frames.size()); i++)
+    {
+        FrameChunk chunk = chunks.resultAt(i);
+        if (!project.frames[i].isNull())
+        {
+            writtenChunks.insert(project.frames[i].cacheKey(), chunk);
+        }
+
+        entries.push_back({quint64(file.pos()),
+                           quint32(chunk.data.size()),
+                           chunk.width,
+                           chunk.height,
+                           chunk.format});
+        out.writeRawData(chunk.data.constData(), chunk.data.size());
+
+        if (progress)
+        {
+            progress(i + 1, int(project.frames.size()));
+        }
+    }
+
+    // Every layer gets a chunk of its own after the frames, compressed in parallel the same way
+    std::vector<QImage> layerImages;
+    for (const auto &stack : project.layers)
+    {
+        for (int i = 0; stack && i < stack->count(); i++)
+        {
+            layerImages.push_back(stack->layer(i).image);
+        }
+    }
+
+    QFuture<FrameChunk> layerChunks = QtConcurrent::mapped(layerImages, [savedChunks](const QImage &image) {
+        return encodeUnlessSaved(image, savedChunks);
+    });
+
+    std::vector<FrameEntry> layerEntries;
+    layerEntries.reserve(layerImages.size());
+    for (int i = 0; i < int(layerImages.size()); i++)
+    {
+        FrameChunk chunk = layerChunks.resultAt(i);
+        writtenChunks.insert(layerImages[i].cacheKey(), chunk);
+        layerEntries.push_back({quint64(file.pos()),
+                                quint32(chunk.data.size()),
+                                chunk.width,
+                                chunk.height,
+                                chunk.format});
+        out.writeRawData(chunk.data.constData(), chunk.data.size());
+    }
+
+    quint64 indexOffset = file.pos();
+    for (const FrameEntry &entry : entries)
+    {
+        out << entry.offset << entry.length << entry.width << entry.height << entry.format;
+    }
+
+    quint32 layeredFrames = quint32(std::count_if(project.layers.begin(), project.layers.end(),
+                                                  [](const auto &stack) { return stack != nullptr; }));
+    out << layeredFrames;
+
+    size_t layerEntry = 0;
+    for (uint i = 0; i < project.layers.size(); i++)
+    {
+        const LayerStack *stack = project.layers[i].get();
+        if (stack == nullptr)
+        {
+            continue;
+        }
+
+        out << quint32(i) << quint32(stack->count()) << qint32(stack->activeIndex());
+        for (int l = 0; l < stack->count(); l++)
+        {
+            const LayerStack::Layer &layer = stack->layer(l);
+            const FrameEntry &entry = layerEntries[layerEntry++];
+            out << layer.name << layer.visible << float(layer.opacity) << qint32(layer.blendMode);
+            out << entry.offset << entry.length << entry.width << entry.height << entry.format;
+        }
+    }
+
+    out << quint32(project.palette.size());
+    for (QRgb color : project.palette)
+    {
+        out << quint32(color);
+    }
+
+    file.seek(indexOffsetPosition);
+    out << indexOffset;
+
+    if (out.status() != QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit())
+    {
+        return false;
+    }
+
+    if (project.savedChunks)
+    {
+        project.savedChunks->replace(std::move(writtenChunks));
+    }
+    return true;
+}
+
+/**
+ * @brief ProjectFile::read - Reads a project from disk. Binary projects are read by seeking to the
+ * index table and then each chunk. Anything that doesn't start with the binary header is treated as
+ * an old JSON project.
+ *
+ * When `lazy` is set the file is memory-mapped and every frame is left as a chunk pointing into the
+ * mapping, so opening costs the same no matter how many frames there are. Otherwise every chunk is
+ * decompressed on all cores at once
+ * @param filePath - The project to open
+ * @param progress - Told how many frames have been read so far
+ * @param lazy - True to leave frames compressed until they are used
+ * @return The project, which is invalid if the file couldn't be read
+ */
+ProjectFile::Project ProjectFile::read(const QString &filePath,
+                                       const ProgressCallback &progress,
+                                       bool lazy)
+{
+    Profiler::Scope scope("load");
+    std::shared_ptr<QFile> file = std::make_shared<QFile>(filePath);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        return Project();
+    }
+
+    char magic[sizeof(MAGIC)];
+    if (file->peek(magic, sizeof(MAGIC)) != sizeof(MAGIC)
+        || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return readLegacy(*file, progress);
+    }
+
+    QDataStream in(file.get());
+    setupStream(in);
+    in.skipRawData(sizeof(MAGIC));
+
+    Project project;
+    quint16 version;
+    quint16 flags;
+    qint32 width;
+    qint32 height;
+    quint32 frameCount;
+    qint32 fps;
+    float offsetX;
+    float offsetY;
+    quint32 currentFrame;
+    quint64 indexOffset;
+
+    in >> version >> flags >> width >> height >> frameCount >> fps >> project.zoom >> offsetX
+        >> offsetY >> currentFrame >> indexOffset;
+
+    if (in.status() != QDataStream::Ok || version > VERSION || frameCount == 0
+        || !file->seek(indexOffset))
+    {
+        return Project();
+    }
+
+    project.fps = fps;
+    project.position = QVector2D(offsetX, offsetY);
+    project.currentFrame = currentFrame;
+
+    std::vector<FrameEntry> entries(frameCount);
+    for (FrameEntry &entry : entries)
+    {
+        in >> entry.offset >> entry.length >> entry.width >> entry.height >> entry.format;
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        return Project();
+    }
+
+    // If the file can't be mapped, chunks are read into memory instead
+    uchar *mapping = lazy ? file->map(0, file->size()) : nullptr;
+
+    std::vector<FrameChunk> chunks(frameCount);
+    for (uint i = 0; i < frameCount; i++)
+    {
+        const FrameEntry &entry = entries[i];
+        FrameChunk &chunk = chunks[i];
+        chunk.width = entry.width;
+        chunk.height = entry.height;
+        chunk.format = entry.format;
+
+        if (entry.offset + entry.length > quint64(file->size()))
+        {
+            return Project();
+        }
+
+        if (mapping != nullptr)
+        {
+            chunk.data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapping + entry.offset),
+                                                 entry.length);
+            chunk.mappedFile = file;
+        }
+        else
+        {
+            chunk.data = QByteArray(entry.length, Qt::Uninitialized);
+            if (!file->seek(entry.offset)
+                || in.readRawData(chunk.data.data(), entry.length) != qint64(entry.length))
+            {
+                return Project();
+            }
+        }
+    }
+
+    if (lazy)
+    {
+        for (const FrameChunk &chunk : chunks)
+        {
+            project.addFrame(chunk);
+        }
+
+        if (version >= 2 && !readLayers(*file, in, project, version))
+        {
+            return Project();
+        }
+
+        if (progress)
+        {
+            progress(frameCount, frameCount);
+        }
+        return project;
+    }
+
+    QFuture<QImage> frames = QtConcurrent::mapped(chunks, [](const FrameChunk &chunk) {
+        return chunk.decode();
+    });
+
+    for (int i = 0; i < int(frameCount); i++)
+    {
+        QImage frame = frames.resultAt(i);
+        if (frame.isNull())
+        {
+            frames.cancel();
+            frames.waitForFinished();
+            return Project();
+        }
+        project.addFrame(frame);
+
+        if (progress)
+        {
+            progress(i + 1, int(frameCount));
+        }
+    }
+
+    if (version >= 2 && !readLayers(*file, in, project, version))
+    {
+        return Project();
+    }
+
+    return project;
+}
+
+/**
+ * @brief ProjectFile::writeAsync - Saves a project in the background. The future's progress value
+ * counts written frames out of the total number of frames
+ * @param filePath - Where to save the project
+ * @param project - A snapshot of the project to save
+ * @return A future holding whether the save succeeded
+ */
+QFuture<bool> ProjectFile::writeAsync(const QString &filePath, const Project &project)
+{
+    return QtConcurrent::run(fileThreadPool(), [filePath, project](QPromise<bool> &promise) {
+        promise.setProgressRange(0, int(project.frames.size()));
+        promise.addResult(write(filePath, project, [&promise](int framesDone, int) {
+            promise.setProgressValue(framesDone);
+        }));
+    });
+}
+
+/**
+ * @brief ProjectFile::readAsync - Loads a project in the background. The future's progress value
+ * counts read frames, and its range is set once the number of frames in the file is known
+ * @param filePath - The project to open
+ * @param lazy - True to leave frames compressed until they are used
+ * @return A future holding the project, which is invalid if the file couldn't be read
+ */
+QFuture<ProjectFile::Project> ProjectFile::readAsync(const QString &filePath, bool lazy)
+{
+    return QtConcurrent::run(fileThreadPool(), [filePath, lazy](QPromise<Project> &promise) {
+        promise.addResult(read(
+            filePath,
+            [&promise](int framesDone, int frameCount) {
+                promise.setProgressRange(0, frameCount);
+                promise.setProgressValue(framesDone);
+            },
+            lazy));
+    });
+}
+
+/**
+ * @brief ProjectFile::readLegacy - Reads a project from the original .ssp format: a JSON array of
+ * objects holding each frame as hex encoded PNG data. The PNGs are decoded in parallel
+ * @param file - The open project file
+ * @param progress - Told how many frames have been decoded so far
+ * @return The project, which is invalid if the file couldn't be read
+ */
+ProjectFile::Project ProjectFile::readLegacy(QIODevice &file, const ProgressCallback &progress)
+{
+    // Initialize json objects necessary for json serialization
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+    QJsonArray imageArray = jsonDoc.array();
+    std::vector<QByteArray> imageBytes;
+
+    for (auto imageData : imageArray) {
+        // Extract the "QImage" hex string data from the json object and convert it back into bytes
+        QString jsonString = imageData.toObject().value("QImage").toString();
+        imageBytes.push_back(QByteArray::fromHex(jsonString.toLatin1()));
+    }
+
+    QFuture<QImage> frames = QtConcurrent::mapped(imageBytes, [](const QByteArray &bytes) {
+        return QImage::fromData(bytes);
+    });
+
+    Project project;
+    for (int i = 0; i < int(imageBytes.size()); i++) {
+        QImage frame = frames.resultAt(i);
+        if (frame.isNull()) {
+            frames.cancel();
+            frames.waitForFinished();
+            return Project();
+        }
+        project.addFrame(frame);
+
+        if (progress) {
+            progress(i + 1, int(imageBytes.size()));
+        }
+    }
+
+    return project;
+}
+
+/**
+ * @brief ProjectFile::readLayers - Reads the layer table, which starts right after the index table, and
+ * decodes the chunk of every layer in it. Layers are always decoded, since editing a frame with layers
+ * needs all of them. The palette follows the layer table, and is read before any layer is decoded so
+ * indexed layers and frames can be given it
+ * @param file - The open project file
+ * @param in - A stream on `file`, positioned at the end of the index table
+ * @param project - The project read so far. Its frames get their layers
+ * @param version - The version the file was written with
+ * @return False if the table, the palette or a layer is damaged
+ */
+bool ProjectFile::readLayers(QIODevice &file, QDataStream &in, Project &project, quint16 version)
+{
+    quint32 layeredFrames;
+    in >> layeredFrames;
+
+    struct LayerEntry
+    {
+        quint32 frameIndex;
+        qint32 activeIndex;
+        std::vector<LayerStack::Layer> layers;
+        std::vector<FrameEntry> chunks;
+    };
+    std::vector<LayerEntry> entries;
+
+    for (quint32 i = 0; i < layeredFrames && in.status() == QDataStream::Ok; i++)
+    {
+        LayerEntry entry;
+        quint32 layerCount;
+        in >> entry.frameIndex >> layerCount >> entry.activeIndex;
+        if (entry.frameIndex >= project.frames.size() || layerCount == 0)
+        {
+            return false;
+        }
+
+        for (quint32 l = 0; l < layerCount && in.status() == QDataStream::Ok; l++)
+        {
+            LayerStack::Layer layer;
+            FrameEntry chunk;
+            float opacity;
+            qint32 blendMode;
+            in >> layer.name >> layer.visible >> opacity >> blendMode;
+            in >> chunk.offset >> chunk.length >> chunk.width >> chunk.height >> chunk.format;
+            layer.opacity = opacity;
+            layer.blendMode = BlendMode(blendMode);
+            entry.layers.push_back(layer);
+            entry.chunks.push_back(chunk);
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    if (version >= 3)
+    {
+        quint32 paletteSize;
+        in >> paletteSize;
+        if (paletteSize > quint32(Palette::MAX_COLORS))
+        {
+            return false;
+        }
+        for (quint32 i = 0; i < paletteSize && in.status() == QDataStream::Ok; i++)
+        {
+            quint32 color;
+            in >> color;
+            project.palette.append(QRgb(color));
+        }
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    // Indexed chunks don't store the palette, so every frame is given the one shared palette
+    for (size_t i = 0; i < project.frames.size() && !project.palette.isEmpty(); i++)
+    {
+        if (project.frames[i].format() == QImage::Format_Indexed8)
+        {
+            project.frames[i].setColorTable(project.palette);
+        }
+        if (project.chunks[i].format == QImage::Format_Indexed8)
+        {
+            project.chunks[i].colorTable = project.palette;
+        }
+    }
+
+    for (LayerEntry &entry : entries)
+    {
+        for (size_t l = 0; l < entry.layers.size(); l++)
+        {
+            const FrameEntry &chunkEntry = entry.chunks[l];
+            FrameChunk chunk;
+            chunk.width = chunkEntry.width;
+            chunk.height = chunkEntry.height;
+            chunk.format = chunkEntry.format;
+            if (chunk.format == QImage::Format_Indexed8)
+            {
+                chunk.colorTable = project.palette;
+            }
+            chunk.data = QByteArray(chunkEntry.length, Qt::Uninitialized);
+            if (chunkEntry.offset + chunkEntry.length > quint64(file.size()) || !file.seek(chunkEntry.offset)
+                || file.read(chunk.data.data(), chunkEntry.length) != qint64(chunkEntry.length))
+            {
+                return false;
+            }
+
+            entry.layers[l].image = chunk.decode();
+            if (entry.layers[l].image.isNull() || entry.layers[l].image.size() != entry.layers[0].image.size())
+            {
+                return false;
+            }
+        }
+
+        project.layers[entry.frameIndex] = std::make_shared<LayerStack>(std::move(entry.layers), entry.activeIndex);
+    }
+    return true;
+}
@@ -0,0 +1,133 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ProjectFile Header
+ *
+ * Brief:
+ * The ProjectFile reads and writes .ssp projects. Projects
+ * are stored in a versioned binary container: a header with
+ * the canvas settings, one compressed chunk per frame, and an
+ * index table saying where each chunk is. Older JSON based
+ * .ssp files can still be opened. Frames are compressed and
+ * decompressed in parallel, and saving and loading can run
+ * in the background while reporting progress. Projects can
+ * be opened lazily, leaving frames in the memory-mapped file
+ * until they are used.
+ *
+*/
+
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFuture>
+#include <QImage>
+#include <QString>
+#include <QVector2D>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "chunkcache.h"
+#include "framechunk.h"
+#include "layerstack.h"
+#include "model.h"
+
+class ProjectFile
+{
+public:
+    /// The first bytes of a binary project file
+    static constexpr char MAGIC[4] = {'P', 'I', 'S', 'S'};
+
+    /// Version of the binary format written by `save`. Version 2 added layers, and version 3 the
+    /// palette of indexed projects
+    static constexpr quint16 VERSION = 3;
+
+    /// Where one frame's chunk is in the file, and what it decodes into
+    struct FrameEntry
+    {
+        quint64 offset;
+        quint32 length;
+        qint32 width;
+        qint32 height;
+        qint32 format;
+    };
+
+    /// Everything that gets saved in a project. QImage shares its pixels, so a snapshot is cheap to
+    /// take and can be handed to another thread while the user keeps editing. Each frame is either
+    /// decoded in `frames`, or null there and compressed in `chunks`. Frames with layers also have
+    /// them in `layers`; `frames` then holds the layers flattened, for anything that only needs pixels.
+    /// `palette` is the palette every indexed frame and layer uses, empty for 32 bit color.
+    /// `savedChunks` holds what the last save of the same document wrote, if there was one
+    struct Project
+    {
+        std::vector<QImage> frames;
+        std::vector<FrameChunk> chunks;
+        std::vector<std::shared_ptr<LayerStack>> layers;
+        QList<QRgb> palette;
+        std::shared_ptr<ChunkCache> savedChunks;
+        int fps = 2;
+        float zoom = 8;
+        QVector2D position;
+        uint currentFrame = 0;
+
+        /// Returns true if the project has at least one frame
+        bool isValid() const;
+
+        /// Adds a frame to the end of the project
+        void addFrame(const QImage &frame);
+        void addFrame(const FrameChunk &chunk);
+
+        /// Adds a frame with layers to the end of the project
+        void addFrame(const std::shared_ptr<LayerStack> &stack);
+    };
+
+    /// Called with how many frames have been processed so far, out of `frameCount`
+    using ProgressCallback = std::function<void(int framesDone, int frameCount)>;
+
+    /// Takes a snapshot of the frames and canvas settings of `model`
+    static Project snapshot(Model &model);
+
+    /// Replaces the frames and canvas settings of `model` with those of `project`
+    static void restore(Project &project, Model &model);
+
+    /// Writes every frame of `model` and its canvas settings to `filePath`. Returns false on failure
+    static bool save(const QString &filePath, Model &model);
+
+    /// Replaces the frames and canvas settings of `model` with the project in `filePath`.
+    /// Returns false, leaving `model` untouched, if the file can't be read
+    static bool load(const QString &filePath, Model &model);
+
+    /// Writes `project` to `filePath`, compressing frames on all cores. Frames and layers that are
+    /// unchanged since the last save are written as they were, without compressing them again.
+    /// Returns false on failure
+    static bool write(const QString &filePath,
+                      const Project &project,
+                      const ProgressCallback &progress = nullptr);
+
+    /// Reads the project in `filePath`. Returns an invalid project if the file can't be read.
+    /// Frames are decompressed on all cores, unless `lazy` is set, in which case they are left
+    /// compressed and point straight into the memory-mapped file
+    static Project read(const QString &filePath,
+                        const ProgressCallback &progress = nullptr,
+                        bool lazy = false);
+
+    /// Background versions of `write` and `read`. The futures report progress in frames
+    static QFuture<bool> writeAsync(const QString &filePath, const Project &project);
+    static QFuture<Project> readAsync(const QString &filePath, bool lazy = true);
+
+private:
+    /// Reads a project saved in the original JSON format, where each frame is hex encoded PNG data
+    static Project readLegacy(QIODevice &file, const ProgressCallback &progress);
+
+    /// Reads the layer table that follows the index table and, from version 3, the palette after it.
+    /// Every layer listed is decoded, and indexed frames are given the palette
+    static bool readLayers(QIODevice &file, QDataStream &in, Project &project, quint16 version);
+};
+
+#endif // PROJECTFILE_H
@@ -0,0 +1,352 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Resampler Source
+ *
+ * Brief:
+ * The Resampler resizes whole frames. It crops or extends
+ * the canvas around an anchor, scales with nearest
+ * neighbour sampling, and upscales pixel art with the
+ * Scale2x family of filters. Every kernel works straight
+ * on scanlines, comparing and copying whole pixels, so
+ * indexed frames are scaled without leaving the palette.
+ *
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "blitter.h"
+#include "palette.h"
+#include "resampler.h"
+
+/**
+ * @brief Resampler::anchorOffset - Works out where an image goes on a canvas of a different size. The
+ * anchors are laid out as a 3x3 grid, so the column picks the horizontal offset and the row the vertical
+ * @param from - The size of the image
+ * @param to - The size of the canvas
+ * @param anchor - The edge or corner that stays in place
+ * @return The position of the top left corner of the image. Negative when the canvas is cropped
+ */
+QPoint Resampler::anchorOffset(QSize from, QSize to, ResizeAnchor anchor)
+{
+    auto offset = [](int from, int to, int side) {
+        return side == 0 ? 0 : side == 1 ? (to - from) / 2 : to - from;
+    };
+    int position = int(anchor);
+    return QPoint(offset(from.width(), to.width(), position % 3),
+                  offset(from.height(), to.height(), position / 3));
+}
+
+/**
+ * @brief Resampler::resizeCanvas - Fills a new image of the right size, then copies the source onto it at
+ * its anchored position. Anything that falls outside the new size is cropped
+ * @param image - The image to resize
+ * @param size - The size of the result
+ * @param anchor - The edge or corner of the image that stays in place
+ * @param fill - The color of any new space
+ * @return The resized image
+ */
+QImage Resampler::resizeCanvas(const QImage &image, QSize size, ResizeAnchor anchor, QColor fill)
+{
+    QImage source = kernelFormat(image);
+    if (source.size() == size)
+    {
+        return source;
+    }
+
+    QImage resized = blankLike(source, size);
+    if (resized.format() == QImage::Format_Indexed8)
+    {
+        resized.fill(uint(Palette::nearest(resized.colorTable(), fill.rgba())));
+    }
+    else
+    {
+        resized.fill(uint(Blitter::packPixel(fill, resized.format())));
+    }
+
+    Blitter::paste(resized, source, anchorOffset(source.size(), size, anchor));
+    return resized;
+}
+
+/**
+ * @brief Resampler::scale - Runs the kernel for `filter` on the image, picking the version for its pixel size
+ * @param image - The image to scale
+ * @param size - The size of the result when scaling with nearest neighbour sampling
+ * @param filter - How to scale the image
+ * @return The scaled image, in the format of the source
+ */
+QImage Resampler::scale(const QImage &image, QSize size, ScaleFilter filter)
+{
+    QImage source = kernelFormat(image);
+    if (source.isNull())
+    {
+        return source;
+    }
+
+    bool indexed = source.depth() == 8;
+    QImage scaled;
+    switch (filter)
+    {
+    case ScaleFilter::Nearest:
+        if (size == source.size() || size.isEmpty())
+        {
+            return source;
+        }
+        scaled = blankLike(source, size);
+        indexed ? scaleNearest<uchar>(source, scaled) : scaleNearest<quint32>(source, scaled);
+        break;
+    case ScaleFilter::Scale2x:
+        scaled = blankLike(source, source.size() * 2);
+        indexed ? scale2x<uchar>(source, scaled) : scale2x<quint32>(source, scaled);
+        break;
+    case ScaleFilter::Scale3x:
+        scaled = blankLike(source, source.size() * 3);
+        indexed ? scale3x<uchar>(source, scaled) : scale3x<quint32>(source, scaled);
+        break;
+    case ScaleFilter::Scale4x:
+        // Scale4x is Scale2x run twice
+        scaled = scale(scale(source, QSize(), ScaleFilter::Scale2x), QSize(), ScaleFilter::Scale2x);
+        break;
+    }
+    return scaled;
+}
+
+/**
+ * @brief Resampler::factor - Returns how many times larger a filter makes each side of an image
+ * @param filter - The filter
+ * @return The scale factor, or 0 for nearest neighbour sampling, which scales to any size
+ */
+int Resampler::factor(ScaleFilter filter)
+{
+    switch (filter)
+    {
+    case ScaleFilter::Nearest:
+        return 0;
+    case ScaleFilter::Scale2x:
+        return 2;
+    case ScaleFilter::Scale3x:
+        return 3;
+    case ScaleFilter::Scale4x:
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * @brief Resampler::filterName - Returns the name of a filter, as shown in the resize dialog
+ * @param filter - The filter
+ * @return The name of the filter
+ */
+QString Resampler::filterName(ScaleFilter filter)
+{
+    switch (filter)
+    {
+    case ScaleFilter::Nearest:
+        return "Nearest neighbour";
+    case ScaleFilter::Scale2x:
+        return "Scale2x (EPX)";
+    case ScaleFilter::Scale3x:
+        return "Scale3x";
+    case ScaleFilter::Scale4x:
+        return "Scale4x";
+    }
+    return QString();
+}
+
+/**
+ * @brief Resampler::anchorName - Returns the name of an anchor, as shown in the resize dialog
+ * @param anchor - The anchor
+ * @return The name of the anchor
+ */
+QString Resampler::anchorName(ResizeAnchor anchor)
+{
+    switch (anchor)
+    {
+    case ResizeAnchor::TopLeft:
+        return "Top left";
+    case ResizeAnchor::Top:
+        return "Top";
+    case ResizeAnchor::TopRight:
+        return "Top right";
+    case ResizeAnchor::Left:
+        return "Left";
+    case ResizeAnchor::Center:
+        return "Center";
+    case ResizeAnchor::Right:
+        return "Right";
+    case ResizeAnchor::BottomLeft:
+        return "Bottom left";
+    case ResizeAnchor::Bottom:
+        return "Bottom";
+    case ResizeAnchor::BottomRight:
+        return "Bottom right";
+    }
+    return QString();
+}
+
+/**
+ * @brief Resampler::kernelFormat - Leaves 8 and 32 bit images as they are, and converts anything else to ARGB32
+ * @param image - The image the kernels will run on
+ * @return An image with 8 or 32 bits per pixel
+ */
+QImage Resampler::kernelFormat(const QImage &image)
+{
+    return image.depth() == 8 || image.depth() == 32 ? image : image.convertToFormat(QImage::Format_ARGB32);
+}
+
+/**
+ * @brief Resampler::blankLike - Allocates an image to write a kernel's output into
+ * @param source - The image being resampled
+ * @param size - The size of the result
+ * @return An uninitialised image in the format of `source`, sharing its color table
+ */
+QImage Resampler::blankLike(const QImage &source, QSize size)
+{
+    QImage blank(size, source.format());
+    if (source.format() == QImage::Format_Indexed8)
+    {
+        blank.setColorTable(source.colorTable());
+    }
+    return blank;
+}
+
+/**
+ * @brief Resampler::scaleNearest - Scales with nearest neighbour sampling. Which source column feeds each
+ * destination column is worked out once, and destination rows that sample the same source row are copied
+ * from the row above instead of being sampled again
+ * @param source - The image to scale
+ * @param destination - Where to write the result. Its size decides the scale
+ */
+template <typename Pixel>
+void Resampler::scaleNearest(const QImage &source, QImage &destination)
+{
+    int width = destination.width();
+    std::vector<int> columns(width);
+    for (int x = 0; x < width; x++)
+    {
+        columns[x] = int(qint64(x) * source.width() / width);
+    }
+
+    size_t rowBytes = size_t(width) * sizeof(Pixel);
+    int previousRow = -1;
+    for (int y = 0; y < destination.height(); y++)
+    {
+        Pixel *out = reinterpret_cast<Pixel *>(destination.scanLine(y));
+        int row = int(qint64(y) * source.height() / destination.height());
+        if (row == previousRow)
+        {
+            std::memcpy(out, destination.constScanLine(y - 1), rowBytes);
+            continue;
+        }
+
+        const Pixel *in = reinterpret_cast<const Pixel *>(source.constScanLine(row));
+        for (int x = 0; x < width; x++)
+        {
+            out[x] = in[columns[x]];
+        }
+        previousRow = row;
+    }
+}
+
+/**
+ * @brief Resampler::scale2x - Doubles the image with the Scale2x (EPX) rules. Each pixel becomes a 2x2 block,
+ * and a corner of the block takes the color of its two neighbouring edges when they match each other but not
+ * the opposite edges, which rounds off the stair steps of diagonal lines without inventing new colors.
+ * Neighbours past the edges of the image repeat the edge pixel
+ * @param source - The image to scale
+ * @param destination - Where to write the result, twice the size of `source`
+ */
+template <typename Pixel>
+void Resampler::scale2x(const QImage &source, QImage &destination)
+{
+    int width = source.width();
+    int height = source.height();
+    for (int y = 0; y < height; y++)
+    {
+        const Pixel *above = reinterpret_cast<const Pixel *>(source.constScanLine(std::max(y - 1, 0)));
+        const Pixel *row = reinterpret_cast<const Pixel *>(source.constScanLine(y));
+        const Pixel *below = reinterpret_cast<const Pixel *>(source.constScanLine(std::min(y + 1, height - 1)));
+        Pixel *top = reinterpret_cast<Pixel *>(destination.scanLine(y * 2));
+        Pixel *bottom = reinterpret_cast<Pixel *>(destination.scanLine(y * 2 + 1));
+
+        for (int x = 0; x < width; x++)
+        {
+            Pixel b = above[x];
+            Pixel d = row[std::max(x - 1, 0)];
+            Pixel e = row[x];
+            Pixel f = row[std::min(x + 1, width - 1)];
+            Pixel h = below[x];
+
+            if (b != h && d != f)
+            {
+                top[x * 2] = d == b ? d : e;
+                top[x * 2 + 1] = b == f ? f : e;
+                bottom[x * 2] = d == h ? d : e;
+                bottom[x * 2 + 1] = h == f ? f : e;
+            }
+            else
+            {
+                top[x * 2] = top[x * 2 + 1] = bottom[x * 2] = bottom[x * 2 + 1] = e;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Resampler::scale3x - Triples the image with the Scale3x (AdvMAME3x) rules. The corners of each 3x3
+ * block follow the Scale2x rules, and the edges also check the diagonal neighbours so single pixel lines
+ * stay one pixel wide. Neighbours past the edges of the image repeat the edge pixel
+ * @param source - The image to scale
+ * @param destination - Where to write the result, three times the size of `source`
+ */
+template <typename Pixel>
+void Resampler::scale3x(const QImage &source, QImage &destination)
+{
+    int width = source.width();
+    int height = source.height();
+    for (int y = 0; y < height; y++)
+    {
+        const Pixel *above = reinterpret_cast<const Pixel *>(source.constScanLine(std::max(y - 1, 0)));
+        const Pixel *row = reinterpret_cast<const Pixel *>(source.constScanLine(y));
+        const Pixel *below = reinterpret_cast<const Pixel *>(source.constScanLine(std::min(y + 1, height - 1)));
+        Pixel *top = reinterpret_cast<Pixel *>(destination.scanLine(y * 3));
+        Pixel *middle = reinterpret_cast<Pixel *>(destination.scanLine(y * 3 + 1));
+        Pixel *bottom = reinterpret_cast<Pixel *>(destination.scanLine(y * 3 + 2));
+
+        for (int x = 0; x < width; x++)
+        {
+            int left = std::max(x - 1, 0);
+            int right = std::min(x + 1, width - 1);
+            Pixel a = above[left], b = above[x], c = above[right];
+            Pixel d = row[left], e = row[x], f = row[right];
+            Pixel g = below[left], h = below[x], i = below[right];
+            Pixel *out[3] = { top + x * 3, middle + x * 3, bottom + x * 3 };
+
+            if (b != h && d != f)
+            {
+                out[0][0] = d == b ? d : e;
+                out[0][1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+                out[0][2] = b == f ? f : e;
+                out[1][0] = (d == b && e != g) || (d == h && e != a) ? d : e;
+                out[1][1] = e;
+                out[1][2] = (b == f && e != i) || (h == f && e != c) ? f : e;
+                out[2][0] = d == h ? d : e;
+                out[2][1] = (d == h && e != i) || (h == f && e != g) ? h : e;
+                out[2][2] = h == f ? f : e;
+            }
+            else
+            {
+                for (Pixel *block : out)
+                {
+                    block[0] = block[1] = block[2] = e;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * Resampler Header
+ *
+ * Brief:
+ * The Resampler resizes whole frames. It crops or extends
+ * the canvas around an anchor, scales with nearest
+ * neighbour sampling, and upscales pixel art with the
+ * Scale2x family of filters. Every kernel works straight
+ * on scanlines, comparing and copying whole pixels, so
+ * indexed frames are scaled without leaving the palette.
+ *
+*/
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QColor>
+#include <QImage>
+#include <QPoint>
+#include <QSize>
+
+#include "enums.h"
+
+class Resampler
+{
+public:
+    /// Largest width or height a frame can be resized to
+    static constexpr int MAX_SIZE = 4096;
+
+    /// Returns where the top left corner of an image of size `from` goes on a canvas of size `to`, so
+    /// the edge or corner `anchor` names lines up
+    static QPoint anchorOffset(QSize from, QSize to, ResizeAnchor anchor);
+
+    /// Returns `image` cropped or extended to `size` around `anchor`, with new space filled with `fill`.
+    /// Indexed images stay indexed, and are filled with the closest entry
+    static QImage resizeCanvas(const QImage &image, QSize size, ResizeAnchor anchor, QColor fill);
+
+    /// Returns `image` scaled with `filter`. Nearest scales to `size`; the pixel art filters ignore it
+    /// and scale by their own factor
+    static QImage scale(const QImage &image, QSize size, ScaleFilter filter);
+
+    /// Returns how many times larger `filter` makes an image, or 0 for Nearest, which scales to any size
+    static int factor(ScaleFilter filter);
+
+    /// Name shown to the user for a filter or anchor
+    static QString filterName(ScaleFilter filter);
+    static QString anchorName(ResizeAnchor anchor);
+
+private:
+    /// Returns `image` as 8 or 32 bits per pixel, the formats the kernels work on
+    static QImage kernelFormat(const QImage &image);
+
+    /// Returns an image of `size` in the format, and with the color table, of `source`
+    static QImage blankLike(const QImage &source, QSize size);
+
+    /// The kernels, for 8 and 32 bit pixels
+    template <typename Pixel>
+    static void scaleNearest(const QImage &source, QImage &destination);
+    template <typename Pixel>
+    static void scale2x(const QImage &source, QImage &destination);
+    template <typename Pixel>
+    static void scale3x(const QImage &source, QImage &destination);
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,132 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ResizeDialog Source
+ *
+ * Brief:
+ * The ResizeDialog asks how to resize the canvas. The
+ * canvas can be cropped or extended around an anchor, or
+ * scaled with nearest neighbour sampling or one of the
+ * pixel art filters, which fix the size to their factor.
+ *
+*/
+
+#include <QFormLayout>
+#include <QPushButton>
+
+#include "resampler.h"
+#include "resizedialog.h"
+
+/**
+ * @brief ResizeDialog::ResizeDialog - Builds the form, starting out on the current size
+ * @param canvasSize - The size of the canvas now
+ * @param parent
+ */
+ResizeDialog::ResizeDialog(QSize canvasSize, QWidget *parent)
+    : QDialog(parent)
+    , canvasSize(canvasSize)
+{
+    setWindowTitle(tr("Canvas Size"));
+
+    modeBox = new QComboBox(this);
+    modeBox->addItem(tr("Crop or extend canvas"));
+    modeBox->addItem(tr("Scale image"));
+
+    widthBox = new QSpinBox(this);
+    widthBox->setRange(1, Resampler::MAX_SIZE);
+    widthBox->setValue(canvasSize.width());
+    heightBox = new QSpinBox(this);
+    heightBox->setRange(1, Resampler::MAX_SIZE);
+    heightBox->setValue(canvasSize.height());
+
+    anchorBox = new QComboBox(this);
+    for (int i = 0; i <= int(ResizeAnchor::BottomRight); i++) {
+        anchorBox->addItem(Resampler::anchorName(ResizeAnchor(i)));
+    }
+    anchorBox->setCurrentIndex(int(ResizeAnchor::TopLeft));
+
+    filterBox = new QComboBox(this);
+    for (int i = 0; i <= int(ScaleFilter::Scale4x); i++) {
+        filterBox->addItem(Resampler::filterName(ScaleFilter(i)));
+    }
+
+    buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    QFormLayout *layout = new QFormLayout(this);
+    layout->addRow(tr("Mode:"), modeBox);
+    layout->addRow(tr("Width:"), widthBox);
+    layout->addRow(tr("Height:"), heightBox);
+    layout->addRow(tr("Anchor:"), anchorBox);
+    layout->addRow(tr("Filter:"), filterBox);
+    layout->addRow(buttons);
+
+    connect(modeBox, &QComboBox::currentIndexChanged, this, [this]() { updateControls(); });
+    connect(filterBox, &QComboBox::currentIndexChanged, this, [this]() { updateControls(); });
+    updateControls();
+}
+
+/**
+ * @brief ResizeDialog::scaling - Returns true if scaling was chosen over cropping or extending
+ * @return
+ */
+bool ResizeDialog::scaling() const
+{
+    return modeBox->currentIndex() == 1;
+}
+
+/**
+ * @brief ResizeDialog::chosenSize - Returns the size the canvas will be
+ * @return
+ */
+QSize ResizeDialog::chosenSize() const
+{
+    int factor = scaling() ? Resampler::factor(filter()) : 0;
+    return factor > 0 ? canvasSize * factor : QSize(widthBox->value(), heightBox->value());
+}
+
+/**
+ * @brief ResizeDialog::anchor - Returns the anchor chosen
+ * @return
+ */
+ResizeAnchor ResizeDialog::anchor() const
+{
+    return ResizeAnchor(anchorBox->currentIndex());
+}
+
+/**
+ * @brief ResizeDialog::filter - Returns the filter chosen
+ * @return
+ */
+ScaleFilter ResizeDialog::filter() const
+{
+    return ScaleFilter(filterBox->currentIndex());
+}
+
+/**
+ * @brief ResizeDialog::updateControls - Only the anchor applies to cropping, and only the filter to scaling.
+ * The pixel art filters decide the size themselves, so it's shown but can't be edited, and the dialog
+ * can't be accepted if that size would be too large
+ */
+void ResizeDialog::updateControls()
+{
+    anchorBox->setEnabled(!scaling());
+    filterBox->setEnabled(scaling());
+
+    bool fixedSize = scaling() && Resampler::factor(filter()) > 0;
+    widthBox->setEnabled(!fixedSize);
+    heightBox->setEnabled(!fixedSize);
+
+    QSize chosen = chosenSize();
+    if (fixedSize) {
+        widthBox->setValue(chosen.width());
+        heightBox->setValue(chosen.height());
+    }
+    buttons->button(QDialogButtonBox::Ok)->setEnabled(chosen.width() <= Resampler::MAX_SIZE
+                                                      && chosen.height() <= Resampler::MAX_SIZE);
+}
@@ -0,0 +1,63 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ResizeDialog Header
+ *
+ * Brief:
+ * The ResizeDialog asks how to resize the canvas. The
+ * canvas can be cropped or extended around an anchor, or
+ * scaled with nearest neighbour sampling or one of the
+ * pixel art filters, which fix the size to their factor.
+ *
+*/
+
+#ifndef RESIZEDIALOG_H
+#define RESIZEDIALOG_H
+
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QSize>
+#include <QSpinBox>
+
+#include "enums.h"
+
+class ResizeDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /// Constructor for a dialog resizing a canvas that is `canvasSize` now
+    explicit ResizeDialog(QSize canvasSize, QWidget *parent = nullptr);
+
+    /// Returns true if the frames should be scaled, and false if the canvas should be cropped or extended
+    bool scaling() const;
+
+    /// The size chosen, already multiplied out for the pixel art filters
+    QSize chosenSize() const;
+
+    /// The edge or corner that stays in place when cropping or extending
+    ResizeAnchor anchor() const;
+
+    /// How to scale the frames
+    ScaleFilter filter() const;
+
+private:
+    QSize canvasSize;
+
+    QComboBox *modeBox;
+    QSpinBox *widthBox;
+    QSpinBox *heightBox;
+    QComboBox *anchorBox;
+    QComboBox *filterBox;
+    QDialogButtonBox *buttons;
+
+    /// Enables the controls that apply to the chosen mode and filter
+    void updateControls();
+};
+
+#endif // RESIZEDIALOG_H
@@ -0,0 +1,153 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ThumbnailCache Source
+ *
+ * Brief:
+ * The ThumbnailCache makes the small previews shown in
+ * the frame list. Thumbnails are scaled on a background
+ * thread and remembered by frame revision, so only frames
+ * that were edited ever get a new thumbnail.
+ *
+*/
+
+#include <QMetaObject>
+
+#include "profiler.h"
+#include "thumbnailcache.h"
+
+/**
+ * @brief ThumbnailCache::ThumbnailCache - Constructor. Thumbnails are made one at a time on a thread of
+ * their own
+ * @param parent
+ */
+ThumbnailCache::ThumbnailCache(QObject *parent)
+    : QObject(parent)
+{
+    pool.setMaxThreadCount(1);
+}
+
+/**
+ * @brief ThumbnailCache::~ThumbnailCache - Drops thumbnails that haven't started and waits for the one
+ * being made, so no work outlives the cache
+ */
+ThumbnailCache::~ThumbnailCache()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+/**
+ * @brief ThumbnailCache::request - Asks for the thumbnail of a frame. A thumbnail that has already been
+ * made for this revision is passed on straight away; otherwise it's made in the background, unless it
+ * already is being made
+ * @param index - Which frame the thumbnail is for, passed back with `thumbnailReady`
+ * @param revision - The frame's revision, from `Model::Frames::revision()`
+ * @param frame - The frame, or a null image if it's only held compressed or tiled
+ * @param chunk - The compressed frame, used when `frame` is null
+ * @param tiles - The tiled frame, used when `frame` is null and `chunk` is empty
+ * @param palette - The document's palette, or empty if frames hold 32 bit colors
+ */
+void ThumbnailCache::request(uint index,
+                             quint64 revision,
+                             const QImage &frame,
+                             const FrameChunk &chunk,
+                             const TiledImage &tiles,
+                             const QList<QRgb> &palette)
+{
+    auto cached = thumbnails.constFind(revision);
+    if (cached != thumbnails.constEnd())
+    {
+        emit thumbnailReady(index, revision, cached.value());
+        return;
+    }
+
+    if (pending.contains(revision))
+    {
+        return;
+    }
+    pending.insert(revision);
+
+    pool.start([this, index, revision, frame, chunk, tiles, palette]() {
+        QImage thumbnail = render(frame, chunk, tiles, palette);
+        QMetaObject::invokeMethod(
+            this,
+            [this, index, revision, thumbnail]() { finished(index, revision, thumbnail); },
+            Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief ThumbnailCache::clear - Forgets every thumbnail. Thumbnails still being made are dropped when
+ * they finish
+ */
+void ThumbnailCache::clear()
+{
+    pool.clear();
+    thumbnails.clear();
+    order.clear();
+    pending.clear();
+}
+
+/**
+ * @brief ThumbnailCache::finished - Stores a thumbnail made in the background, dropping the oldest
+ * thumbnails if there are too many, and passes it on
+ * @param index
+ * @param revision
+ * @param thumbnail
+ */
+void ThumbnailCache::finished(uint index, quint64 revision, const QImage &thumbnail)
+{
+    // Cleared while it was being made, or the frame couldn't be decoded. A failed thumbnail isn't kept,
+    // so the next request tries again
+    if (!pending.remove(revision) || thumbnail.isNull())
+    {
+        return;
+    }
+
+    thumbnails.insert(revision, thumbnail);
+    order.push_back(revision);
+    while (order.size() > MAX_THUMBNAILS)
+    {
+        thumbnails.remove(order.front());
+        order.pop_front();
+    }
+
+    emit thumbnailReady(index, revision, thumbnail);
+}
+
+/**
+ * @brief ThumbnailCache::render - Makes a thumbnail. Runs on the background thread. Sprites smaller than
+ * a thumbnail are scaled up with nearest neighbour so their pixels stay sharp, and larger ones are
+ * scaled down smoothly so details aren't dropped
+ * @param frame - The frame, or a null image if it's only held compressed or tiled
+ * @param chunk - The compressed frame, used when `frame` is null
+ * @param tiles - The tiled frame, used when `frame` is null and `chunk` is empty
+ * @param palette - The palette indexed frames are shown with, or empty to keep their own
+ * @return The thumbnail, or a null image if the frame couldn't be decoded
+ */
+QImage ThumbnailCache::render(const QImage &frame, const FrameChunk &chunk, const TiledImage &tiles, const QList<QRgb> &palette)
+{
+    Profiler::Scope scope("thumbnail");
+    QImage image = !frame.isNull() ? frame : !chunk.isEmpty() ? chunk.decode() : tiles.toImage();
+    if (image.isNull())
+    {
+        return image;
+    }
+
+    // Tiles keep the palette the frame had when they were made
+    if (!palette.isEmpty() && image.format() == QImage::Format_Indexed8)
+    {
+        image.setColorTable(palette);
+    }
+
+    bool shrinking = image.width() > THUMBNAIL_SIZE || image.height() > THUMBNAIL_SIZE;
+    return image.scaled(THUMBNAIL_SIZE,
+                        THUMBNAIL_SIZE,
+                        Qt::KeepAspectRatio,
+                        shrinking ? Qt::SmoothTransformation : Qt::FastTransformation);
+}
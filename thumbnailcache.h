@@ -0,0 +1,85 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * ThumbnailCache Header
+ *
+ * Brief:
+ * The ThumbnailCache makes the small previews shown in
+ * the frame list. Thumbnails are scaled on a background
+ * thread and remembered by frame revision, so only frames
+ * that were edited ever get a new thumbnail.
+ *
+*/
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QThreadPool>
+#include <deque>
+
+#include "framechunk.h"
+#include "tiledimage.h"
+
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Width and height thumbnails are scaled to fit
+    static constexpr int THUMBNAIL_SIZE = 48;
+
+    /// How many thumbnails are remembered before the oldest are dropped
+    static constexpr int MAX_THUMBNAILS = 2048;
+
+    explicit ThumbnailCache(QObject *parent = nullptr);
+
+    /// Waits for any thumbnails still being made
+    ~ThumbnailCache();
+
+    /// Asks for the thumbnail of frame `index` at `revision`. `thumbnailReady` is emitted straight away
+    /// if it's already made, or once it has been made in the background. The frame is given either
+    /// decoded as `frame`, compressed as `chunk` or split into `tiles`, so it can be put back together in
+    /// the background too. Indexed frames are shown with `palette` if it isn't empty
+    void request(uint index,
+                 quint64 revision,
+                 const QImage &frame,
+                 const FrameChunk &chunk,
+                 const TiledImage &tiles,
+                 const QList<QRgb> &palette);
+
+    /// Forgets every thumbnail
+    void clear();
+
+signals:
+    /// Emitted on the GUI thread when the thumbnail of frame `index` at `revision` is ready
+    void thumbnailReady(uint index, quint64 revision, const QImage &thumbnail);
+
+private:
+    /// Thumbnails by frame revision. Revisions are unique, so a frame that moves keeps its thumbnail
+    QHash<quint64, QImage> thumbnails;
+
+    /// Revisions in the order their thumbnails were made, oldest first
+    std::deque<quint64> order;
+
+    /// Revisions with a thumbnail being made right now
+    QSet<quint64> pending;
+
+    /// Thread thumbnails are made on, kept apart so they never hold up saving or loading
+    QThreadPool pool;
+
+    /// Stores a finished thumbnail and passes it on
+    void finished(uint index, quint64 revision, const QImage &thumbnail);
+
+    /// Decodes the frame if needed and scales it down to a thumbnail
+    static QImage render(const QImage &frame, const FrameChunk &chunk, const TiledImage &tiles, const QList<QRgb> &palette);
+};
+
+#endif // THUMBNAILCACHE_H
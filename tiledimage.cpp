@@ -0,0 +1,313 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * TiledImage Source
+ *
+ * Brief:
+ * A TiledImage is a frame split into square tiles that
+ * are shared by content. Tiles are hashed and interned in
+ * one store, so identical tiles in any frame, or in the
+ * undo history, are kept in memory once. Rebuilding a
+ * tiled frame from an edited image reuses every tile
+ * that didn't change.
+ *
+*/
+
+#include <QHash>
+#include <QMutexLocker>
+#include <cstring>
+
+#include "profiler.h"
+#include "tiledimage.h"
+
+/**
+ * @brief TiledImage::fromImage - Splits an image into tiles. When `base` has the same size and format,
+ * each tile is first compared with base's tile in the same place, and reused if nothing changed, so
+ * only the tiles an edit touched are hashed and interned
+ * @param image - The image to split. Formats of less than 8 bits per pixel are converted to ARGB32
+ * @param base - An earlier version of the same image, or a null TiledImage
+ * @return
+ */
+TiledImage TiledImage::fromImage(const QImage &image, const TiledImage &base)
+{
+    Profiler::Scope scope("tile frame");
+
+    TiledImage tiled;
+    if (image.isNull())
+    {
+        return tiled;
+    }
+
+    QImage source = image.depth() % 8 == 0 ? image : image.convertToFormat(QImage::Format_ARGB32);
+
+    tiled.imageSize = source.size();
+    tiled.format = source.format();
+    tiled.colorTable = source.colorTable();
+    tiled.bytesPerPixel = source.depth() / 8;
+    tiled.tilesAcross = (source.width() + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesDown = (source.height() + TILE_SIZE - 1) / TILE_SIZE;
+    tiled.tiles.resize(size_t(tiled.tilesAcross) * tilesDown);
+
+    // Tiles only hold pixels, so an indexed frame whose palette changed still reuses all of them
+    bool sameLayout = base.imageSize == tiled.imageSize && base.format == tiled.format;
+
+    for (int i = 0; i < int(tiled.tiles.size()); i++)
+    {
+        QRect area = tiled.tileArea(i);
+        if (sameLayout && tiled.matches(source, area, *base.tiles[i]))
+        {
+            tiled.tiles[i] = base.tiles[i];
+            continue;
+        }
+        tiled.tiles[i] = store().intern(area.width(), area.height(), tiled.readTile(source, area));
+    }
+
+    return tiled;
+}
+
+/**
+ * @brief TiledImage::toImage - Copies every tile back into a new image
+ * @return
+ */
+QImage TiledImage::toImage() const
+{
+    Profiler::Scope scope("untile frame");
+
+    if (isNull())
+    {
+        return QImage();
+    }
+
+    QImage image(imageSize, format);
+    if (!colorTable.isEmpty())
+    {
+        image.setColorTable(colorTable);
+    }
+
+    for (int i = 0; i < int(tiles.size()); i++)
+    {
+        QRect area = tileArea(i);
+        const Tile &tile = *tiles[i];
+        int rowBytes = area.width() * bytesPerPixel;
+        for (int y = 0; y < area.height(); y++)
+        {
+            std::memcpy(image.scanLine(area.top() + y) + area.left() * bytesPerPixel,
+                        tile.pixels.constData() + y * rowBytes,
+                        rowBytes);
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief TiledImage::isNull
+ * @return True for an empty image
+ */
+bool TiledImage::isNull() const
+{
+    return tiles.empty();
+}
+
+/**
+ * @brief TiledImage::size
+ * @return The size of the image the tiles make up
+ */
+QSize TiledImage::size() const
+{
+    return imageSize;
+}
+
+/**
+ * @brief TiledImage::memoryUsage - Bytes of the tiles this image refers to, counting shared tiles in full
+ * @return
+ */
+size_t TiledImage::memoryUsage() const
+{
+    size_t bytes = sizeof(TiledImage) + tiles.capacity() * sizeof(std::shared_ptr<const Tile>);
+    for (const auto &tile : tiles)
+    {
+        bytes += sizeof(Tile) + tile->pixels.size();
+    }
+    return bytes;
+}
+
+/**
+ * @brief TiledImage::uniqueTileCount
+ * @return How many distinct tiles are in memory
+ */
+size_t TiledImage::uniqueTileCount()
+{
+    return store().liveCount();
+}
+
+/**
+ * @brief TiledImage::uniqueTileBytes
+ * @return How many bytes of pixels the distinct tiles hold
+ */
+size_t TiledImage::uniqueTileBytes()
+{
+    return store().liveBytes();
+}
+
+/**
+ * @brief TiledImage::tileArea - Returns the pixels covered by a tile, clipped to the image
+ * @param index
+ * @return
+ */
+QRect TiledImage::tileArea(int index) const
+{
+    QRect area((index % tilesAcross) * TILE_SIZE, (index / tilesAcross) * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+    return area.intersected(QRect(QPoint(0, 0), imageSize));
+}
+
+/**
+ * @brief TiledImage::readTile - Copies one tile's pixels out of an image
+ * @param image
+ * @param area
+ * @return
+ */
+QByteArray TiledImage::readTile(const QImage &image, QRect area) const
+{
+    int rowBytes = area.width() * bytesPerPixel;
+    QByteArray pixels(rowBytes * area.height(), Qt::Uninitialized);
+    for (int y = 0; y < area.height(); y++)
+    {
+        std::memcpy(pixels.data() + y * rowBytes,
+                    image.constScanLine(area.top() + y) + area.left() * bytesPerPixel,
+                    rowBytes);
+    }
+    return pixels;
+}
+
+/**
+ * @brief TiledImage::matches - Compares a tile with the same area of an image, row by row
+ * @param image
+ * @param area
+ * @param tile
+ * @return
+ */
+bool TiledImage::matches(const QImage &image, QRect area, const Tile &tile) const
+{
+    if (tile.width != area.width() || tile.height != area.height())
+    {
+        return false;
+    }
+
+    int rowBytes = area.width() * bytesPerPixel;
+    for (int y = 0; y < area.height(); y++)
+    {
+        if (std::memcmp(tile.pixels.constData() + y * rowBytes,
+                        image.constScanLine(area.top() + y) + area.left() * bytesPerPixel,
+                        rowBytes)
+            != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief TiledImage::store - The one tile store every image shares
+ * @return
+ */
+TiledImage::TileStore &TiledImage::store()
+{
+    static TileStore tileStore;
+    return tileStore;
+}
+
+//-----TiledImage::TileStore-----//
+
+/**
+ * @brief TiledImage::TileStore::intern - Returns the live tile holding these pixels, or makes a new one.
+ * Tiles with the same hash are compared byte for byte, so a collision never merges different tiles
+ * @param width
+ * @param height
+ * @param pixels
+ * @return
+ */
+std::shared_ptr<const TiledImage::Tile> TiledImage::TileStore::intern(int width, int height, QByteArray pixels)
+{
+    size_t hash = qHashBits(pixels.constData(), pixels.size(), qHashMulti(0, width, height));
+
+    QMutexLocker lock(&mutex);
+    auto [begin, end] = tiles.equal_range(hash);
+    for (auto it = begin; it != end;)
+    {
+        std::shared_ptr<const Tile> tile = it->second.lock();
+        if (!tile)
+        {
+            it = tiles.erase(it);
+            continue;
+        }
+        if (tile->width == width && tile->height == height && tile->pixels == pixels)
+        {
+            return tile;
+        }
+        ++it;
+    }
+
+    auto tile = std::make_shared<const Tile>(Tile{width, height, hash, std::move(pixels)});
+    tiles.emplace(hash, tile);
+
+    // Freed tiles are only found when their hash comes up again, so the table is swept whenever it
+    // has doubled since the last sweep
+    if (tiles.size() > 2 * sweptSize + 1024)
+    {
+        sweep();
+    }
+    return tile;
+}
+
+/**
+ * @brief TiledImage::TileStore::liveCount
+ * @return How many tiles are still used by some image
+ */
+size_t TiledImage::TileStore::liveCount()
+{
+    QMutexLocker lock(&mutex);
+    sweep();
+    return tiles.size();
+}
+
+/**
+ * @brief TiledImage::TileStore::liveBytes
+ * @return How many bytes of pixels the live tiles hold
+ */
+size_t TiledImage::TileStore::liveBytes()
+{
+    QMutexLocker lock(&mutex);
+    size_t bytes = 0;
+    for (const auto &entry : tiles)
+    {
+        if (auto tile = entry.second.lock())
+        {
+            bytes += tile->pixels.size();
+        }
+    }
+    return bytes;
+}
+
+/**
+ * @brief TiledImage::TileStore::sweep - Removes the entries of freed tiles
+ */
+void TiledImage::TileStore::sweep()
+{
+    for (auto it = tiles.begin(); it != tiles.end();)
+    {
+        if (it->second.expired())
+        {
+            it = tiles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    sweptSize = tiles.size();
+}
@@ -0,0 +1,107 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * TiledImage Header
+ *
+ * Brief:
+ * A TiledImage is a frame split into square tiles that
+ * are shared by content. Tiles are hashed and interned in
+ * one store, so identical tiles in any frame, or in the
+ * undo history, are kept in memory once. Rebuilding a
+ * tiled frame from an edited image reuses every tile
+ * that didn't change.
+ *
+*/
+
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class TiledImage
+{
+public:
+    /// Width and height of a tile, in pixels
+    static constexpr int TILE_SIZE = 32;
+
+    /// An empty image
+    TiledImage() = default;
+
+    /// Splits `image` into tiles. Tiles that hold the same pixels as the tile in the same place of
+    /// `base`, usually the image before an edit, are shared with it without being hashed again
+    static TiledImage fromImage(const QImage &image, const TiledImage &base = TiledImage());
+
+    /// Puts the tiles back together into an image
+    QImage toImage() const;
+
+    bool isNull() const;
+    QSize size() const;
+
+    /// Returns how many bytes of tiles this image refers to. Tiles shared with other images are
+    /// counted in full, so the total doesn't change as other images come and go
+    size_t memoryUsage() const;
+
+    /// Returns how many distinct tiles are alive, and how many bytes they hold, across every image
+    static size_t uniqueTileCount();
+    static size_t uniqueTileBytes();
+
+private:
+    /// The pixels of one tile, rows packed without padding. Edge tiles are narrower or shorter
+    struct Tile
+    {
+        int width;
+        int height;
+        size_t hash;
+        QByteArray pixels;
+    };
+
+    /// Interns tiles by content. Holds weak references only, so a tile is freed as soon as no image
+    /// uses it. Shared by every thread, so it is locked while looking tiles up
+    class TileStore
+    {
+    public:
+        std::shared_ptr<const Tile> intern(int width, int height, QByteArray pixels);
+        size_t liveCount();
+        size_t liveBytes();
+
+    private:
+        QMutex mutex;
+        std::unordered_multimap<size_t, std::weak_ptr<const Tile>> tiles;
+
+        /// Size the table had after the last sweep, used to decide when to sweep again
+        size_t sweptSize = 0;
+
+        /// Forgets tiles that have been freed. Called with `mutex` held
+        void sweep();
+    };
+
+    static TileStore &store();
+
+    QSize imageSize;
+    QImage::Format format = QImage::Format_Invalid;
+    QList<QRgb> colorTable;
+    int bytesPerPixel = 0;
+    int tilesAcross = 0;
+    std::vector<std::shared_ptr<const Tile>> tiles;
+
+    /// The area of the image covered by the tile at `index`
+    QRect tileArea(int index) const;
+
+    /// Copies the pixels of `area` out of `image` into packed rows
+    QByteArray readTile(const QImage &image, QRect area) const;
+
+    /// Returns true if `area` of `image` holds exactly the pixels of `tile`
+    bool matches(const QImage &image, QRect area, const Tile &tile) const;
+};
+
+#endif // TILEDIMAGE_H
@@ -17,6 +17,7 @@
  *
 */
 
+#include "palette.h"
 #include "tool.h"
 
 /**
@@ -28,6 +29,79 @@ void Tool::draw(QImage &image, QPoint pos)
 {
 }
 
+/**
+ * @brief Tool::affectedArea - Returns the region of the image changed by drawing at `pos`. Most
+ * tools only touch the pixel under the cursor
+ * @param image - the image that would be drawn on
+ * @param pos - the position on the image that would be drawn on
+ * @return The changed rectangle, clipped to the image
+ */
+QRect Tool::affectedArea(const QImage &image, QPoint pos)
+{
+    return QRect(pos, QSize(1, 1)).intersected(image.rect());
+}
+
+/**
+ * @brief Tool::drawsOncePerClick - Returns true if the tool should only draw once per mouse press,
+ * at the clicked pixel. Most tools are stamped across the brush and along the drag
+ * @return
+ */
+bool Tool::drawsOncePerClick()
+{
+    return false;
+}
+
+/**
+ * @brief Tool::stamp - Draws the whole brush footprint centred on the position at once, writing packed
+ * pixels straight into the image instead of drawing one pixel at a time
+ * @param image - the image to draw on
+ * @param pos - the position on the image to draw on
+ * @return The changed rectangle, clipped to the image
+ */
+QRect Tool::stamp(QImage &image, QPoint pos)
+{
+    return brushMask.stamp(image, pos, paintColor(image));
+}
+
+/**
+ * @brief Tool::stampArea - Returns the region of the image changed by stamping the brush at `pos`
+ * @param image - the image that would be drawn on
+ * @param pos - the position on the image that would be drawn on
+ * @return The changed rectangle, clipped to the image
+ */
+QRect Tool::stampArea(const QImage &image, QPoint pos)
+{
+    return brushMask.area(image, pos);
+}
+
+/**
+ * @brief Tool::paintColor - Returns the color the brush paints with, the brush color by default
+ * @param image - the image that would be drawn on
+ * @return
+ */
+QColor Tool::paintColor(const QImage &image)
+{
+    Q_UNUSED(image);
+    return brushColor;
+}
+
+/**
+ * @brief Tool::paintPixel - Sets one pixel to a color. Indexed images can only hold colors from their
+ * palette, so they get the index of the closest entry instead
+ * @param image - the image to draw on
+ * @param pos - the position on the image to draw on
+ * @param color - the color to draw with
+ */
+void Tool::paintPixel(QImage &image, QPoint pos, QColor color)
+{
+    if (image.format() == QImage::Format_Indexed8)
+    {
+        image.setPixel(pos, uint(Palette::nearest(image.colorTable(), color.rgba())));
+        return;
+    }
+    image.setPixelColor(pos, color);
+}
+
 /**
  * @brief Pen::Draw - Sets the pixel color at the position to the current brush color
  * @param image - the image to draw on
@@ -35,7 +109,7 @@ void Tool::draw(QImage &image, QPoint pos)
  */
 void Pen::draw(QImage &image, QPoint pos)
 {
-    image.setPixelColor(pos.x(), pos.y(), brushColor);
+    paintPixel(image, pos, brushColor);
 }
 
 /**
@@ -50,24 +124,119 @@ void Eyedrop::draw(QImage &image, QPoint pos)
 }
 
 /**
- * @brief Pen::Draw - Sets the pixel color at the position to the white, effectively erasing it
+ * @brief Eyedrop::affectedArea - The eyedropper only reads the image, so nothing changes
+ * @param image - the image that would be drawn on
+ * @param pos - the position on the image that would be drawn on
+ * @return An empty rectangle
+ */
+QRect Eyedrop::affectedArea(const QImage &image, QPoint pos)
+{
+    Q_UNUSED(image);
+    Q_UNUSED(pos);
+    return QRect();
+}
+
+/**
+ * @brief Eyedrop::stamp - The eyedropper only picks the color under the cursor, whatever the brush size
+ * @param image - the image to pick from
+ * @param pos - the position on the image to pick from
+ * @return An empty rectangle, since nothing changes
+ */
+QRect Eyedrop::stamp(QImage &image, QPoint pos)
+{
+    if (image.rect().contains(pos))
+    {
+        draw(image, pos);
+    }
+    return QRect();
+}
+
+/**
+ * @brief Eyedrop::stampArea - The eyedropper only reads the image, so nothing changes
+ * @param image - the image that would be drawn on
+ * @param pos - the position on the image that would be drawn on
+ * @return An empty rectangle
+ */
+QRect Eyedrop::stampArea(const QImage &image, QPoint pos)
+{
+    Q_UNUSED(image);
+    Q_UNUSED(pos);
+    return QRect();
+}
+
+/**
+ * @brief Pen::Draw - Clears the pixel at the position, effectively erasing it
  * @param image - the image to draw on
  * @param pos - the position on the image to draw on
  */
 void Eraser::draw(QImage &image, QPoint pos)
 {
-    // paint it white to erase!
-    image.setPixelColor(pos.x(), pos.y(), QColor("white"));
+    paintPixel(image, pos, paintColor(image));
 }
 
 /**
- * @brief Pen::Draw - Changes the image color to the bucket color
+ * @brief Eraser::paintColor - The eraser clears pixels to transparent on images that can hold it, such as
+ * layers and indexed frames, where it becomes the transparent entry. Opaque frames are painted white
+ * @param image - the image that would be drawn on
+ * @return
+ */
+QColor Eraser::paintColor(const QImage &image)
+{
+    return image.hasAlphaChannel() ? QColor(Qt::transparent) : QColor(Qt::white);
+}
+
+/**
+ * @brief Bucket::draw - Fills the region under the position with the bucket color. The region found by
+ * `affectedArea` for the same image and position is reused rather than searched for again
  * @param image - the image to draw on
  * @param pos - the position on the image to draw on
  */
 void Bucket::draw(QImage &image, QPoint pos)
 {
-    image.fill(brushColor);
+    if (image.cacheKey() != regionImageKey || pos != regionSeed)
+    {
+        region = FloodFill::findRegion(image, pos, tolerance, fillMode);
+    }
+
+    FloodFill::fillSpans(image, region, brushColor);
+    region.clear();
+    regionImageKey = 0;
+}
+
+/**
+ * @brief Bucket::affectedArea - Finds the region the bucket would fill and returns its bounds, so only
+ * that part of the image is recorded for undo and repainted
+ * @param image - the image that would be drawn on
+ * @param pos - the position on the image that would be drawn on
+ * @return The bounding rectangle of the filled region
+ */
+QRect Bucket::affectedArea(const QImage &image, QPoint pos)
+{
+    region = FloodFill::findRegion(image, pos, tolerance, fillMode);
+    regionImageKey = image.cacheKey();
+    regionSeed = pos;
+    return FloodFill::bounds(region);
+}
+
+/**
+ * @brief Bucket::setFillSettings - Changes which pixels the bucket fills
+ * @param mode - Whether to fill the 4 or 8 connected region, or every matching pixel in the image
+ * @param colorTolerance - How far each channel may be from the clicked pixel, from 0 to 255
+ */
+void Bucket::setFillSettings(FillMode mode, int colorTolerance)
+{
+    fillMode = mode;
+    tolerance = qBound(0, colorTolerance, 255);
+}
+
+/**
+ * @brief Bucket::drawsOncePerClick - A fill covers the whole region at once, so the brush size doesn't
+ * apply and dragging doesn't fill again
+ * @return
+ */
+bool Bucket::drawsOncePerClick()
+{
+    return true;
 }
 
 /**
@@ -77,6 +246,20 @@ void Bucket::draw(QImage &image, QPoint pos)
  */
 void Tool::setBrushSettings(int size, QColor color)
 {
+    if (size != brushSize)
+    {
+        brushMask = BrushMask(brushShape, size);
+    }
     brushSize = size;
     brushColor = color;
 }
+
+/**
+ * @brief Tool::setBrushShape - Changes the shape of the brush, rebuilding its footprint
+ * @param shape - The new shape for the brush
+ */
+void Tool::setBrushShape(BrushShape shape)
+{
+    brushShape = shape;
+    brushMask = BrushMask(brushShape, brushSize);
+}
@@ -24,6 +24,11 @@
 #include <QImage>
 #include <QMouseEvent>
 #include <QObject>
+#include <vector>
+
+#include "brushmask.h"
+#include "enums.h"
+#include "floodfill.h"
 
 /// Base class for all tools
 class Tool : public QObject
@@ -34,17 +39,43 @@ public:
     int brushSize;
     QColor brushColor;
 
+    /// Shape of the brush, and its footprint for the current size and shape
+    BrushShape brushShape;
+    BrushMask brushMask;
+
     /// Default constructor, brush size is 1 at index 0, color is black
     Tool()
         : brushSize(0)
         , brushColor(QColor(0, 0, 0))
+        , brushShape(BrushShape::Square)
+        , brushMask(BrushShape::Square, 0)
     {}
 
     /// Draw method, meant to be overriden by derivatives of tool
     virtual void draw(QImage &image, QPoint pos);
 
+    /// Draws the whole brush centred on `pos` in one go, returning the changed area
+    virtual QRect stamp(QImage &image, QPoint pos);
+
+    /// Returns the part of `image` that a `stamp` at `pos` changes
+    virtual QRect stampArea(const QImage &image, QPoint pos);
+
+    /// The color the brush paints with on `image`
+    virtual QColor paintColor(const QImage &image);
+
+    /// Returns the part of `image` that a `draw` at `pos` changes, a single pixel by default
+    virtual QRect affectedArea(const QImage &image, QPoint pos);
+
+    /// Returns true if the tool draws once per click, ignoring the brush size and mouse drags
+    virtual bool drawsOncePerClick();
+
     /// Set brush settings for the tool
     void setBrushSettings(int size, QColor color);
+    void setBrushShape(BrushShape shape);
+
+protected:
+    /// Sets the pixel at `pos` to `color`, or to the closest palette entry on an indexed image
+    static void paintPixel(QImage &image, QPoint pos, QColor color);
 };
 
 /// Pen tool class
@@ -63,6 +94,9 @@ class Eyedrop : public Tool
 public:
     Eyedrop() {}
     void draw(QImage &image, QPoint pos);
+    QRect affectedArea(const QImage &image, QPoint pos);
+    QRect stamp(QImage &image, QPoint pos);
+    QRect stampArea(const QImage &image, QPoint pos);
 signals:
     /// Signal emitted when the color is retrieved using the Eyedrop tool
     void colorRetrieved(QColor color);
@@ -75,6 +109,7 @@ class Eraser : public Tool
 public:
     Eraser() {}
     void draw(QImage &image, QPoint pos);
+    QColor paintColor(const QImage &image);
 };
 
 /// Bucket tool class
@@ -82,8 +117,26 @@ class Bucket : public Tool
 {
     Q_OBJECT
 public:
-    Bucket() {}
+    Bucket()
+        : fillMode(FillMode::FourConnected)
+        , tolerance(0)
+        , regionImageKey(0)
+    {}
     void draw(QImage &image, QPoint pos);
+    QRect affectedArea(const QImage &image, QPoint pos);
+    bool drawsOncePerClick();
+
+    /// Set which pixels the bucket fills
+    void setFillSettings(FillMode mode, int colorTolerance);
+
+private:
+    FillMode fillMode;
+    int tolerance;
+
+    /// Region found by the last `affectedArea`, kept so `draw` doesn't search for it again
+    std::vector<FloodFill::Span> region;
+    qint64 regionImageKey;
+    QPoint regionSeed;
 };
 
 #endif // TOOL_H
@@ -32,6 +32,23 @@ void ToolBar::drawWithCurrentTool(QImage &image, QPoint pos)
     emit canvasChanged();
 }
 
+/**
+ * @brief ToolBar::stampWithCurrentTool - Draws a whole dab of the current tool's brush, notifying
+ * once for the dab rather than once per pixel
+ * @param image - The image to draw on
+ * @param pos - The centre of the brush
+ * @return The changed area
+ */
+QRect ToolBar::stampWithCurrentTool(QImage &image, QPoint pos)
+{
+    QRect changed = currentTool->stamp(image, pos);
+    if (!changed.isEmpty())
+    {
+        emit canvasChanged();
+    }
+    return changed;
+}
+
 /**
  * @brief PToolBar::UpdateCurrentTool - Changes the current tool
  * @param tool - The new tool to set
@@ -79,3 +96,24 @@ void ToolBar::setPenBrushColor(QColor color)
     tool.brushColor = color;
     emit colorChanged(color);
 }
+
+/**
+ * @brief ToolBar::setFillSettings - Sets which pixels the bucket tool fills
+ * @param mode - Whether to fill the 4 or 8 connected region, or every matching pixel
+ * @param tolerance - How far each channel may be from the clicked pixel
+ */
+void ToolBar::setFillSettings(FillMode mode, int tolerance)
+{
+    bucket.setFillSettings(mode, tolerance);
+}
+
+/**
+ * @brief ToolBar::setBrushShape - Sets the brush shape of every tool that uses the brush
+ * @param shape - The new brush shape
+ */
+void ToolBar::setBrushShape(BrushShape shape)
+{
+    pen.setBrushShape(shape);
+    eraser.setBrushShape(shape);
+    tool.setBrushShape(shape);
+}
@@ -55,11 +55,16 @@ public:
 public slots:
     /// Slots for drawing and updating with the current tool
     void drawWithCurrentTool(QImage &image, QPoint pos);
+    QRect stampWithCurrentTool(QImage &image, QPoint pos);
     void updateCurrentTool(ToolType tool);
 
     /// Slots for brush settings and pen color for the current tool
     void setCurrentBrushSettings(int size, QColor color);
     void setPenBrushColor(QColor color);
+    void setBrushShape(BrushShape shape);
+
+    /// Slot for which pixels the bucket fills
+    void setFillSettings(FillMode mode, int tolerance);
 
 signals:
     /// Signals emitted when the tools, canvas, or color are changed
@@ -0,0 +1,515 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * UndoHistory Source
+ *
+ * Brief:
+ * The UndoHistory records every change made to the
+ * document: strokes as small run-length encoded pixel
+ * patches, and frame operations as references to the
+ * frames they move around. The total size of the
+ * history is kept under a memory budget.
+ *
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "undohistory.h"
+
+/**
+ * @brief UndoHistory::UndoHistory - Constructor
+ * @param memoryBudget - How many bytes the history may use before old changes are evicted
+ */
+UndoHistory::UndoHistory(size_t memoryBudget)
+    : memoryBudget(memoryBudget)
+    , usedMemory(0)
+    , strokeActive(false)
+    , strokeFrameIndex(0)
+    , strokeLayerIndex(0)
+    , tilesAcross(0)
+{}
+
+/**
+ * @brief UndoHistory::PixelDelta::memoryUsage - Approximates the bytes held by this delta
+ * @return
+ */
+size_t UndoHistory::PixelDelta::memoryUsage() const
+{
+    size_t bytes = sizeof(PixelDelta);
+    for (const TilePatch &patch : patches)
+    {
+        bytes += sizeof(TilePatch);
+        bytes += (patch.before.capacity() + patch.after.capacity()) * sizeof(PixelRun);
+    }
+    return bytes;
+}
+
+/**
+ * @brief UndoHistory::Change::memoryUsage - Approximates the bytes held by this change. Tiles are
+ * counted in full even if other frames share them, so the total stays the same while the change is held
+ * @return
+ */
+size_t UndoHistory::Change::memoryUsage() const
+{
+    size_t bytes = delta.memoryUsage() + frame.memoryUsage();
+    for (const TiledImage &image : frames)
+    {
+        bytes += image.memoryUsage();
+    }
+    if (layers)
+    {
+        bytes += layers->memoryUsage();
+    }
+    for (const auto &stack : frameLayers)
+    {
+        bytes += stack ? stack->memoryUsage() : 0;
+    }
+    return bytes + palette.size() * sizeof(QRgb);
+}
+
+/**
+ * @brief UndoHistory::beginStroke - Starts recording a new stroke. No pixels are copied yet, tiles are
+ * only captured once a tool is about to draw on them
+ * @param image - The image the stroke will be drawn on
+ * @param frameIndex - Which frame `image` is, so the stroke can be undone from any frame
+ * @param layerIndex - Which layer of the frame `image` is, if the frame has layers
+ */
+void UndoHistory::beginStroke(const QImage &image, uint frameIndex, int layerIndex)
+{
+    strokeActive = true;
+    strokeFrameIndex = frameIndex;
+    strokeLayerIndex = layerIndex;
+    strokeImageSize = image.size();
+    tilesAcross = (image.width() + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesDown = (image.height() + TILE_SIZE - 1) / TILE_SIZE;
+
+    strokeTiles.clear();
+    strokeTiles.resize(tilesAcross * tilesDown);
+}
+
+/**
+ * @brief UndoHistory::recordBefore - Captures the original pixels of every tile in `area` that the
+ * current stroke hasn't touched yet. Tiles that were already captured keep their first copy, which is
+ * what they looked like before the stroke started
+ * @param image - The image about to be drawn on
+ * @param area - The area that is about to change
+ */
+void UndoHistory::recordBefore(const QImage &image, QRect area)
+{
+    if (!strokeActive || image.size() != strokeImageSize)
+    {
+        return;
+    }
+
+    area = area.intersected(image.rect());
+    if (area.isEmpty())
+    {
+        return;
+    }
+
+    for (int tileY = area.top() / TILE_SIZE; tileY <= area.bottom() / TILE_SIZE; tileY++)
+    {
+        for (int tileX = area.left() / TILE_SIZE; tileX <= area.right() / TILE_SIZE; tileX++)
+        {
+            int tileIndex = tileY * tilesAcross + tileX;
+            if (strokeTiles[tileIndex].empty())
+            {
+                strokeTiles[tileIndex] = readPixels(image, tileArea(tileIndex));
+            }
+        }
+    }
+}
+
+/**
+ * @brief UndoHistory::endStroke - Finishes recording the stroke and pushes what it changed onto the
+ * undo stack. Starting a new change throws away anything that could have been redone
+ * @param image - The image the stroke was drawn on
+ * @return True if the stroke changed at least one pixel
+ */
+bool UndoHistory::endStroke(const QImage &image)
+{
+    if (!strokeActive)
+    {
+        return false;
+    }
+
+    strokeActive = false;
+    PixelDelta delta = packStroke(image);
+    strokeTiles.clear();
+
+    if (delta.patches.empty())
+    {
+        return false;
+    }
+
+    Change change;
+    change.action = HistoryAction::EditPixels;
+    change.frameIndex = strokeFrameIndex;
+    change.layerIndex = strokeLayerIndex;
+    change.delta = std::move(delta);
+    push(std::move(change));
+
+    return true;
+}
+
+/**
+ * @brief UndoHistory::push - Adds a change to the top of the undo stack. Starting a new change throws
+ * away anything that could have been redone
+ * @param change
+ */
+void UndoHistory::push(Change change)
+{
+    for (const Change &redoChange : redoStack)
+    {
+        usedMemory -= redoChange.memoryUsage();
+    }
+    redoStack.clear();
+
+    usedMemory += change.memoryUsage();
+    undoStack.push_back(std::move(change));
+    enforceBudget();
+}
+
+/**
+ * @brief UndoHistory::undo - Hands the latest change to `revert` so it can be taken back, then moves it
+ * to the redo stack. `revert` may swap frames in and out of the change, so its size is measured again
+ * afterwards
+ * @param revert - Reverts the change on the document
+ * @return False if there was nothing to undo
+ */
+bool UndoHistory::undo(const std::function<void(Change &)> &revert)
+{
+    if (undoStack.empty())
+    {
+        return false;
+    }
+
+    Change change = std::move(undoStack.back());
+    undoStack.pop_back();
+    usedMemory -= change.memoryUsage();
+
+    revert(change);
+
+    usedMemory += change.memoryUsage();
+    redoStack.push_back(std::move(change));
+    enforceBudget();
+
+    return true;
+}
+
+/**
+ * @brief UndoHistory::redo - Hands the latest undone change to `reapply`, then moves it back to the
+ * undo stack
+ * @param reapply - Applies the change to the document again
+ * @return False if there was nothing to redo
+ */
+bool UndoHistory::redo(const std::function<void(Change &)> &reapply)
+{
+    if (redoStack.empty())
+    {
+        return false;
+    }
+
+    Change change = std::move(redoStack.back());
+    redoStack.pop_back();
+    usedMemory -= change.memoryUsage();
+
+    reapply(change);
+
+    usedMemory += change.memoryUsage();
+    undoStack.push_back(std::move(change));
+    enforceBudget();
+
+    return true;
+}
+
+/**
+ * @brief UndoHistory::canUndo - Returns if there is a change to undo
+ * @return
+ */
+bool UndoHistory::canUndo() const
+{
+    return !undoStack.empty();
+}
+
+/**
+ * @brief UndoHistory::canRedo - Returns if there is a change to redo
+ * @return
+ */
+bool UndoHistory::canRedo() const
+{
+    return !redoStack.empty();
+}
+
+/**
+ * @brief UndoHistory::clear - Discards every stored change and any stroke being recorded
+ */
+void UndoHistory::clear()
+{
+    undoStack.clear();
+    redoStack.clear();
+    strokeTiles.clear();
+    strokeActive = false;
+    usedMemory = 0;
+}
+
+/**
+ * @brief UndoHistory::setMemoryBudget - Memory budget setter. Shrinking the budget evicts the oldest
+ * changes right away
+ * @param bytes
+ */
+void UndoHistory::setMemoryBudget(size_t bytes)
+{
+    memoryBudget = bytes;
+    enforceBudget();
+}
+
+/**
+ * @brief UndoHistory::getMemoryBudget - Memory budget getter
+ * @return
+ */
+size_t UndoHistory::getMemoryBudget() const
+{
+    return memoryBudget;
+}
+
+/**
+ * @brief UndoHistory::memoryUsage - Returns the bytes currently used by stored changes
+ * @return
+ */
+size_t UndoHistory::memoryUsage() const
+{
+    return usedMemory;
+}
+
+/**
+ * @brief UndoHistory::tileArea - Returns the image area of a tile. Tiles on the right and bottom edges
+ * are cut short when the image size isn't a multiple of `TILE_SIZE`
+ * @param tileIndex
+ * @return
+ */
+QRect UndoHistory::tileArea(int tileIndex) const
+{
+    QRect tile((tileIndex % tilesAcross) * TILE_SIZE,
+               (tileIndex / tilesAcross) * TILE_SIZE,
+               TILE_SIZE,
+               TILE_SIZE);
+    return tile.intersected(QRect(QPoint(0, 0), strokeImageSize));
+}
+
+/**
+ * @brief UndoHistory::packStroke - Compares every captured tile to what it looks like now and keeps
+ * only the smallest rectangle inside each tile that actually changed
+ * @param image - The image after the stroke
+ * @return The delta of the stroke, with no patches if nothing changed
+ */
+UndoHistory::PixelDelta UndoHistory::packStroke(const QImage &image) const
+{
+    PixelDelta delta;
+    if (image.size() != strokeImageSize)
+    {
+        return delta;
+    }
+
+    for (int tileIndex = 0; tileIndex < int(strokeTiles.size()); tileIndex++)
+    {
+        const std::vector<QRgb> &before = strokeTiles[tileIndex];
+        if (before.empty())
+        {
+            continue;
+        }
+
+        QRect tile = tileArea(tileIndex);
+        std::vector<QRgb> after = readPixels(image, tile);
+
+        // Find the bounds of the pixels that differ inside this tile
+        QRect changed;
+        for (int y = 0; y < tile.height(); y++)
+        {
+            for (int x = 0; x < tile.width(); x++)
+            {
+                int i = y * tile.width() + x;
+                if (before[i] != after[i])
+                {
+                    changed |= QRect(x, y, 1, 1);
+                }
+            }
+        }
+
+        if (changed.isEmpty())
+        {
+            continue;
+        }
+
+        std::vector<QRgb> changedBefore;
+        std::vector<QRgb> changedAfter;
+        changedBefore.reserve(changed.width() * changed.height());
+        changedAfter.reserve(changed.width() * changed.height());
+        for (int y = changed.top(); y <= changed.bottom(); y++)
+        {
+            for (int x = changed.left(); x <= changed.right(); x++)
+            {
+                changedBefore.push_back(before[y * tile.width() + x]);
+                changedAfter.push_back(after[y * tile.width() + x]);
+            }
+        }
+
+        TilePatch patch;
+        patch.area = changed.translated(tile.topLeft());
+        patch.before = encode(changedBefore);
+        patch.after = encode(changedAfter);
+        delta.area |= patch.area;
+        delta.patches.push_back(std::move(patch));
+    }
+
+    return delta;
+}
+
+/**
+ * @brief UndoHistory::applyDelta - Writes the stored pixels of a delta back into the image
+ * @param image - The image to write into
+ * @param delta - The change to apply
+ * @param useBefore - True to restore the pixels from before the change, false for after
+ */
+void UndoHistory::applyDelta(QImage &image, const PixelDelta &delta, bool useBefore)
+{
+    for (const TilePatch &patch : delta.patches)
+    {
+        // A patch recorded before the canvas was resized may no longer fit
+        if (!image.rect().contains(patch.area))
+        {
+            continue;
+        }
+        decode(useBefore ? patch.before : patch.after, image, patch.area);
+    }
+}
+
+/**
+ * @brief UndoHistory::enforceBudget - Evicts the oldest undo steps until the history fits in budget.
+ * The newest step is always kept so the last change can be undone
+ */
+void UndoHistory::enforceBudget()
+{
+    while (usedMemory > memoryBudget && undoStack.size() > 1)
+    {
+        usedMemory -= undoStack.front().memoryUsage();
+        undoStack.pop_front();
+    }
+}
+
+/**
+ * @brief UndoHistory::encode - Run-length encodes a list of pixels. Pixel art strokes are mostly made
+ * of long runs of one color, so this is usually much smaller than the raw pixels
+ * @param pixels
+ * @return
+ */
+std::vector<UndoHistory::PixelRun> UndoHistory::encode(const std::vector<QRgb> &pixels)
+{
+    std::vector<PixelRun> runs;
+    for (QRgb pixel : pixels)
+    {
+        if (!runs.empty() && runs.back().color == pixel)
+        {
+            runs.back().length++;
+        }
+        else
+        {
+            runs.push_back({1, pixel});
+        }
+    }
+    runs.shrink_to_fit();
+    return runs;
+}
+
+/**
+ * @brief UndoHistory::decode - Expands run-length encoded pixels into a rectangle of the image. Each run is
+ * written as whole segments that end at the run or the row, and the row is only looked up when it changes
+ * @param runs - The encoded pixels, row-major
+ * @param image - The image to write into
+ * @param area - The rectangle the pixels belong to
+ */
+void UndoHistory::decode(const std::vector<PixelRun> &runs, QImage &image, QRect area)
+{
+    int x = area.left();
+    int y = area.top();
+    bool direct = image.depth() == 32;
+    bool indexed = image.format() == QImage::Format_Indexed8;
+    uchar *row = y <= area.bottom() ? image.scanLine(y) : nullptr;
+
+    for (const PixelRun &run : runs)
+    {
+        quint32 remaining = run.length;
+        while (remaining > 0 && y <= area.bottom())
+        {
+            int count = int(std::min<quint32>(remaining, quint32(area.right() - x + 1)));
+            if (direct)
+            {
+                std::fill_n(reinterpret_cast<QRgb *>(row) + x, count, run.color);
+            }
+            else if (indexed)
+            {
+                std::memset(row + x, uchar(run.color), size_t(count));
+            }
+            else
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    image.setPixel(x + i, y, run.color);
+                }
+            }
+
+            remaining -= quint32(count);
+            x += count;
+            if (x > area.right())
+            {
+                x = area.left();
+                if (++y <= area.bottom())
+                {
+                    row = image.scanLine(y);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief UndoHistory::readPixels - Copies a rectangle of the image into a row-major list of pixels. Pixels
+ * of indexed images are their palette indices
+ * @param image
+ * @param area
+ * @return
+ */
+std::vector<QRgb> UndoHistory::readPixels(const QImage &image, QRect area)
+{
+    std::vector<QRgb> pixels;
+    pixels.reserve(area.width() * area.height());
+
+    for (int y = area.top(); y <= area.bottom(); y++)
+    {
+        if (image.depth() == 32)
+        {
+            const QRgb *row = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+            pixels.insert(pixels.end(), row + area.left(), row + area.right() + 1);
+        }
+        else if (image.format() == QImage::Format_Indexed8)
+        {
+            // Indices are kept rather than colors, so strokes still undo correctly after the palette changes
+            const uchar *row = image.constScanLine(y);
+            pixels.insert(pixels.end(), row + area.left(), row + area.right() + 1);
+        }
+        else
+        {
+            for (int x = area.left(); x <= area.right(); x++)
+            {
+                pixels.push_back(image.pixel(x, y));
+            }
+        }
+    }
+
+    return pixels;
+}
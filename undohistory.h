@@ -0,0 +1,174 @@
+/*
+ * Assignment 8: Pixel Image Software Suite (PISS)
+ * Class Author(s): David Cosby, Andrew Wilhelm, Allison Walker,
+ * Mason Sansom, AJ Kennedy, Brett Baxter
+ * Course: CS 3505
+ * Fall 2023
+ *
+ * UndoHistory Header
+ *
+ * Brief:
+ * The UndoHistory records every change made to the
+ * document: strokes as small run-length encoded pixel
+ * patches, and frame operations as references to the
+ * frames they move around. The total size of the
+ * history is kept under a memory budget.
+ *
+*/
+
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "enums.h"
+#include "layerstack.h"
+#include "tiledimage.h"
+
+class UndoHistory
+{
+public:
+    /// A run of `length` identical pixels
+    struct PixelRun
+    {
+        quint32 length;
+        QRgb color;
+    };
+
+    /// The before and after pixels of one changed tile
+    struct TilePatch
+    {
+        QRect area;
+        std::vector<PixelRun> before;
+        std::vector<PixelRun> after;
+    };
+
+    /// Everything a single stroke changed
+    struct PixelDelta
+    {
+        std::vector<TilePatch> patches;
+        QRect area;
+
+        /// Returns roughly how many bytes this delta holds onto
+        size_t memoryUsage() const;
+    };
+
+    /// One undoable change to the document. Which fields are used depends on `action`
+    struct Change
+    {
+        HistoryAction action;
+
+        /// The frame that was edited, inserted or removed, or the first of two swapped frames
+        uint frameIndex = 0;
+
+        /// The second of two swapped frames
+        uint otherFrameIndex = 0;
+
+        /// The layer of `frameIndex` a stroke was drawn on
+        int layerIndex = 0;
+
+        /// The pixels a stroke changed
+        PixelDelta delta;
+
+        /// A frame that is currently out of the document, such as a removed frame. Its tiles are
+        /// shared with the frames still in the document, so only tiles unique to it take up memory
+        TiledImage frame;
+
+        /// Every frame from before or after a resize, whichever isn't in the document right now
+        std::vector<TiledImage> frames;
+
+        /// The layers of `frame`, or of the frame at `frameIndex` before or after its layers were
+        /// edited. Null for a frame of a single image
+        std::shared_ptr<LayerStack> layers;
+
+        /// The layers of each of `frames`
+        std::vector<std::shared_ptr<LayerStack>> frameLayers;
+
+        /// The shared palette from before or after it was edited or frames were converted, whichever
+        /// isn't in use right now. Empty for 32 bit color
+        QList<QRgb> palette;
+
+        /// Returns roughly how many bytes this change holds onto
+        size_t memoryUsage() const;
+    };
+
+    /// Width and height of the tiles a stroke is recorded in
+    static constexpr int TILE_SIZE = 16;
+
+    /// Default memory budget of 64 MB
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+    explicit UndoHistory(size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    /// Starts recording a stroke that will be drawn on `image`, the frame at `frameIndex`, or its
+    /// layer at `layerIndex`
+    void beginStroke(const QImage &image, uint frameIndex, int layerIndex = 0);
+
+    /// Remembers the pixels in `area` before they are drawn over. Must be called before each draw
+    void recordBefore(const QImage &image, QRect area);
+
+    /// Finishes the stroke, storing what changed. Returns false if the stroke changed nothing
+    bool endStroke(const QImage &image);
+
+    /// Records a change that was made to the frames themselves
+    void push(Change change);
+
+    /// Passes the latest change to `revert` (or `reapply`) and moves it to the other stack.
+    /// Returns false if there was nothing to undo or redo
+    bool undo(const std::function<void(Change &)> &revert);
+    bool redo(const std::function<void(Change &)> &reapply);
+
+    bool canUndo() const;
+    bool canRedo() const;
+
+    /// Discards the whole history
+    void clear();
+
+    /// Updates how many bytes the history may use, evicting the oldest changes if needed
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+
+    /// Returns how many bytes the stored history currently uses
+    size_t memoryUsage() const;
+
+    /// Writes either the before or after pixels of `delta` back into `image`
+    static void applyDelta(QImage &image, const PixelDelta &delta, bool useBefore);
+
+private:
+    std::deque<Change> undoStack;
+    std::vector<Change> redoStack;
+    size_t memoryBudget;
+    size_t usedMemory;
+
+    /// Stroke being recorded. Holds the original pixels of every tile it has touched so far
+    bool strokeActive;
+    uint strokeFrameIndex;
+    int strokeLayerIndex;
+    QSize strokeImageSize;
+    int tilesAcross;
+    std::vector<std::vector<QRgb>> strokeTiles;
+
+    /// Returns the area of the tile at `tileIndex`, clipped to the stroke image
+    QRect tileArea(int tileIndex) const;
+
+    /// Builds the delta for the recorded stroke by comparing captured tiles with `image`
+    PixelDelta packStroke(const QImage &image) const;
+
+    /// Drops the oldest changes until the history fits in the memory budget
+    void enforceBudget();
+
+    /// Run-length encoding of a rectangle of pixels
+    static std::vector<PixelRun> encode(const std::vector<QRgb> &pixels);
+    static void decode(const std::vector<PixelRun> &runs, QImage &image, QRect area);
+
+    /// Reads a rectangle of pixels into a row-major vector
+    static std::vector<QRgb> readPixels(const QImage &image, QRect area);
+};
+
+#endif // UNDOHISTORY_H